@@ -0,0 +1,140 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "../json.h"
+#include "../json_scanner.h"
+#include "../mapped_file.h"
+
+using namespace std::literals;
+
+namespace {
+// Обработчик, который только считает события: позволяет измерить скорость разбора без построения дерева
+class CountingHandler final : public json::Handler {
+   public:
+    void Null() override {
+        ++events;
+    }
+    void Bool(bool) override {
+        ++events;
+    }
+    void Int(int) override {
+        ++events;
+    }
+    void Double(double) override {
+        ++events;
+    }
+    void String(std::string_view) override {
+        ++events;
+    }
+    void StartArray() override {
+        ++events;
+    }
+    void EndArray() override {
+        ++events;
+    }
+    void StartDict() override {
+        ++events;
+    }
+    void Key(std::string_view) override {
+        ++events;
+    }
+    void EndDict() override {
+        ++events;
+    }
+
+    size_t events = 0;
+};
+
+// Синтетический base_requests: координаты и road_distances составляют основную часть входа
+std::string MakeInput(int stop_count, int distances_per_stop) {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> latitude(43.5, 43.7);
+    std::uniform_real_distribution<double> longitude(39.6, 39.8);
+    std::uniform_int_distribution<int> stop_index(0, stop_count - 1);
+    std::uniform_int_distribution<int> distance(100, 10000);
+
+    std::ostringstream out;
+    out << std::setprecision(9) << "{\"base_requests\": [";
+    for (int i = 0; i < stop_count; ++i) {
+        out << (i ? ",\n" : "\n") << R"({"type": "Stop", "name": "Stop )" << i
+            << R"(", "latitude": )" << latitude(generator) << R"(, "longitude": )" << longitude(generator)
+            << R"(, "road_distances": {)";
+        for (int j = 0; j < distances_per_stop; ++j) {
+            out << (j ? ", " : "") << "\"Stop " << stop_index(generator) << '_' << j << "\": " << distance(generator);
+        }
+        out << "}}";
+    }
+    out << "\n]}";
+    return out.str();
+}
+
+template <typename Function>
+double MeasureSeconds(int iterations, Function function) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        function();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+void Report(std::string_view name, double seconds, size_t bytes) {
+    std::cout << std::left << std::setw(34) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << seconds * 1000 << " ms" << std::setw(10) << bytes / seconds / (1 << 20) << " MB/s\n";
+}
+}  // namespace
+
+// Сравнивает двухэтапный разбор std::istream, читаемого порциями, с разбором непрерывного буфера.
+// Запуск: json_load_bench [input.json] [iterations]
+// Без аргументов разбирается синтетический документ из 100000 остановок
+int main(int argc, char* argv[]) {
+    std::string generated;
+    std::optional<io::MappedFile> file;
+    std::string_view text;
+    if (argc > 1) {
+        file.emplace(argv[1]);
+        text = file->GetData();
+    } else {
+        generated = MakeInput(100000, 8);
+        text = generated;
+    }
+    const int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    std::cout << "input: " << text.size() / (1 << 20) << " MB, scanner: "
+              << json::StructuralScanner::GetImplementationName() << ", iterations: " << iterations << '\n';
+
+    const std::string text_copy(text);
+    size_t stream_events = 0;
+    size_t buffer_events = 0;
+    Report("json::Parse(std::istream&)"sv, MeasureSeconds(iterations, [&] {
+               std::istringstream input(text_copy);
+               CountingHandler handler;
+               json::Parse(input, handler);
+               stream_events = handler.events;
+           }),
+           text.size());
+    Report("json::Parse(std::string_view)"sv, MeasureSeconds(iterations, [&] {
+               CountingHandler handler;
+               json::Parse(text, handler);
+               buffer_events = handler.events;
+           }),
+           text.size());
+    Report("json::Load(std::istream&)"sv, MeasureSeconds(iterations, [&] {
+               std::istringstream input(text_copy);
+               json::Load(input);
+           }),
+           text.size());
+    Report("json::Load(std::string_view)"sv, MeasureSeconds(iterations, [&] {
+               json::Load(text);
+           }),
+           text.size());
+    if (stream_events != buffer_events) {
+        std::cerr << "event count mismatch: " << stream_events << " vs " << buffer_events << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../transport_catalogue.h"
+#include "../transport_router.h"
+#include "../tools/city_generator.h"
+
+using namespace std::literals;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Сюда записываются результаты вычислений, чтобы компилятор их не отбросил
+volatile double benchmark_sink = 0;
+
+double ElapsedMilliseconds(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Справочник синтетического города без разбора JSON: StopId совпадает с номером остановки генератора
+void FillCatalogue(const city_generator::City& city, transport_catalogue::TransportCatalogue& db) {
+    size_t route_stop_count = 0;
+    for (const city_generator::Bus& bus : city.buses) {
+        route_stop_count += bus.stops.size();
+    }
+    db.Reserve(city.stops.size(), city.buses.size(), route_stop_count);
+    for (const city_generator::Stop& stop : city.stops) {
+        db.AddStop(stop.name, stop.coordinates);
+    }
+    for (size_t from = 0; from < city.stops.size(); ++from) {
+        for (const auto& [to, meters] : city.stops[from].road_distances) {
+            db.AddDistanceToStops(static_cast<domain::StopId>(from), static_cast<domain::StopId>(to), meters);
+        }
+    }
+    std::vector<domain::StopId> route;
+    for (const city_generator::Bus& bus : city.buses) {
+        route.assign(bus.stops.begin(), bus.stops.end());
+        db.AddBus(bus.name, domain::Span<domain::StopId>(route.data(), route.data() + route.size()),
+                  bus.is_roundtrip ? domain::TypeRoute::circular : domain::TypeRoute::linear);
+    }
+    db.Finalize();
+}
+
+struct QueryStats {
+    double mean_us = 0;
+    double p99_us = 0;
+    size_t found = 0;
+};
+
+// Итоги найденного пути, у ненайденного - -1
+struct RouteTotals {
+    double time = -1;
+    int distance = -1;
+};
+
+// Время запросов FindRoute по парам остановок: среднее и 99-й процентиль. В totals - итоги каждого запроса
+QueryStats MeasureQueries(const router::TransportRouter& transport_router, const std::vector<std::pair<domain::StopId, domain::StopId>>& queries,
+                          router::Metric metric, std::vector<RouteTotals>& totals) {
+    std::vector<double> latencies;
+    latencies.reserve(queries.size());
+    QueryStats stats;
+    totals.clear();
+    for (const auto& [from, to] : queries) {
+        const auto start = Clock::now();
+        const std::optional<router::RouteInfo> route = transport_router.FindRoute(from, to, metric);
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        totals.push_back(route ? RouteTotals{route->total_time, route->total_distance} : RouteTotals{});
+        stats.found += route.has_value();
+        benchmark_sink = benchmark_sink + totals.back().time;
+    }
+    for (double latency : latencies) {
+        stats.mean_us += latency / static_cast<double>(latencies.size());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    stats.p99_us = latencies.empty() ? 0 : latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    return stats;
+}
+
+void PrintRow(std::string_view name, double build_ms, size_t memory, const QueryStats& time_stats, const QueryStats& distance_stats) {
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << build_ms << " ms" << std::setw(12) << memory / 1024 << " KB"
+              << std::setw(14) << time_stats.mean_us << " us" << std::setw(12) << time_stats.p99_us << " us"
+              << std::setw(14) << distance_stats.mean_us << " us" << std::setw(12) << distance_stats.p99_us << " us\n";
+}
+
+// Число запросов, на которые Дейкстра и иерархия ответили разным временем или расстоянием пути.
+// Для обеих метрик сравниваются оба итога: пути одной длины должны совпадать и по времени
+size_t CountMismatches(const std::vector<RouteTotals>& expected, const std::vector<RouteTotals>& actual) {
+    size_t mismatches = 0;
+    for (size_t i = 0; i < std::min(expected.size(), actual.size()); ++i) {
+        mismatches += expected[i].distance != actual[i].distance
+                      || std::abs(expected[i].time - actual[i].time) > 1e-6 * std::max(1.0, std::abs(expected[i].time));
+    }
+    return mismatches;
+}
+
+// Возвращает число расхождений иерархий с Дейкстрой
+size_t RunSize(int stop_count, const city_generator::CitySettings& base_params, size_t query_count, size_t dijkstra_query_count,
+             int hierarchy_limit, size_t thread_count) {
+    city_generator::CitySettings params = base_params;
+    params.stop_count = stop_count;
+    params.bus_count = std::max(1, stop_count / 10);
+    transport_catalogue::TransportCatalogue db;
+    FillCatalogue(city_generator::GenerateCity(params), db);
+
+    std::vector<std::pair<domain::StopId, domain::StopId>> queries;
+    std::mt19937 random(params.seed);
+    std::uniform_int_distribution<domain::StopId> random_stop(0, static_cast<domain::StopId>(db.GetStopCount() - 1));
+    for (size_t i = 0; i < query_count; ++i) {
+        queries.emplace_back(random_stop(random), random_stop(random));
+    }
+    const std::vector<std::pair<domain::StopId, domain::StopId>> dijkstra_queries(
+        queries.begin(), queries.begin() + static_cast<std::ptrdiff_t>(std::min(dijkstra_query_count, queries.size())));
+
+    router::RoutingSettings settings{6, 40};
+    auto start = Clock::now();
+    const router::TransportRouter dijkstra(db, settings);
+    const double dijkstra_build_ms = ElapsedMilliseconds(start);
+    std::cout << "stops: " << db.GetStopCount() << ", buses: " << db.GetBusCount() << ", graph: " << dijkstra.GetVertexCount()
+              << " vertices, " << dijkstra.GetEdgeCount() << " edges" << std::endl;
+
+    std::vector<RouteTotals> dijkstra_times;
+    std::vector<RouteTotals> dijkstra_distances;
+    const QueryStats dijkstra_time = MeasureQueries(dijkstra, dijkstra_queries, router::Metric::Time, dijkstra_times);
+    const QueryStats dijkstra_distance = MeasureQueries(dijkstra, dijkstra_queries, router::Metric::Distance, dijkstra_distances);
+    std::cout << std::left << std::setw(24) << "" << std::right << std::setw(17) << "build" << std::setw(15) << "memory"
+              << std::setw(17) << "time: mean" << std::setw(15) << "p99" << std::setw(17) << "distance: mean" << std::setw(15) << "p99\n";
+    PrintRow("Dijkstra"sv, dijkstra_build_ms, dijkstra.GetMemoryUsage(), dijkstra_time, dijkstra_distance);
+    if (stop_count > hierarchy_limit) {
+        //Без иерархий на городе такого размера пути ищет только Дейкстра, и это его время, а не время иерархий
+        std::cout << "ContractionHierarchy: not built, more than " << hierarchy_limit << " stops (--hierarchy-limit); "
+                  << "routes at this size are answered by Dijkstra only: " << std::fixed << std::setprecision(1)
+                  << dijkstra_time.mean_us / 1000 << " ms mean by time\n"
+                  << std::endl;
+        return 0;
+    }
+
+    settings.contraction_hierarchies = true;
+    start = Clock::now();
+    const router::TransportRouter hierarchies(db, settings, thread_count);
+    const double hierarchy_build_ms = ElapsedMilliseconds(start);
+    size_t shortcut_count = 0;
+    for (const router::ContractionHierarchy& hierarchy : hierarchies.GetHierarchies()) {
+        shortcut_count += hierarchy.GetShortcutCount();
+    }
+
+    std::vector<RouteTotals> hierarchy_times;
+    std::vector<RouteTotals> hierarchy_distances;
+    const QueryStats hierarchy_time = MeasureQueries(hierarchies, queries, router::Metric::Time, hierarchy_times);
+    const QueryStats hierarchy_distance = MeasureQueries(hierarchies, queries, router::Metric::Distance, hierarchy_distances);
+    PrintRow("ContractionHierarchy"sv, hierarchy_build_ms, hierarchies.GetMemoryUsage(), hierarchy_time, hierarchy_distance);
+    const size_t mismatches = CountMismatches(dijkstra_times, hierarchy_times) + CountMismatches(dijkstra_distances, hierarchy_distances);
+    std::cout << "shortcuts (both metrics): " << shortcut_count << ", queries: " << queries.size() << " (Dijkstra: " << dijkstra_queries.size()
+              << "), found: " << hierarchy_time.found << ", speedup: " << std::setprecision(0) << dijkstra_time.mean_us / hierarchy_time.mean_us
+              << "x time, " << dijkstra_distance.mean_us / hierarchy_distance.mean_us << "x distance, mismatches: " << mismatches << '\n'
+              << std::endl;
+    return mismatches;
+}
+
+void PrintUsage() {
+    std::cerr << "Usage: routing_bench [--stops N[,N...]] [--queries N] [--dijkstra-queries N] [--route-length N] [--hierarchy-limit N]\n"
+                 "                     [--seed N] [--threads N]\n";
+}
+
+}  // namespace
+
+// Сравнение поиска путей алгоритмом Дейкстры и по иерархиям сжатия на синтетических городах нескольких размеров:
+// время построения, память и задержка запросов по времени и по расстоянию. Маршрутов в десять раз меньше, чем остановок.
+// Предобработка растёт быстрее размера города, поэтому иерархии строятся только для городов не больше --hierarchy-limit остановок.
+// Ответы иерархий сверяются с Дейкстрой по времени и расстоянию пути; при расхождении код возврата - 2.
+// Запуск: routing_bench [--stops N[,N...]] [--queries N] [--dijkstra-queries N] [--route-length N] [--hierarchy-limit N]
+//                       [--seed N] [--threads N]
+int main(int argc, char* argv[]) {
+    std::vector<int> stop_counts{10000, 100000, 1000000};
+    city_generator::CitySettings params;
+    params.min_route_length = params.max_route_length = 20;
+    size_t query_count = 1000;
+    size_t dijkstra_query_count = 100;
+    int hierarchy_limit = 100000;
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        const std::string_view option = argv[i];
+        const char* value = argv[++i];
+        if (option == "--stops"sv) {
+            stop_counts.clear();
+            std::istringstream list(value);
+            for (std::string count; std::getline(list, count, ',');) {
+                stop_counts.push_back(std::max(2, std::stoi(count)));
+            }
+        } else if (option == "--queries"sv) {
+            query_count = std::max(1, std::stoi(value));
+        } else if (option == "--dijkstra-queries"sv) {
+            dijkstra_query_count = std::max(1, std::stoi(value));
+        } else if (option == "--route-length"sv) {
+            params.min_route_length = params.max_route_length = std::max(2, std::stoi(value));
+        } else if (option == "--hierarchy-limit"sv) {
+            hierarchy_limit = std::max(0, std::stoi(value));
+        } else if (option == "--seed"sv) {
+            params.seed = static_cast<uint32_t>(std::stoul(value));
+        } else if (option == "--threads"sv) {
+            thread_count = std::max(1, std::stoi(value));
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::cout << "threads: " << thread_count << ", route length: " << params.min_route_length << "\n\n";
+    size_t mismatches = 0;
+    for (int stop_count : stop_counts) {
+        mismatches += RunSize(stop_count, params, query_count, dijkstra_query_count, hierarchy_limit, thread_count);
+    }
+    return mismatches == 0 ? 0 : 2;
+}
@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../json.h"
+#include "../json_reader.h"
+#include "../map_renderer.h"
+#include "../request_handler.h"
+#include "../svg.h"
+#include "../transport_catalogue.h"
+#include "../transport_router.h"
+#include "../versioned_catalogue.h"
+#include "../tools/city_generator.h"
+
+using namespace std::literals;
+
+// Счётчики выделений памяти: глобальный operator new заменён на время работы бенчмарка
+namespace {
+std::atomic<size_t> allocation_count{0};
+std::atomic<size_t> allocated_bytes{0};
+// Сюда записываются результаты вычислений, чтобы компилятор их не отбросил
+volatile double benchmark_sink = 0;
+}  // namespace
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+//Память из заменённого operator new выделена malloc, поэтому освобождается free. GCC не видит, что обе
+//функции заменены вместе, и считает free для указателя из operator new ошибкой (-Wmismatched-new-delete)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+// Поток, который отбрасывает вывод: измеряется только форматирование, без роста строки
+class NullBuffer final : public std::streambuf {
+   protected:
+    int overflow(int c) override {
+        return c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        return count;
+    }
+};
+
+// Синтетический город в виде JSON-документа с base_requests и render_settings
+std::string MakeCity(const city_generator::City& city) {
+    std::ostringstream out;
+    json::Writer writer(out);
+    writer.StartDict().Key("base_requests"sv);
+    city_generator::WriteBaseRequests(city, writer);
+    writer.Key("render_settings"sv);
+    city_generator::WriteRenderSettings(writer);
+    writer.Key("stat_requests"sv).StartArray().EndArray();
+    writer.EndDict();
+    return out.str();
+}
+
+// Запускает function, пока суммарное время не превысит min_time (но не меньше двух раз),
+// и выводит время, число выделений памяти и выделенные байты в расчёте на одну операцию.
+// За один вызов function выполняется ops_per_call операций
+template <typename Function>
+void Run(std::string_view name, size_t ops_per_call, std::chrono::duration<double> min_time, Function function) {
+    using Clock = std::chrono::steady_clock;
+    function();  // прогрев
+
+    size_t calls = 0;
+    const size_t start_allocations = allocation_count.load(std::memory_order_relaxed);
+    const size_t start_bytes = allocated_bytes.load(std::memory_order_relaxed);
+    const auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    while (calls < 2 || elapsed < min_time) {
+        function();
+        ++calls;
+        elapsed = Clock::now() - start;
+    }
+    const double ops = static_cast<double>(calls * ops_per_call);
+    const double allocations = static_cast<double>(allocation_count.load(std::memory_order_relaxed) - start_allocations);
+    const double bytes = static_cast<double>(allocated_bytes.load(std::memory_order_relaxed) - start_bytes);
+
+    std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << std::chrono::duration<double, std::nano>(elapsed).count() / ops << " ns/op"
+              << std::setw(14) << allocations / ops << " allocs/op"
+              << std::setw(16) << bytes / ops << " B/op\n";
+}
+
+void PrintUsage() {
+    std::cerr << "Usage: transport_catalogue_bench [--stops N] [--buses N] [--route-length N] [--seed N] [--min-time SECONDS]\n";
+}
+
+}  // namespace
+
+// Микробенчмарки разбора, построения справочника, запросов и отрисовки карты на синтетическом городе.
+// Запуск: transport_catalogue_bench [--stops N] [--buses N] [--route-length N] [--seed N] [--min-time SECONDS]
+int main(int argc, char* argv[]) {
+    city_generator::CitySettings params;
+    params.stop_count = 10000;
+    params.bus_count = 1000;
+    params.min_route_length = params.max_route_length = 20;
+    double min_time = 1.0;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        const std::string_view option = argv[i];
+        const char* value = argv[++i];
+        if (option == "--stops"sv) {
+            params.stop_count = std::max(2, std::stoi(value));
+        } else if (option == "--buses"sv) {
+            params.bus_count = std::max(1, std::stoi(value));
+        } else if (option == "--route-length"sv) {
+            params.min_route_length = params.max_route_length = std::max(2, std::stoi(value));
+        } else if (option == "--seed"sv) {
+            params.seed = static_cast<uint32_t>(std::stoul(value));
+        } else if (option == "--min-time"sv) {
+            min_time = std::stod(value);
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    const std::chrono::duration<double> duration(min_time);
+
+    const city_generator::City city = city_generator::GenerateCity(params);
+    const std::string text = MakeCity(city);
+    std::cout << "stops: " << params.stop_count << ", buses: " << params.bus_count << ", route length: " << params.min_route_length
+              << ", input: " << text.size() / 1024 << " KB, geo: " << geo::GetPathLengthImplementationName() << '\n';
+
+    NullBuffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+
+    const json::Document document = json::Load(text);
+    Run("json::Load"sv, 1, duration, [&] {
+        json::Load(text);
+    });
+    Run("json::Print"sv, 1, duration, [&] {
+        json::Print(document, null_stream);
+    });
+
+    std::istringstream input(text);
+    const json_reader::JsonReader reader(input);
+    Run("JsonReader::FillDataBase"sv, 1, duration, [&] {
+        transport_catalogue::TransportCatalogue db;
+        reader.FillDataBase(db);
+    });
+
+    transport_catalogue::TransportCatalogue db;
+    reader.FillDataBase(db);
+    renderer::MapRenderer map_renderer;
+    map_renderer.SetRenderSettings(reader.GetRenderSettings());
+    const RequestHandler handler(db, map_renderer);
+
+    std::vector<std::string> bus_names;
+    for (const city_generator::Bus& bus : city.buses) {
+        bus_names.push_back(bus.name);
+    }
+    std::vector<std::string> stop_names;
+    for (const city_generator::Stop& stop : city.stops) {
+        stop_names.push_back(stop.name);
+    }
+
+    Run("RequestHandler::GetBusStat"sv, bus_names.size(), duration, [&] {
+        for (const std::string& name : bus_names) {
+            handler.GetBusStat(name);
+        }
+    });
+    Run("RequestHandler::GetBusesByStop"sv, stop_names.size(), duration, [&] {
+        for (const std::string& name : stop_names) {
+            handler.GetBusesByStop(name);
+        }
+    });
+    //Ответы целиком: запись через json::Writer и копирование заранее записанных ответов
+    std::vector<json_reader::StatRequest> answer_requests;
+    auto add_request = [&answer_requests](json_reader::TypeRequest type, std::string_view name) {
+        json_reader::StatRequest request;
+        request.id = 0;
+        request.type = type;
+        request.name = name;
+        answer_requests.push_back(request);
+    };
+    for (const std::string& name : bus_names) {
+        add_request(json_reader::TypeRequest::Bus, name);
+    }
+    for (const std::string& name : stop_names) {
+        add_request(json_reader::TypeRequest::Stop, name);
+    }
+    Run("json_reader::WriteResponse (Bus+Stop)"sv, answer_requests.size(), duration, [&] {
+        for (const json_reader::StatRequest& request : answer_requests) {
+            json::Writer writer(null_stream, true);
+            json_reader::WriteResponse(db, request, handler, writer);
+        }
+    });
+    Run("MaterializedAnswers (build)"sv, 1, duration, [&] {
+        json_reader::MaterializedAnswers(db, handler, true);
+    });
+    const json_reader::MaterializedAnswers answers(db, handler, true);
+    Run("MaterializedAnswers::Write (Bus+Stop)"sv, answer_requests.size(), duration, [&] {
+        for (const json_reader::StatRequest& request : answer_requests) {
+            json::Writer writer(null_stream, true);
+            answers.Write(request, writer);
+        }
+    });
+    std::cout << "materialized answers: " << answers.GetAnswerCount() << ", " << answers.GetMemoryUsage() / 1024 << " KB\n";
+    //Поиск по координатам: точки рядом с остановками
+    Run("RequestHandler::GetNearestStops (10)"sv, city.stops.size(), duration, [&] {
+        for (const city_generator::Stop& stop : city.stops) {
+            handler.GetNearestStops({stop.coordinates.lat + 1e-3, stop.coordinates.lng + 1e-3}, 10);
+        }
+    });
+    Run("RequestHandler::GetStopsInRadius (1 km)"sv, city.stops.size(), duration, [&] {
+        for (const city_generator::Stop& stop : city.stops) {
+            handler.GetStopsInRadius(stop.coordinates, 1000);
+        }
+    });
+    Run("RequestHandler::GetStopsInBox"sv, city.stops.size(), duration, [&] {
+        for (const city_generator::Stop& stop : city.stops) {
+            const geo::Coordinates point = stop.coordinates;
+            handler.GetStopsInBox({{point.lat - 0.01, point.lng - 0.01}, {point.lat + 0.01, point.lng + 0.01}});
+        }
+    });
+    //Географическая длина маршрутов: по отрезкам через ComputeDistance и одним вызовом ComputePathLength
+    Run("geo::ComputeDistance (route)"sv, city.buses.size(), duration, [&] {
+        double length = 0;
+        for (domain::BusId bus = 0; bus < city.buses.size(); ++bus) {
+            const domain::Span<domain::StopId> route = db.GetRoute(bus);
+            for (size_t i = 0; i + 1 < route.size(); ++i) {
+                length += geo::ComputeDistance(db.GetStopCoordinates(route[i]), db.GetStopCoordinates(route[i + 1]));
+            }
+        }
+        benchmark_sink = length;
+    });
+    Run("TransportCatalogue::GetCurvature"sv, city.buses.size(), duration, [&] {
+        double curvature = 0;
+        for (domain::BusId bus = 0; bus < city.buses.size(); ++bus) {
+            curvature += db.GetCurvature(bus, 1);
+        }
+        benchmark_sink = curvature;
+    });
+    Run("RequestHandler::RenderMap"sv, 1, duration, [&] {
+        handler.RenderMap();
+    });
+    const svg::Document map = handler.RenderMap();
+    Run("svg::Document::Render"sv, 1, duration, [&] {
+        map.Render(null_stream);
+    });
+
+    //Изменения на ходу: остановки сдвигаются туда и обратно, маршруты меняют направление
+    bool shifted = false;
+    Run("TransportCatalogue::SetStopCoordinates"sv, city.stops.size(), duration, [&] {
+        const double shift = shifted ? 0.0 : 1e-4;
+        for (domain::StopId stop = 0; stop < city.stops.size(); ++stop) {
+            const geo::Coordinates coordinates = city.stops[stop].coordinates;
+            db.SetStopCoordinates(stop, {coordinates.lat + shift, coordinates.lng + shift});
+        }
+        shifted = !shifted;
+    });
+    Run("TransportCatalogue::AddDistanceToStops"sv, city.stops.size(), duration, [&] {
+        for (domain::StopId stop = 0; stop < city.stops.size(); ++stop) {
+            for (const auto& [to, meters] : city.stops[stop].road_distances) {
+                db.AddDistanceToStops(stop, static_cast<domain::StopId>(to), meters);
+            }
+        }
+    });
+    std::vector<domain::StopId> route;
+    Run("TransportCatalogue::SetRoute"sv, city.buses.size(), duration, [&] {
+        for (domain::BusId bus = 0; bus < city.buses.size(); ++bus) {
+            const domain::Span<domain::StopId> current = db.GetRoute(bus);
+            route.assign(current.begin(), current.end());
+            std::reverse(route.begin(), route.end());
+            db.SetRoute(bus, route, db.GetBusType(bus));
+        }
+    });
+
+    //Поиск путей: граф строится один раз, запросы - между случайными остановками
+    const router::RoutingSettings routing_settings{6, 40};
+    Run("TransportRouter (build)"sv, 1, duration, [&] {
+        router::TransportRouter(db, routing_settings);
+    });
+    const router::TransportRouter transport_router(db, routing_settings);
+    std::cout << "router graph: " << transport_router.GetVertexCount() << " vertices, " << transport_router.GetEdgeCount() << " edges, "
+              << transport_router.GetMemoryUsage() / 1024 << " KB\n";
+    std::vector<std::pair<domain::StopId, domain::StopId>> route_queries;
+    std::mt19937 route_random(params.seed);
+    std::uniform_int_distribution<domain::StopId> random_stop(0, static_cast<domain::StopId>(db.GetStopCount() - 1));
+    for (size_t i = 0; i < 100; ++i) {
+        route_queries.emplace_back(random_stop(route_random), random_stop(route_random));
+    }
+    Run("TransportRouter::FindRoute"sv, route_queries.size(), duration, [&] {
+        for (const auto& [from, to] : route_queries) {
+            const std::optional<router::RouteInfo> route = transport_router.FindRoute(from, to);
+            benchmark_sink = benchmark_sink + (route ? route->total_time : 0);
+        }
+    });
+
+    //Версии: копия справочника разделяет с ним столбцы, изменение копирует только затронутые
+    transport_catalogue::VersionedCatalogue versioned(db, map_renderer);
+    Run("VersionedCatalogue::Read+GetBusStat"sv, bus_names.size(), duration, [&] {
+        for (const std::string& name : bus_names) {
+            const transport_catalogue::VersionedCatalogue::Snapshot version = versioned.Read();
+            version->GetHandler().GetBusStat(name);
+        }
+    });
+    domain::StopId moved_stop = 0;
+    Run("VersionedCatalogue::Modify"sv, 1, duration, [&] {
+        versioned.Modify([&](transport_catalogue::TransportCatalogue& version) {
+            version.SetStopCoordinates(moved_stop, city.stops[moved_stop].coordinates);
+        });
+        moved_stop = (moved_stop + 1) % city.stops.size();
+    });
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "catalogue_registry.h"
+
+#include <algorithm>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "json_reader.h"
+#include "thread_pool.h"
+
+namespace transport_catalogue {
+
+void CatalogueRegistry::Load(const std::vector<CitySource>& cities, size_t thread_count) {
+    std::vector<std::unique_ptr<City>> loaded(cities.size());
+    std::vector<std::string> errors(cities.size());
+    for (size_t i = 0; i < cities.size(); ++i) {
+        const bool repeated = std::any_of(cities.begin(), cities.begin() + i, [&](const CitySource& city) {
+            return city.key == cities[i].key;
+        });
+        if (repeated || cities_.count(cities[i].key) > 0) {
+            errors[i] = "city is already loaded";
+        }
+    }
+
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    {
+        concurrency::ThreadPool pool(std::min(thread_count, std::max<size_t>(cities.size(), 1)));
+        for (size_t i = 0; i < cities.size(); ++i) {
+            if (!errors[i].empty()) {
+                continue;
+            }
+            pool.Submit([&, i] {
+                try {
+                    TransportCatalogue db;
+                    renderer::RenderSettings render_settings;
+                    std::optional<router::RoutingSettings> routing_settings;
+                    std::shared_ptr<const router::TransportRouter> transport_router;
+                    json_reader::LoadBaseFile(cities[i].path, db, render_settings, routing_settings, transport_router);
+                    auto city = std::make_unique<City>();
+                    city->renderer.SetRenderSettings(render_settings);
+                    city->catalogue = std::make_unique<VersionedCatalogue>(std::move(db), city->renderer, routing_settings, std::move(transport_router));
+                    //Граф путей строится при загрузке, а не при первом запросе Route, если его не было в файле
+                    city->catalogue->Read()->GetHandler().GetRouter();
+                    loaded[i] = std::move(city);
+                } catch (const std::exception& e) {
+                    errors[i] = e.what();
+                }
+            });
+        }
+    }  // деструктор пула дожидается всех загрузок
+
+    std::string message;
+    for (size_t i = 0; i < cities.size(); ++i) {
+        if (loaded[i]) {
+            cities_.emplace(cities[i].key, std::move(loaded[i]));
+        } else {
+            message += (message.empty() ? "" : "; ") + cities[i].key + ": " + errors[i];
+        }
+    }
+    if (!message.empty()) {
+        throw std::runtime_error("Failed to load cities: " + message);
+    }
+}
+
+VersionedCatalogue* CatalogueRegistry::Find(std::string_view key) const {
+    const auto it = cities_.find(key);
+    return it == cities_.end() ? nullptr : it->second->catalogue.get();
+}
+
+std::vector<CatalogueRegistry::CityInfo> CatalogueRegistry::GetCities() const {
+    std::vector<CityInfo> result;
+    result.reserve(cities_.size());
+    for (const auto& [key, city] : cities_) {
+        const VersionedCatalogue::Snapshot version = city->catalogue->Read();
+        const TransportCatalogue& db = version->GetCatalogue();
+        result.push_back({key, version->GetNumber(), db.GetStopCount(), db.GetBusCount(), db.GetMemoryUsage()});
+    }
+    return result;
+}
+
+}  // namespace transport_catalogue
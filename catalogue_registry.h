@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "map_renderer.h"
+#include "versioned_catalogue.h"
+
+/*
+ * Справочники нескольких городов в одном процессе. Каждый город - независимый справочник
+ * с версиями и своими настройками отрисовки; запросы направляются в город по ключу.
+ * Города загружаются параллельно, а отвечать на запросы к разным городам могут одни и те же потоки
+ */
+namespace transport_catalogue {
+
+class CatalogueRegistry {
+   public:
+    struct CitySource {
+        std::string key;
+        std::string path;  // файл базы: JSON с base_requests, render_settings и routing_settings или файл make_base
+    };
+
+    struct CityInfo {
+        std::string_view key;
+        uint64_t version;
+        size_t stop_count;
+        size_t bus_count;
+        size_t memory_usage;  // TransportCatalogue::GetMemoryUsage текущей версии
+    };
+
+    CatalogueRegistry() = default;
+    CatalogueRegistry(const CatalogueRegistry&) = delete;
+    CatalogueRegistry& operator=(const CatalogueRegistry&) = delete;
+
+    // Загружает города не больше чем в thread_count потоков (0 - по числу аппаратных потоков).
+    // Если какой-то город не загрузился или его ключ уже занят, бросает std::runtime_error
+    // с ключами и причинами, а остальные города добавляет. Вызывается, пока к справочникам нет запросов
+    void Load(const std::vector<CitySource>& cities, size_t thread_count = 0);
+
+    // Справочник города или nullptr. Запросы без ключа направляются в город с пустым ключом
+    VersionedCatalogue* Find(std::string_view key) const;
+
+    // Города по возрастанию ключа
+    std::vector<CityInfo> GetCities() const;
+
+    size_t GetCityCount() const {
+        return cities_.size();
+    }
+
+   private:
+    struct City {
+        renderer::MapRenderer renderer;
+        std::unique_ptr<VersionedCatalogue> catalogue;
+    };
+
+    std::map<std::string, std::unique_ptr<City>, std::less<>> cities_;
+};
+
+}  // namespace transport_catalogue
@@ -0,0 +1,546 @@
+#include "contraction_hierarchy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace router {
+
+namespace {
+
+// Поиск свидетеля останавливается, просмотрев столько рёбер: если свидетель не найден, добавляется сокращение,
+// возможно лишнее. При сжатии предел почти не ограничивает поиск: лишние сокращения уплотняют оставшийся граф,
+// и следующие поиски становятся только дороже. Для оценки приоритета хватает меньшей точности,
+// а пересчитывается он чаще, чем сжимаются вершины
+constexpr size_t WITNESS_SCAN_LIMIT = 1000000;
+constexpr size_t PRIORITY_SCAN_LIMIT = 1000;
+
+using Edge = ContractionHierarchy::Edge;
+
+struct Shortcut {
+    uint32_t from;
+    uint32_t to;
+    uint32_t middle;
+    double weight;
+};
+
+// Вызывает function(worker, i) для всех i из [0, count) в thread_count потоках, worker - номер потока.
+// Как concurrency::ParallelFor, но с номером потока для его рабочих массивов
+template <typename Function>
+void ForEachParallel(size_t count, size_t thread_count, Function function) {
+    constexpr size_t CHUNK_SIZE = 64;
+    thread_count = std::min(std::max<size_t>(thread_count, 1), (count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    std::atomic<size_t> next{0};
+    auto work = [&](size_t worker) {
+        for (size_t begin = next.fetch_add(CHUNK_SIZE); begin < count; begin = next.fetch_add(CHUNK_SIZE)) {
+            const size_t end = std::min(begin + CHUNK_SIZE, count);
+            for (size_t i = begin; i < end; ++i) {
+                function(worker, i);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t worker = 1; worker < thread_count; ++worker) {
+        threads.emplace_back(work, worker);
+    }
+    work(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// Расстояния одного поиска. Вершина считается достигнутой, только если её метка равна текущему поколению,
+// поэтому между поисками массивы не очищаются
+struct DistanceLabels {
+    std::vector<double> distances;
+    std::vector<uint32_t> generations;
+    uint32_t generation = 0;
+    std::vector<std::pair<double, uint32_t>> heap;
+
+    void Prepare(size_t vertex_count) {
+        if (generations.size() < vertex_count) {
+            distances.resize(vertex_count);
+            generations.resize(vertex_count, 0);
+        }
+        if (++generation == 0) {
+            std::fill(generations.begin(), generations.end(), 0);
+            generation = 1;
+        }
+        heap.clear();
+    }
+
+    bool IsReached(uint32_t vertex) const {
+        return generations[vertex] == generation;
+    }
+
+    void Reach(uint32_t vertex, double distance) {
+        generations[vertex] = generation;
+        distances[vertex] = distance;
+        heap.emplace_back(distance, vertex);
+        std::push_heap(heap.begin(), heap.end(), std::greater<>{});
+    }
+
+    std::pair<double, uint32_t> Pop() {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<>{});
+        const std::pair<double, uint32_t> top = heap.back();
+        heap.pop_back();
+        return top;
+    }
+};
+
+// Рабочие массивы поиска свидетелей одного потока: метка в targets равна поколению поиска у соседей,
+// до которых ищется путь, чтобы остановиться, как только все они найдены
+struct WitnessScratch {
+    DistanceLabels labels;
+    std::vector<uint32_t> targets;
+    std::vector<double> bounds;  // длина пути через сжимаемую вершину до соседа
+};
+
+// Состояние предобработки: граф из ещё не сжатых вершин. Списки сжатой вершины больше не меняются
+// и становятся её рёбрами в иерархии
+class HierarchyBuilder {
+   public:
+    HierarchyBuilder(const domain::FlatLists<ContractionHierarchy::Arc>& graph, size_t thread_count)
+        : vertex_count_(graph.size()),
+          thread_count_(std::max<size_t>(thread_count, 1)),
+          out_(vertex_count_),
+          in_(vertex_count_),
+          contracted_(vertex_count_, 0),
+          selected_(vertex_count_, 0),
+          stale_(vertex_count_, 0),
+          priorities_(vertex_count_, 0),
+          deleted_neighbors_(vertex_count_, 0),
+          levels_(vertex_count_, 0),
+          ranks_(vertex_count_, 0),
+          workers_(thread_count_) {
+        for (uint32_t from = 0; from < vertex_count_; ++from) {
+            for (const ContractionHierarchy::Arc& arc : graph[from]) {
+                if (arc.to != from) {
+                    AddEdge(from, arc.to, ContractionHierarchy::NO_VERTEX, arc.weight);
+                }
+            }
+        }
+    }
+
+    void Contract() {
+        ForEachParallel(vertex_count_, thread_count_, [this](size_t worker, size_t vertex) {
+            priorities_[vertex] = ComputePriority(workers_[worker], static_cast<uint32_t>(vertex));
+        });
+
+        std::vector<uint32_t> remaining(vertex_count_);
+        std::iota(remaining.begin(), remaining.end(), 0);
+        std::vector<uint32_t> chosen;
+        std::vector<std::vector<Shortcut>> shortcuts;
+        uint32_t next_rank = 0;
+        while (!remaining.empty()) {
+            //Кандидаты - вершины с приоритетом меньше, чем у всех соседей: они попарно не соседние.
+            //Устаревший приоритет кандидата пересчитывается, и сжимаются те, кто остался меньше соседей
+            ForEachParallel(remaining.size(), thread_count_, [&](size_t, size_t i) {
+                selected_[remaining[i]] = IsLocalMinimum(remaining[i]);
+            });
+            chosen.clear();
+            for (uint32_t vertex : remaining) {
+                if (selected_[vertex]) {
+                    chosen.push_back(vertex);
+                    selected_[vertex] = 0;
+                }
+            }
+            ForEachParallel(chosen.size(), thread_count_, [&](size_t worker, size_t i) {
+                if (stale_[chosen[i]]) {
+                    priorities_[chosen[i]] = ComputePriority(workers_[worker], chosen[i]);
+                    stale_[chosen[i]] = 0;
+                }
+            });
+            ForEachParallel(chosen.size(), thread_count_, [&](size_t, size_t i) {
+                selected_[chosen[i]] = IsLocalMinimum(chosen[i]);
+            });
+            chosen.erase(std::remove_if(chosen.begin(), chosen.end(), [this](uint32_t vertex) {
+                             return !selected_[vertex];
+                         }),
+                         chosen.end());
+
+            //Свидетели ищутся в обход всех выбранных вершин, поэтому сокращения разных вершин не зависят друг от друга
+            shortcuts.resize(std::max(shortcuts.size(), chosen.size()));
+            ForEachParallel(chosen.size(), thread_count_, [&](size_t worker, size_t i) {
+                shortcuts[i].clear();
+                FindShortcuts(workers_[worker], chosen[i], WITNESS_SCAN_LIMIT, &shortcuts[i]);
+            });
+
+            auto touch = [this](uint32_t neighbor, uint32_t vertex) {
+                ++deleted_neighbors_[neighbor];
+                levels_[neighbor] = std::max(levels_[neighbor], levels_[vertex] + 1);
+                stale_[neighbor] = 1;
+            };
+            for (uint32_t vertex : chosen) {
+                ranks_[vertex] = next_rank++;
+                contracted_[vertex] = 1;
+                selected_[vertex] = 0;
+                for (const Edge& edge : out_[vertex]) {
+                    RemoveEdge(in_[edge.vertex], vertex);
+                    touch(edge.vertex, vertex);
+                }
+                for (const Edge& edge : in_[vertex]) {
+                    RemoveEdge(out_[edge.vertex], vertex);
+                    touch(edge.vertex, vertex);
+                }
+            }
+            for (size_t i = 0; i < chosen.size(); ++i) {
+                for (const Shortcut& shortcut : shortcuts[i]) {
+                    AddEdge(shortcut.from, shortcut.to, shortcut.middle, shortcut.weight);
+                }
+            }
+            remaining.erase(std::remove_if(remaining.begin(), remaining.end(), [this](uint32_t vertex) {
+                                return contracted_[vertex] != 0;
+                            }),
+                            remaining.end());
+        }
+    }
+
+    std::vector<uint32_t> TakeRanks() {
+        return std::move(ranks_);
+    }
+
+    // Списки вершин после сжатия: исходящие - рёбра вверх, входящие - рёбра вниз
+    domain::FlatLists<Edge> TakeEdges(bool upward) {
+        std::vector<std::vector<Edge>>& lists = upward ? out_ : in_;
+        size_t edge_count = 0;
+        for (const std::vector<Edge>& list : lists) {
+            edge_count += list.size();
+        }
+        domain::FlatLists<Edge> result;
+        result.Reserve(lists.size(), edge_count);
+        for (std::vector<Edge>& list : lists) {
+            result.Append(list.begin(), list.end());
+            std::vector<Edge>().swap(list);
+        }
+        return result;
+    }
+
+   private:
+    // Порядок сжатия: меньше - раньше. Приоритет - прирост рёбер, число уже сжатых соседей и глубина в иерархии,
+    // при равенстве - перемешанный номер, чтобы соседние вершины с одинаковым приоритетом не сжимались по очереди вдоль цепочки
+    bool IsBefore(uint32_t lhs, uint32_t rhs) const {
+        const auto key = [this](uint32_t vertex) {
+            return std::make_tuple(priorities_[vertex] + deleted_neighbors_[vertex] + levels_[vertex], vertex * 2654435761u, vertex);
+        };
+        return key(lhs) < key(rhs);
+    }
+
+    char IsLocalMinimum(uint32_t vertex) const {
+        for (const std::vector<Edge>* list : {&out_[vertex], &in_[vertex]}) {
+            for (const Edge& edge : *list) {
+                if (IsBefore(edge.vertex, vertex)) {
+                    return 0;
+                }
+            }
+        }
+        return 1;
+    }
+
+    // Ищет свидетелей от source в обход skipped и вершин, выбранных для сжатия: отмеченная вершина v
+    // нуждается в сокращении, если до неё нет пути не длиннее bounds[v]. Поиск заканчивается, когда для всех
+    // target_count отмеченных вершин ответ известен или просмотрено больше scan_limit рёбер.
+    // Возвращает, сколько отмеченных вершин осталось без свидетеля
+    size_t SearchWitnesses(WitnessScratch& scratch, uint32_t source, uint32_t skipped, double limit, size_t target_count,
+                           size_t scan_limit) const {
+        DistanceLabels& labels = scratch.labels;
+        labels.Reach(source, 0);
+        size_t scanned = 0;
+        while (!labels.heap.empty() && target_count > 0 && scanned <= scan_limit) {
+            const auto [distance, vertex] = labels.Pop();
+            if (distance > labels.distances[vertex]) {
+                continue;
+            }
+            for (const Edge& edge : out_[vertex]) {
+                if (edge.vertex == skipped || selected_[edge.vertex]) {
+                    continue;
+                }
+                const double next_distance = distance + edge.weight;
+                if (next_distance > limit || (labels.IsReached(edge.vertex) && next_distance >= labels.distances[edge.vertex])) {
+                    continue;
+                }
+                labels.Reach(edge.vertex, next_distance);
+                if (scratch.targets[edge.vertex] == labels.generation && next_distance <= scratch.bounds[edge.vertex]) {
+                    scratch.targets[edge.vertex] = 0;
+                    --target_count;
+                }
+            }
+            scanned += out_[vertex].size();
+        }
+        return target_count;
+    }
+
+    // Сокращения, которые нужны при сжатии vertex: путь сосед -> vertex -> сосед без свидетеля не длиннее.
+    // Возвращает их число, сами сокращения добавляет в shortcuts, если он задан
+    size_t FindShortcuts(WitnessScratch& scratch, uint32_t vertex, size_t scan_limit, std::vector<Shortcut>* shortcuts) const {
+        DistanceLabels& labels = scratch.labels;
+        if (scratch.targets.size() < vertex_count_) {
+            scratch.targets.resize(vertex_count_, 0);
+            scratch.bounds.resize(vertex_count_);
+        }
+        size_t count = 0;
+        for (const Edge& in : in_[vertex]) {
+            labels.Prepare(vertex_count_);
+            if (labels.generation == 1) {
+                //Поколения начались заново: старые метки могли бы совпасть с новыми
+                std::fill(scratch.targets.begin(), scratch.targets.end(), 0);
+            }
+            double limit = -1;
+            size_t target_count = 0;
+            for (const Edge& out : out_[vertex]) {
+                if (out.vertex != in.vertex) {
+                    limit = std::max(limit, in.weight + out.weight);
+                    scratch.targets[out.vertex] = labels.generation;
+                    scratch.bounds[out.vertex] = in.weight + out.weight;
+                    ++target_count;
+                }
+            }
+            if (target_count == 0 || SearchWitnesses(scratch, in.vertex, vertex, limit, target_count, scan_limit) == 0) {
+                continue;
+            }
+            for (const Edge& out : out_[vertex]) {
+                if (out.vertex == in.vertex || scratch.targets[out.vertex] != labels.generation) {
+                    continue;
+                }
+                ++count;
+                if (shortcuts != nullptr) {
+                    shortcuts->push_back({in.vertex, out.vertex, vertex, in.weight + out.weight});
+                }
+            }
+        }
+        return count;
+    }
+
+    // На сколько рёбер станет больше после сжатия vertex, сокращения считаются вдвойне
+    int64_t ComputePriority(WitnessScratch& scratch, uint32_t vertex) const {
+        const auto shortcut_count = static_cast<int64_t>(FindShortcuts(scratch, vertex, PRIORITY_SCAN_LIMIT, nullptr));
+        const auto edge_count = static_cast<int64_t>(in_[vertex].size() + out_[vertex].size());
+        return 2 * shortcut_count - edge_count;
+    }
+
+    // Добавляет ребро или укорачивает уже имеющееся между теми же вершинами
+    void AddEdge(uint32_t from, uint32_t to, uint32_t middle, double weight) {
+        std::vector<Edge>& out = out_[from];
+        const auto it = std::find_if(out.begin(), out.end(), [to](const Edge& edge) {
+            return edge.vertex == to;
+        });
+        if (it == out.end()) {
+            out.push_back({to, middle, weight});
+            in_[to].push_back({from, middle, weight});
+        } else if (weight < it->weight) {
+            *it = {to, middle, weight};
+            std::vector<Edge>& in = in_[to];
+            *std::find_if(in.begin(), in.end(), [from](const Edge& edge) {
+                return edge.vertex == from;
+            }) = {from, middle, weight};
+        }
+    }
+
+    static void RemoveEdge(std::vector<Edge>& list, uint32_t vertex) {
+        const auto it = std::find_if(list.begin(), list.end(), [vertex](const Edge& edge) {
+            return edge.vertex == vertex;
+        });
+        *it = list.back();
+        list.pop_back();
+    }
+
+    const size_t vertex_count_;
+    const size_t thread_count_;
+    std::vector<std::vector<Edge>> out_;
+    std::vector<std::vector<Edge>> in_;
+    std::vector<char> contracted_;
+    std::vector<char> selected_;
+    std::vector<char> stale_;  // соседи изменились после расчёта приоритета
+    std::vector<int64_t> priorities_;  // без числа сжатых соседей и глубины, они учитываются сразу
+    std::vector<int64_t> deleted_neighbors_;
+    std::vector<int64_t> levels_;
+    std::vector<uint32_t> ranks_;
+    std::vector<WitnessScratch> workers_;  // по номеру потока
+};
+
+// Ребро иерархии, которое осталось раскрыть в исходные
+struct PackedEdge {
+    uint32_t from;
+    uint32_t to;
+    uint32_t middle;
+};
+
+// Рабочие массивы запроса одного потока: прямой и обратный поиск
+struct QueryScratch {
+    struct Direction {
+        DistanceLabels labels;
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> middles;
+
+        void Prepare(size_t vertex_count) {
+            labels.Prepare(vertex_count);
+            parents.resize(labels.distances.size());
+            middles.resize(labels.distances.size());
+        }
+
+        void Reach(uint32_t vertex, double distance, uint32_t parent, uint32_t middle) {
+            labels.Reach(vertex, distance);
+            parents[vertex] = parent;
+            middles[vertex] = middle;
+        }
+    };
+
+    Direction forward;
+    Direction backward;
+    std::vector<PackedEdge> edges;
+    std::vector<PackedEdge> parts;
+    std::vector<uint32_t> positions;  // место вершины в пути, для удаления петель
+    std::vector<uint32_t> position_generations;
+    uint32_t position_generation = 0;
+};
+
+thread_local QueryScratch query_scratch;
+
+const Edge& FindEdge(domain::Span<Edge> edges, uint32_t vertex) {
+    return *std::find_if(edges.begin(), edges.end(), [vertex](const Edge& edge) {
+        return edge.vertex == vertex;
+    });
+}
+
+}  // namespace
+
+ContractionHierarchy::ContractionHierarchy(const domain::FlatLists<Arc>& graph, size_t thread_count) {
+    HierarchyBuilder builder(graph, thread_count);
+    builder.Contract();
+    ranks_ = builder.TakeRanks();
+    upward_ = builder.TakeEdges(true);
+    downward_ = builder.TakeEdges(false);
+}
+
+ContractionHierarchy::ContractionHierarchy(std::vector<uint32_t> ranks, domain::FlatLists<Edge> upward, domain::FlatLists<Edge> downward)
+    : ranks_(std::move(ranks)), upward_(std::move(upward)), downward_(std::move(downward)) {
+}
+
+size_t ContractionHierarchy::GetShortcutCount() const {
+    size_t count = 0;
+    for (size_t vertex = 0; vertex < upward_.size(); ++vertex) {
+        for (const Edge& edge : upward_[vertex]) {
+            count += edge.middle != NO_VERTEX;
+        }
+        for (const Edge& edge : downward_[vertex]) {
+            count += edge.middle != NO_VERTEX;
+        }
+    }
+    return count;
+}
+
+std::optional<double> ContractionHierarchy::FindPath(uint32_t from, uint32_t to, std::vector<uint32_t>& path) const {
+    path.clear();
+    if (from >= GetVertexCount() || to >= GetVertexCount()) {
+        return std::nullopt;
+    }
+    QueryScratch& scratch = query_scratch;
+    QueryScratch::Direction& forward = scratch.forward;
+    QueryScratch::Direction& backward = scratch.backward;
+    forward.Prepare(GetVertexCount());
+    backward.Prepare(GetVertexCount());
+    forward.Reach(from, 0, from, NO_VERTEX);
+    backward.Reach(to, 0, to, NO_VERTEX);
+
+    //Прямой поиск идёт по рёбрам вверх из from, обратный - по рёбрам вниз к to (в обратную сторону).
+    //Поиск прекращается, когда ближайшая вершина в обеих очередях не ближе лучшего найденного пути
+    double best = std::numeric_limits<double>::infinity();
+    uint32_t meeting = NO_VERTEX;
+    while (!forward.labels.heap.empty() || !backward.labels.heap.empty()) {
+        const bool is_forward = backward.labels.heap.empty()
+                                || (!forward.labels.heap.empty() && forward.labels.heap.front().first <= backward.labels.heap.front().first);
+        QueryScratch::Direction& current = is_forward ? forward : backward;
+        const QueryScratch::Direction& other = is_forward ? backward : forward;
+        if (current.labels.heap.front().first >= best) {
+            break;
+        }
+        const auto [distance, vertex] = current.labels.Pop();
+        if (distance > current.labels.distances[vertex]) {
+            continue;
+        }
+        if (other.labels.IsReached(vertex) && distance + other.labels.distances[vertex] < best) {
+            best = distance + other.labels.distances[vertex];
+            meeting = vertex;
+        }
+        //Вершина не продолжает поиск, если до неё короче через вершину большего ранга: её расстояние не кратчайшее
+        const domain::FlatLists<Edge>& edges = is_forward ? upward_ : downward_;
+        const domain::FlatLists<Edge>& reverse_edges = is_forward ? downward_ : upward_;
+        const domain::Span<Edge> reverse = reverse_edges[vertex];
+        const bool stalled = std::any_of(reverse.begin(), reverse.end(), [&](const Edge& edge) {
+            return current.labels.IsReached(edge.vertex) && current.labels.distances[edge.vertex] + edge.weight < distance;
+        });
+        if (stalled) {
+            continue;
+        }
+        for (const Edge& edge : edges[vertex]) {
+            const double next_distance = distance + edge.weight;
+            if (!current.labels.IsReached(edge.vertex) || next_distance < current.labels.distances[edge.vertex]) {
+                current.Reach(edge.vertex, next_distance, vertex, edge.middle);
+            }
+        }
+    }
+    if (meeting == NO_VERTEX) {
+        return std::nullopt;
+    }
+
+    //Рёбра прямого поиска собираются от места встречи назад, поэтому раскрываются в обратном порядке
+    scratch.edges.clear();
+    for (uint32_t vertex = meeting; vertex != from; vertex = forward.parents[vertex]) {
+        scratch.edges.push_back({forward.parents[vertex], vertex, forward.middles[vertex]});
+    }
+    std::reverse(scratch.edges.begin(), scratch.edges.end());
+    for (uint32_t vertex = meeting; vertex != to; vertex = backward.parents[vertex]) {
+        scratch.edges.push_back({vertex, backward.parents[vertex], backward.middles[vertex]});
+    }
+    path.push_back(from);
+    for (const PackedEdge& edge : scratch.edges) {
+        Unpack(edge.from, edge.to, edge.middle, path);
+    }
+
+    //При рёбрах нулевого веса путь может пройти по петле нулевой длины: петли вырезаются
+    if (scratch.position_generations.size() < GetVertexCount()) {
+        scratch.positions.resize(GetVertexCount());
+        scratch.position_generations.resize(GetVertexCount(), 0);
+    }
+    if (++scratch.position_generation == 0) {
+        std::fill(scratch.position_generations.begin(), scratch.position_generations.end(), 0);
+        scratch.position_generation = 1;
+    }
+    size_t length = 0;
+    for (uint32_t vertex : path) {
+        const uint32_t position = scratch.positions[vertex];
+        if (scratch.position_generations[vertex] == scratch.position_generation && position < length && path[position] == vertex) {
+            length = position + 1;
+            continue;
+        }
+        scratch.position_generations[vertex] = scratch.position_generation;
+        scratch.positions[vertex] = static_cast<uint32_t>(length);
+        path[length++] = vertex;
+    }
+    path.resize(length);
+    return best;
+}
+
+void ContractionHierarchy::Unpack(uint32_t from, uint32_t to, uint32_t middle, std::vector<uint32_t>& path) const {
+    //Ребро from -> to через middle - это ребро from -> middle из списка вниз middle и ребро middle -> to из списка вверх
+    std::vector<PackedEdge>& parts = query_scratch.parts;
+    parts.assign(1, {from, to, middle});
+    while (!parts.empty()) {
+        const PackedEdge part = parts.back();
+        parts.pop_back();
+        if (part.middle == NO_VERTEX) {
+            path.push_back(part.to);
+            continue;
+        }
+        const Edge& second = FindEdge(upward_[part.middle], part.to);
+        const Edge& first = FindEdge(downward_[part.middle], part.from);
+        parts.push_back({part.middle, part.to, second.middle});
+        parts.push_back({part.from, part.middle, first.middle});
+    }
+}
+
+}  // namespace router
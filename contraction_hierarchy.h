@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "domain.h"
+
+/*
+ * Иерархия сжатия (contraction hierarchies) для быстрого поиска кратчайших путей во взвешенном
+ * ориентированном графе. Предобработка по очереди сжимает вершины: вершина убирается из графа, а между
+ * её соседями добавляются рёбра-сокращения там, где кратчайший путь шёл только через неё.
+ * Порядок сжатия задаёт ранг вершины. Запрос - двунаправленная Дейкстра только по рёбрам к вершинам
+ * большего ранга (прямая из начала, обратная из конца), найденный путь распаковывается в исходные рёбра.
+ * За один шаг сжимается независимое множество вершин (никакие две не соседние), поэтому поиск
+ * свидетелей и пересчёт приоритетов идут параллельно, а результат не зависит от числа потоков
+ */
+namespace router {
+
+class ContractionHierarchy {
+   public:
+    static constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+    // Ребро исходного графа, вес неотрицательный
+    struct Arc {
+        uint32_t to;
+        double weight;
+    };
+
+    // Ребро иерархии между vertex и вершиной меньшего ранга, которой принадлежит список.
+    // middle - вершина сокращения (ранг меньше обоих концов) или NO_VERTEX для исходного ребра
+    struct Edge {
+        uint32_t vertex;
+        uint32_t middle;
+        double weight;
+    };
+
+    ContractionHierarchy() = default;
+    // Предобработка графа, graph[v] - рёбра из v. Параллельные рёбра сводятся к самому короткому, петли отбрасываются
+    ContractionHierarchy(const domain::FlatLists<Arc>& graph, size_t thread_count);
+    // Готовая иерархия, например из файла: upward[v] - рёбра v -> vertex, downward[v] - рёбра vertex -> v.
+    // Корректность (ранги концов и наличие половин сокращений) проверяет вызывающий
+    ContractionHierarchy(std::vector<uint32_t> ranks, domain::FlatLists<Edge> upward, domain::FlatLists<Edge> downward);
+
+    // Длина кратчайшего пути from -> to и его вершины от from до to включительно в path или nullopt, если пути нет.
+    // Можно вызывать из нескольких потоков одновременно: рабочие массивы поиска свои у каждого потока
+    std::optional<double> FindPath(uint32_t from, uint32_t to, std::vector<uint32_t>& path) const;
+
+    size_t GetVertexCount() const {
+        return ranks_.size();
+    }
+    // Рёбра иерархии: исходные и сокращения
+    size_t GetEdgeCount() const {
+        return upward_.GetItemCount() + downward_.GetItemCount();
+    }
+    size_t GetShortcutCount() const;
+    size_t GetMemoryUsage() const {
+        return ranks_.capacity() * sizeof(uint32_t) + upward_.GetMemoryUsage() + downward_.GetMemoryUsage();
+    }
+
+    const std::vector<uint32_t>& GetRanks() const {
+        return ranks_;
+    }
+    const domain::FlatLists<Edge>& GetUpward() const {
+        return upward_;
+    }
+    const domain::FlatLists<Edge>& GetDownward() const {
+        return downward_;
+    }
+
+   private:
+    // Добавляет в path вершины ребра from -> to без from, раскрывая сокращения
+    void Unpack(uint32_t from, uint32_t to, uint32_t middle, std::vector<uint32_t>& path) const;
+
+    std::vector<uint32_t> ranks_;  // порядок сжатия вершин
+    domain::FlatLists<Edge> upward_;
+    domain::FlatLists<Edge> downward_;
+};
+
+}  // namespace router
@@ -1,5 +1,14 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "geo.h"
@@ -14,19 +23,18 @@ struct Route {
     TypeRoute type;
 };
 
-struct Stop {
-    std::string name;
-    geo::Coordinates coord;
-};
-struct Bus {
-    std::string name;
-    TypeRoute type;
-    std::vector<const Stop*> route;
+// Остановки и маршруты нумеруются подряд с нуля в порядке добавления в справочник
+using StopId = uint32_t;
+using BusId = uint32_t;
+
+struct StopsDistance {
+    StopId from;
+    StopId to;
+    int distance;
 };
-struct StopPairHasher {
-    size_t operator()(std::pair<const Stop*, const Stop*> stops) const {
-        return std::hash<const void*>()(stops.first) ^ std::hash<const void*>()(stops.second);
-    }
+struct NearbyStop {
+    StopId stop;
+    double distance;  // метры по поверхности Земли
 };
 struct BusStat {
     double curvature;
@@ -34,5 +42,423 @@ struct BusStat {
     int stop_count;
     int unique_stop_count;
 };
-typedef  const Bus* BusPtr;
-}  // namespace domain
\ No newline at end of file
+
+// Непрерывный диапазон элементов, которыми владеет другой контейнер
+template <typename T>
+class Span {
+   public:
+    Span() = default;
+    Span(const T* begin, const T* end)
+        : begin_(begin), end_(end) {
+    }
+    Span(const std::vector<T>& items)
+        : begin_(items.data()), end_(items.data() + items.size()) {
+    }
+
+    const T* begin() const {
+        return begin_;
+    }
+    const T* end() const {
+        return end_;
+    }
+    size_t size() const {
+        return end_ - begin_;
+    }
+    bool empty() const {
+        return begin_ == end_;
+    }
+    const T& operator[](size_t index) const {
+        return begin_[index];
+    }
+    const T& front() const {
+        return *begin_;
+    }
+    const T& back() const {
+        return *(end_ - 1);
+    }
+
+   private:
+    const T* begin_ = nullptr;
+    const T* end_ = nullptr;
+};
+
+// Списки переменной длины, уложенные в один массив (CSR):
+// элементы списка i лежат в items[ranges[i].begin, ranges[i].end).
+// Заменённый список, который не помещается на прежнее место, дописывается в конец массива.
+// Освободившееся место собирается, когда его становится больше половины массива
+template <typename T>
+class FlatLists {
+    struct Range {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+   public:
+    // Списки без владения. Действительны до следующего изменения контейнера
+    class View {
+       public:
+        Span<T> operator[](size_t index) const {
+            const Range range = ranges_[index];
+            return {items_ + range.begin, items_ + range.end};
+        }
+
+       private:
+        friend class FlatLists;
+        View(const Range* ranges, const T* items)
+            : ranges_(ranges), items_(items) {
+        }
+
+        const Range* ranges_ = nullptr;
+        const T* items_ = nullptr;
+    };
+
+    size_t size() const {
+        return ranges_.size();
+    }
+    Span<T> operator[](size_t index) const {
+        const Range range = ranges_[index];
+        return {items_.data() + range.begin, items_.data() + range.end};
+    }
+    View GetView() const {
+        return {ranges_.data(), items_.data()};
+    }
+
+    // Добавляет список в конец
+    template <typename InputIt>
+    void Append(InputIt begin, InputIt end) {
+        const auto start = static_cast<uint32_t>(items_.size());
+        items_.insert(items_.end(), begin, end);
+        ranges_.push_back({start, static_cast<uint32_t>(items_.size())});
+    }
+    // Заменяет список index. Новые элементы не должны лежать в этом же контейнере.
+    // Span, полученные раньше, становятся недействительными
+    template <typename InputIt>
+    void Replace(size_t index, InputIt begin, InputIt end) {
+        Range& range = ranges_[index];
+        const size_t old_size = range.end - range.begin;
+        const auto new_size = static_cast<size_t>(std::distance(begin, end));
+        if (new_size <= old_size) {
+            std::copy(begin, end, items_.begin() + range.begin);
+            range.end = range.begin + static_cast<uint32_t>(new_size);
+            unused_ += old_size - new_size;
+        } else {
+            unused_ += old_size;
+            range.begin = static_cast<uint32_t>(items_.size());
+            items_.insert(items_.end(), begin, end);
+            range.end = static_cast<uint32_t>(items_.size());
+        }
+        if (unused_ > items_.size() / 2) {
+            Compact();
+        }
+    }
+    void Reserve(size_t list_count, size_t item_count) {
+        ranges_.reserve(list_count);
+        items_.reserve(item_count);
+    }
+
+    // Число элементов во всех списках
+    size_t GetItemCount() const {
+        return items_.size() - unused_;
+    }
+    // Выделенная память в байтах
+    size_t GetMemoryUsage() const {
+        return ranges_.capacity() * sizeof(Range) + items_.capacity() * sizeof(T);
+    }
+
+   private:
+    void Compact() {
+        std::vector<T> items;
+        items.reserve(GetItemCount());
+        for (Range& range : ranges_) {
+            const auto start = static_cast<uint32_t>(items.size());
+            items.insert(items.end(), items_.begin() + range.begin, items_.begin() + range.end);
+            range = {start, static_cast<uint32_t>(items.size())};
+        }
+        items_ = std::move(items);
+        unused_ = 0;
+    }
+
+    std::vector<Range> ranges_;
+    std::vector<T> items_;
+    size_t unused_ = 0;  // элементы заменённых списков, на которые не ссылается ни один список
+};
+// Значение, общее для копий владельца, пока его не меняют. Write копирует значение,
+// если на него ссылается кто-то ещё, поэтому копия владельца стоит одного счётчика ссылок,
+// а изменение копирует только изменяемое значение. Копии можно читать из разных потоков,
+// менять каждую - из одного. Пустое значение не выделяется до первого Write
+template <typename T>
+class CopyOnWrite {
+   public:
+    const T& operator*() const {
+        return value_ ? *value_ : GetEmpty();
+    }
+    const T* operator->() const {
+        return &**this;
+    }
+
+    T& Write() {
+        if (!value_) {
+            value_ = std::make_shared<T>();
+        } else if (value_.use_count() > 1) {
+            value_ = std::make_shared<T>(*value_);
+        } else {
+            //Последнюю другую ссылку могли отпустить в другом потоке после чтения значения
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *value_;
+    }
+
+   private:
+    static const T& GetEmpty() {
+        static const T empty;
+        return empty;
+    }
+
+    std::shared_ptr<T> value_;
+};
+
+// Массив, разбитый на страницы по PAGE_SIZE элементов. Копия массива копирует только таблицу страниц
+// и разделяет сами страницы с оригиналом, а изменение элемента копирует одну его страницу.
+// Элементы одной страницы лежат подряд, элементы разных страниц - нет. Рядом с таблицей страниц
+// хранятся адреса их элементов, так что чтение элемента стоит тех же двух обращений, что и в std::vector
+template <typename T>
+class PagedVector {
+   public:
+    static constexpr size_t PAGE_SIZE = 1024;
+
+    size_t size() const {
+        return size_;
+    }
+    const T& operator[](size_t index) const {
+        return page_data_[index / PAGE_SIZE][index % PAGE_SIZE];
+    }
+    // Элемент для изменения. Ссылка действительна до следующего изменения массива
+    T& Write(size_t index) {
+        return WritePage(index / PAGE_SIZE)[index % PAGE_SIZE];
+    }
+
+    void push_back(const T& value) {
+        if (size_ % PAGE_SIZE == 0) {
+            pages_.emplace_back();
+            page_data_.emplace_back();
+        }
+        std::vector<T>& page = pages_.back().Write();
+        page.push_back(value);
+        page_data_.back() = page.data();
+        ++size_;
+    }
+    // Заменяет содержимое массива count копиями value
+    void assign(size_t count, const T& value) {
+        pages_.clear();
+        page_data_.clear();
+        reserve(count);
+        for (size_t begin = 0; begin < count; begin += PAGE_SIZE) {
+            pages_.emplace_back();
+            std::vector<T>& page = pages_.back().Write();
+            page.assign(std::min(PAGE_SIZE, count - begin), value);
+            page_data_.push_back(page.data());
+        }
+        size_ = count;
+    }
+    void reserve(size_t count) {
+        pages_.reserve((count + PAGE_SIZE - 1) / PAGE_SIZE);
+        page_data_.reserve((count + PAGE_SIZE - 1) / PAGE_SIZE);
+    }
+
+    // Выделенная память в байтах, включая страницы, общие с копиями
+    size_t GetMemoryUsage() const {
+        size_t memory = pages_.capacity() * sizeof(Page) + page_data_.capacity() * sizeof(const T*);
+        for (const Page& page : pages_) {
+            memory += sizeof(std::vector<T>) + page->capacity() * sizeof(T);
+        }
+        return memory;
+    }
+
+   private:
+    using Page = CopyOnWrite<std::vector<T>>;
+
+    // Страница для изменения. Write может скопировать страницу, поэтому её адрес обновляется
+    std::vector<T>& WritePage(size_t page) {
+        std::vector<T>& elements = pages_[page].Write();
+        page_data_[page] = elements.data();
+        return elements;
+    }
+
+    std::vector<Page> pages_;
+    std::vector<const T*> page_data_;  // элементы страниц pages_
+    size_t size_ = 0;
+};
+
+// Списки переменной длины, разбитые на страницы по LISTS_PER_PAGE списков; каждая страница - FlatLists.
+// Как и в PagedVector, копия разделяет страницы с оригиналом, а замена списка копирует только его страницу,
+// и рядом с таблицей страниц хранятся их FlatLists::View. Элементы одного списка лежат подряд
+template <typename T>
+class PagedLists {
+   public:
+    static constexpr size_t LISTS_PER_PAGE = 256;
+
+    size_t size() const {
+        return size_;
+    }
+    Span<T> operator[](size_t index) const {
+        return page_views_[index / LISTS_PER_PAGE][index % LISTS_PER_PAGE];
+    }
+
+    // Добавляет список в конец
+    template <typename InputIt>
+    void Append(InputIt begin, InputIt end) {
+        if (size_ % LISTS_PER_PAGE == 0) {
+            pages_.emplace_back();
+            if (items_per_page_ > 0) {
+                pages_.back().Write().Reserve(LISTS_PER_PAGE, items_per_page_);
+            }
+            page_views_.push_back(pages_.back()->GetView());
+        }
+        FlatLists<T>& page = pages_.back().Write();
+        page.Append(begin, end);
+        page_views_.back() = page.GetView();
+        item_count_ += static_cast<size_t>(std::distance(begin, end));
+        ++size_;
+    }
+    // Заменяет список index. Новые элементы не должны лежать в этом же контейнере.
+    // Span, полученные раньше, становятся недействительными
+    template <typename InputIt>
+    void Replace(size_t index, InputIt begin, InputIt end) {
+        FlatLists<T>& page = pages_[index / LISTS_PER_PAGE].Write();
+        item_count_ -= page[index % LISTS_PER_PAGE].size();
+        page.Replace(index % LISTS_PER_PAGE, begin, end);
+        page_views_[index / LISTS_PER_PAGE] = page.GetView();
+        item_count_ += static_cast<size_t>(std::distance(begin, end));
+    }
+    // Резервирует таблицу страниц под list_count списков, а каждую новую страницу -
+    // под её долю из item_count элементов
+    void Reserve(size_t list_count, size_t item_count) {
+        pages_.reserve((list_count + LISTS_PER_PAGE - 1) / LISTS_PER_PAGE);
+        page_views_.reserve((list_count + LISTS_PER_PAGE - 1) / LISTS_PER_PAGE);
+        items_per_page_ = list_count > 0 ? (item_count * LISTS_PER_PAGE + list_count - 1) / list_count : 0;
+    }
+
+    // Число элементов во всех списках
+    size_t GetItemCount() const {
+        return item_count_;
+    }
+    // Выделенная память в байтах, включая страницы, общие с копиями
+    size_t GetMemoryUsage() const {
+        size_t memory = pages_.capacity() * sizeof(Page) + page_views_.capacity() * sizeof(View);
+        for (const Page& page : pages_) {
+            memory += sizeof(FlatLists<T>) + page->GetMemoryUsage();
+        }
+        return memory;
+    }
+
+   private:
+    using Page = CopyOnWrite<FlatLists<T>>;
+    using View = typename FlatLists<T>::View;
+
+    std::vector<Page> pages_;
+    std::vector<View> page_views_;  // обновляется после каждого изменения страницы
+    size_t size_ = 0;
+    size_t item_count_ = 0;
+    size_t items_per_page_ = 0;  // оценка из Reserve
+};
+
+// Хеш-таблица, разбитая по хешу ключа на SHARD_COUNT частей. Копия разделяет части с оригиналом,
+// а изменение копирует только часть, в которую попадает ключ. Хеш ключа считается один раз: он выбирает
+// часть и хранится в ключе её таблицы. Как и в PagedVector, адреса частей хранятся рядом с ними
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedMap {
+   public:
+    static constexpr size_t SHARD_COUNT = 256;
+
+    ShardedMap() {
+        for (size_t shard = 0; shard < SHARD_COUNT; ++shard) {
+            shard_maps_[shard] = &*shards_[shard];
+        }
+    }
+
+    size_t size() const {
+        return size_;
+    }
+    // Значение с ключом key или nullptr
+    const Value* Find(const Key& key) const {
+        const HashedKey hashed{key, Hash{}(key)};
+        const Map& shard = *shard_maps_[GetShard(hashed)];
+        const auto it = shard.find(hashed);
+        return it == shard.end() ? nullptr : &it->second;
+    }
+    void Set(const Key& key, Value value) {
+        const HashedKey hashed{key, Hash{}(key)};
+        Map& shard = WriteShard(GetShard(hashed));
+        const auto [it, inserted] = shard.try_emplace(hashed, value);
+        if (inserted) {
+            ++size_;
+        } else {
+            it->second = value;
+        }
+    }
+    void Erase(const Key& key) {
+        const HashedKey hashed{key, Hash{}(key)};
+        size_ -= WriteShard(GetShard(hashed)).erase(hashed);
+    }
+    // Пустые части не занимают памяти, поэтому маленькая таблица не резервируется
+    void Reserve(size_t count) {
+        if (count < SHARD_COUNT) {
+            return;
+        }
+        for (size_t shard = 0; shard < SHARD_COUNT; ++shard) {
+            WriteShard(shard).reserve(count / SHARD_COUNT + 1);
+        }
+    }
+
+    // Вызывает function(key, value) для всех элементов в порядке частей
+    template <typename Function>
+    void ForEach(Function function) const {
+        for (const Shard& shard : shards_) {
+            for (const auto& [hashed, value] : *shard) {
+                function(hashed.key, value);
+            }
+        }
+    }
+
+    // Память частей в байтах: узел хеш-таблицы хранит элемент, указатель на следующий узел и хеш
+    size_t GetMemoryUsage() const {
+        size_t memory = sizeof(shards_) + sizeof(shard_maps_);
+        for (const Shard& shard : shards_) {
+            memory += sizeof(Map) + shard->bucket_count() * sizeof(void*)
+                      + shard->size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*));
+        }
+        return memory;
+    }
+
+   private:
+    struct HashedKey {
+        Key key;
+        size_t hash;
+
+        bool operator==(const HashedKey& other) const {
+            return key == other.key;
+        }
+    };
+    struct HashedKeyHash {
+        size_t operator()(const HashedKey& hashed) const {
+            return hashed.hash;
+        }
+    };
+    using Map = std::unordered_map<HashedKey, Value, HashedKeyHash>;
+    using Shard = CopyOnWrite<Map>;
+
+    //Старшие биты хеша не совпадают с номером корзины внутри части, который берётся по модулю
+    static size_t GetShard(const HashedKey& hashed) {
+        return (hashed.hash >> 24) % SHARD_COUNT;
+    }
+    Map& WriteShard(size_t shard) {
+        Map& map = shards_[shard].Write();
+        shard_maps_[shard] = &map;
+        return map;
+    }
+
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::array<const Map*, SHARD_COUNT> shard_maps_;
+    size_t size_ = 0;
+};
+}  // namespace domain
@@ -0,0 +1,131 @@
+#include "epoch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+namespace concurrency {
+namespace {
+
+// Эпоха 0 в ячейке означает, что поток ничего не читает
+constexpr uint64_t IDLE = 0;
+
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{IDLE};
+    std::atomic<bool> in_use{false};
+    ReaderSlot* next = nullptr;
+};
+
+struct Retired {
+    uint64_t epoch;
+    const void* object;
+    void (*deleter)(const void*);
+    Retired* next;
+};
+
+std::atomic<uint64_t> global_epoch{1};
+// Ячейки только добавляются в начало списка и никогда не удаляются
+std::atomic<ReaderSlot*> slots{nullptr};
+std::atomic<Retired*> retired{nullptr};
+
+ReaderSlot* AcquireSlot() {
+    for (ReaderSlot* slot = slots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next) {
+        bool expected = false;
+        if (!slot->in_use.load(std::memory_order_relaxed) && slot->in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return slot;
+        }
+    }
+    auto* slot = new ReaderSlot;
+    slot->in_use.store(true, std::memory_order_relaxed);
+    slot->next = slots.load(std::memory_order_relaxed);
+    while (!slots.compare_exchange_weak(slot->next, slot, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return slot;
+}
+
+// Ячейка потока и глубина вложенных EpochGuard. Ячейка освобождается при завершении потока
+struct ThreadState {
+    ReaderSlot* slot = nullptr;
+    size_t depth = 0;
+
+    ~ThreadState() {
+        if (slot != nullptr) {
+            slot->in_use.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadState thread_state;
+
+void PushRetired(Retired* first, Retired* last) {
+    last->next = retired.load(std::memory_order_relaxed);
+    while (!retired.compare_exchange_weak(last->next, first, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace
+
+EpochGuard::EpochGuard() {
+    ThreadState& state = thread_state;
+    if (state.slot == nullptr) {
+        state.slot = AcquireSlot();
+    }
+    //Эпоха записывается до чтения общих указателей: либо сборщик увидит её,
+    //либо поток прочитает указатели, записанные до передачи старых объектов в Retire
+    if (state.depth++ == 0) {
+        state.slot->epoch.store(global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+}
+
+EpochGuard::~EpochGuard() {
+    ThreadState& state = thread_state;
+    if (--state.depth == 0) {
+        state.slot->epoch.store(IDLE, std::memory_order_release);
+    }
+}
+
+void RetireObject(const void* object, void (*deleter)(const void*)) {
+    auto* node = new Retired{global_epoch.fetch_add(1, std::memory_order_seq_cst) + 1, object, deleter, nullptr};
+    PushRetired(node, node);
+}
+
+size_t CollectRetired() {
+    Retired* list = retired.exchange(nullptr, std::memory_order_acquire);
+    if (list == nullptr) {
+        return 0;
+    }
+    //Объект, помеченный эпохой E, может видеть только поток, закрепивший эпоху меньше E
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (ReaderSlot* slot = slots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next) {
+        const uint64_t epoch = slot->epoch.load(std::memory_order_seq_cst);
+        if (epoch != IDLE) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+
+    size_t collected = 0;
+    Retired* kept_first = nullptr;
+    Retired* kept_last = nullptr;
+    while (list != nullptr) {
+        Retired* node = list;
+        list = list->next;
+        if (node->epoch <= oldest) {
+            node->deleter(node->object);
+            delete node;
+            ++collected;
+            continue;
+        }
+        node->next = kept_first;
+        kept_first = node;
+        if (kept_last == nullptr) {
+            kept_last = node;
+        }
+    }
+    if (kept_first != nullptr) {
+        PushRetired(kept_first, kept_last);
+    }
+    return collected;
+}
+
+}  // namespace concurrency
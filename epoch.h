@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace concurrency {
+
+/*
+ * Освобождение памяти по эпохам для структур, которые читаются без блокировок.
+ * Читатель на время чтения закрепляет текущую эпоху объектом EpochGuard. Писатель, заменив
+ * указатель на новый объект, передаёт старый в Retire: объект помечается следующей эпохой
+ * и освобождается в CollectRetired, когда ни один поток не остаётся в более ранней эпохе.
+ *
+ * Закрепление - одна запись в ячейку потока, без блокировок и без записи в общие данные.
+ * Ячейки потоков выделяются при первом закреплении и переходят к новым потокам после завершения старых
+ */
+
+// Закрепляет эпоху текущего потока. Вложенные объекты допустимы
+class EpochGuard {
+   public:
+    EpochGuard();
+    ~EpochGuard();
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// Передаёт объект на освобождение. Вызывается после того, как указатель на него убран
+// из общих данных, так что новые читатели его уже не найдут
+void RetireObject(const void* object, void (*deleter)(const void*));
+
+template <typename T>
+void Retire(const T* object) {
+    RetireObject(object, [](const void* pointer) {
+        delete static_cast<const T*>(pointer);
+    });
+}
+
+// Освобождает переданные в Retire объекты, которые не может видеть ни один читатель.
+// Возвращает число освобождённых объектов
+size_t CollectRetired();
+
+}  // namespace concurrency
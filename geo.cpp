@@ -1,10 +1,258 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define GEO_X86 1
+#include <immintrin.h>
+#endif
+
 namespace geo {
 
+namespace {
+using namespace std::literals;
+
+constexpr double EARTH_RADIUS = 6371000;
+
+static_assert(sizeof(UnitVector) == 3 * sizeof(double), "UnitVector must be three packed doubles");
+
+/*
+ * Угол между единичными векторами a и b считается по хорде: theta = 2 * asin(|a - b| / 2).
+ * В отличие от acos скалярного произведения, формула точна и для близких точек.
+ * asin вычисляется рациональным приближением из fdlibm: asin(t) = t + t * R(t^2) при t < 0.5,
+ * иначе asin(t) = pi/2 - 2 * (s + s * R(z)), где z = (1 - t) / 2, s = sqrt(z).
+ * Все реализации выполняют одни и те же операции в одном порядке и накапливают сумму
+ * в четырёх частичных суммах (отрезок i попадает в сумму i % 4), поэтому результат не зависит
+ * от выбранной реализации
+ */
+constexpr double P0 = 1.66666666666666657415e-01;
+constexpr double P1 = -3.25565818622400915405e-01;
+constexpr double P2 = 2.01212532134862925881e-01;
+constexpr double P3 = -4.00555345006794114027e-02;
+constexpr double P4 = 7.91534994289814532176e-04;
+constexpr double P5 = 3.47933107596021167570e-05;
+constexpr double Q1 = -2.40339491173441421878e+00;
+constexpr double Q2 = 2.02094576023350569471e+00;
+constexpr double Q3 = -6.88283971605453293030e-01;
+constexpr double Q4 = 7.70381505559019352791e-02;
+
+constexpr size_t LANES = 4;
+
+using PathLengthFunction = double (*)(const UnitVector* points, const uint32_t* path, size_t count);
+using ContiguousPathLengthFunction = double (*)(const UnitVector* points, size_t count);
+
+// Вершины ломаной: точки по номерам из path или точки подряд
+struct IndexedPath {
+    const UnitVector* points;
+    const uint32_t* path;
+
+    const UnitVector& operator[](size_t i) const {
+        return points[path[i]];
+    }
+};
+
+struct ContiguousPath {
+    const UnitVector* points;
+
+    const UnitVector& operator[](size_t i) const {
+        return points[i];
+    }
+};
+
+// ---------- Скалярная реализация ------------------
+
+double ComputeAngle(UnitVector a, UnitVector b) {
+    const double dx = a.x - b.x;
+    const double dy = a.y - b.y;
+    const double dz = a.z - b.z;
+    const double half_chord = std::min(std::sqrt(dx * dx + dy * dy + dz * dz) * 0.5, 1.0);
+    const bool small = half_chord < 0.5;
+    const double z = small ? half_chord * half_chord : (1.0 - half_chord) * 0.5;
+    const double t = small ? half_chord : std::sqrt(z);
+    const double p = z * (P0 + z * (P1 + z * (P2 + z * (P3 + z * (P4 + z * P5)))));
+    const double q = 1.0 + z * (Q1 + z * (Q2 + z * (Q3 + z * Q4)));
+    const double arc = t + t * (p / q);
+    return small ? 2.0 * arc : M_PI - 4.0 * arc;
+}
+
+// Отрезки с from по count - 2 добавляются к частичным суммам, начиная с sums[0]
+template <typename Path>
+double FinishPathLength(const Path& path, size_t from, size_t count, double (&sums)[LANES]) {
+    for (size_t i = from; i + 1 < count; ++i) {
+        sums[(i - from) % LANES] += ComputeAngle(path[i], path[i + 1]);
+    }
+    return ((sums[0] + sums[1]) + (sums[2] + sums[3])) * EARTH_RADIUS;
+}
+
+//Нужна только там, где нет векторных инструкций x86
+#ifndef GEO_X86
+template <typename Path>
+double PathLengthScalar(const Path& path, size_t count) {
+    double sums[LANES] = {};
+    size_t i = 0;
+    for (; i + LANES < count; i += LANES) {
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            sums[lane] += ComputeAngle(path[i + lane], path[i + lane + 1]);
+        }
+    }
+    return FinishPathLength(path, i, count, sums);
+}
+
+double PathLengthScalar(const UnitVector* points, const uint32_t* path, size_t count) {
+    return PathLengthScalar(IndexedPath{points, path}, count);
+}
+
+double PathLengthScalar(const UnitVector* points, size_t count) {
+    return PathLengthScalar(ContiguousPath{points}, count);
+}
+#endif
+
+// ---------- Векторные реализации ------------------
+
+#ifdef GEO_X86
+__m128d ComputeAnglesSse2(__m128d dx, __m128d dy, __m128d dz) {
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d half = _mm_set1_pd(0.5);
+    const __m128d squared = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+    const __m128d half_chord = _mm_min_pd(_mm_mul_pd(_mm_sqrt_pd(squared), half), one);
+    const __m128d small = _mm_cmplt_pd(half_chord, half);
+    auto select = [small](__m128d if_small, __m128d otherwise) {
+        return _mm_or_pd(_mm_and_pd(small, if_small), _mm_andnot_pd(small, otherwise));
+    };
+    const __m128d z = select(_mm_mul_pd(half_chord, half_chord), _mm_mul_pd(_mm_sub_pd(one, half_chord), half));
+    const __m128d t = select(half_chord, _mm_sqrt_pd(z));
+    auto step = [z](double c, __m128d acc) {
+        return _mm_add_pd(_mm_set1_pd(c), _mm_mul_pd(z, acc));
+    };
+    const __m128d p = _mm_mul_pd(z, step(P0, step(P1, step(P2, step(P3, step(P4, _mm_set1_pd(P5)))))));
+    const __m128d q = _mm_add_pd(one, _mm_mul_pd(z, step(Q1, step(Q2, step(Q3, _mm_set1_pd(Q4))))));
+    const __m128d arc = _mm_add_pd(t, _mm_mul_pd(t, _mm_div_pd(p, q)));
+    return select(_mm_mul_pd(_mm_set1_pd(2.0), arc), _mm_sub_pd(_mm_set1_pd(M_PI), _mm_mul_pd(_mm_set1_pd(4.0), arc)));
+}
+
+template <typename Path>
+double PathLengthSse2(const Path& path, size_t count) {
+    __m128d low = _mm_setzero_pd();   // суммы 0 и 1
+    __m128d high = _mm_setzero_pd();  // суммы 2 и 3
+    size_t i = 0;
+    for (; i + LANES < count; i += LANES) {
+        const UnitVector& p0 = path[i];
+        const UnitVector& p1 = path[i + 1];
+        const UnitVector& p2 = path[i + 2];
+        const UnitVector& p3 = path[i + 3];
+        const UnitVector& p4 = path[i + 4];
+        low = _mm_add_pd(low, ComputeAnglesSse2(_mm_set_pd(p1.x - p2.x, p0.x - p1.x), _mm_set_pd(p1.y - p2.y, p0.y - p1.y),
+                                                _mm_set_pd(p1.z - p2.z, p0.z - p1.z)));
+        high = _mm_add_pd(high, ComputeAnglesSse2(_mm_set_pd(p3.x - p4.x, p2.x - p3.x), _mm_set_pd(p3.y - p4.y, p2.y - p3.y),
+                                                  _mm_set_pd(p3.z - p4.z, p2.z - p3.z)));
+    }
+    double sums[LANES];
+    _mm_storeu_pd(sums, low);
+    _mm_storeu_pd(sums + 2, high);
+    return FinishPathLength(path, i, count, sums);
+}
+
+double PathLengthSse2(const UnitVector* points, const uint32_t* path, size_t count) {
+    return PathLengthSse2(IndexedPath{points, path}, count);
+}
+
+double PathLengthSse2(const UnitVector* points, size_t count) {
+    return PathLengthSse2(ContiguousPath{points}, count);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define GEO_AVX2 1
+__attribute__((target("avx2"))) __m256d ComputeAnglesAvx2(__m256d dx, __m256d dy, __m256d dz) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d squared = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+    const __m256d half_chord = _mm256_min_pd(_mm256_mul_pd(_mm256_sqrt_pd(squared), half), one);
+    const __m256d small = _mm256_cmp_pd(half_chord, half, _CMP_LT_OQ);
+    auto select = [small](__m256d if_small, __m256d otherwise) __attribute__((target("avx2"))) {
+        return _mm256_blendv_pd(otherwise, if_small, small);
+    };
+    const __m256d z = select(_mm256_mul_pd(half_chord, half_chord), _mm256_mul_pd(_mm256_sub_pd(one, half_chord), half));
+    const __m256d t = select(half_chord, _mm256_sqrt_pd(z));
+    auto step = [z](double c, __m256d acc) __attribute__((target("avx2"))) {
+        return _mm256_add_pd(_mm256_set1_pd(c), _mm256_mul_pd(z, acc));
+    };
+    const __m256d p = _mm256_mul_pd(z, step(P0, step(P1, step(P2, step(P3, step(P4, _mm256_set1_pd(P5)))))));
+    const __m256d q = _mm256_add_pd(one, _mm256_mul_pd(z, step(Q1, step(Q2, step(Q3, _mm256_set1_pd(Q4))))));
+    const __m256d arc = _mm256_add_pd(t, _mm256_mul_pd(t, _mm256_div_pd(p, q)));
+    return select(_mm256_mul_pd(_mm256_set1_pd(2.0), arc),
+                  _mm256_sub_pd(_mm256_set1_pd(M_PI), _mm256_mul_pd(_mm256_set1_pd(4.0), arc)));
+}
+
+// Координаты точек собираются инструкцией gather: индекс точки умножается на три double.
+// Используется форма с маской и нулевым источником: маска выбирает все элементы, поэтому источник
+// на результат не влияет, но без него GCC считает, что результат читает неинициализированный регистр
+__attribute__((target("avx2"))) double PathLengthAvx2(const UnitVector* points, const uint32_t* path, size_t count) {
+    const double* base = &points->x;
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    __m256d sums = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + LANES < count; i += LANES) {
+        const __m128i from = _mm_loadu_si128(reinterpret_cast<const __m128i*>(path + i));
+        const __m128i to = _mm_loadu_si128(reinterpret_cast<const __m128i*>(path + i + 1));
+        const __m128i from_offsets = _mm_add_epi32(from, _mm_add_epi32(from, from));
+        const __m128i to_offsets = _mm_add_epi32(to, _mm_add_epi32(to, to));
+        auto delta = [&](size_t coordinate) __attribute__((target("avx2"))) {
+            return _mm256_sub_pd(_mm256_mask_i32gather_pd(_mm256_setzero_pd(), base + coordinate, from_offsets, all, 8),
+                                 _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base + coordinate, to_offsets, all, 8));
+        };
+        sums = _mm256_add_pd(sums, ComputeAnglesAvx2(delta(0), delta(1), delta(2)));
+    }
+    double lane_sums[LANES];
+    _mm256_storeu_pd(lane_sums, sums);
+    return FinishPathLength(IndexedPath{points, path}, i, count, lane_sums);
+}
+
+// Точки идут подряд, поэтому координаты читаются обычными загрузками, без gather
+__attribute__((target("avx2"))) double PathLengthAvx2(const UnitVector* points, size_t count) {
+    __m256d sums = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + LANES < count; i += LANES) {
+        const UnitVector* p = points + i;
+        const __m256d dx = _mm256_sub_pd(_mm256_set_pd(p[3].x, p[2].x, p[1].x, p[0].x), _mm256_set_pd(p[4].x, p[3].x, p[2].x, p[1].x));
+        const __m256d dy = _mm256_sub_pd(_mm256_set_pd(p[3].y, p[2].y, p[1].y, p[0].y), _mm256_set_pd(p[4].y, p[3].y, p[2].y, p[1].y));
+        const __m256d dz = _mm256_sub_pd(_mm256_set_pd(p[3].z, p[2].z, p[1].z, p[0].z), _mm256_set_pd(p[4].z, p[3].z, p[2].z, p[1].z));
+        sums = _mm256_add_pd(sums, ComputeAnglesAvx2(dx, dy, dz));
+    }
+    double lane_sums[LANES];
+    _mm256_storeu_pd(lane_sums, sums);
+    return FinishPathLength(ContiguousPath{points}, i, count, lane_sums);
+}
+#endif
+#endif
+
+struct Implementation {
+    PathLengthFunction path_length;
+    ContiguousPathLengthFunction contiguous_path_length;
+    std::string_view name;
+};
+
+Implementation ChooseImplementation() {
+#ifdef GEO_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return {PathLengthAvx2, PathLengthAvx2, "avx2"sv};
+    }
+#endif
+#ifdef GEO_X86
+    return {PathLengthSse2, PathLengthSse2, "sse2"sv};
+#else
+    return {PathLengthScalar, PathLengthScalar, "scalar"sv};
+#endif
+}
+
+const Implementation& GetImplementation() {
+    static const Implementation implementation = ChooseImplementation();
+    return implementation;
+}
+
+}  // namespace
+
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
     const double dr = M_PI / 180.0;
@@ -12,4 +260,48 @@ double ComputeDistance(Coordinates from, Coordinates to) {
     return acos(sin(from.lat * dr) * sin(to.lat * dr) + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr)) * earth_radius;
 }
 
-}  // namespace geo
\ No newline at end of file
+Box GetBoundingBox(Coordinates center, double radius) {
+    const double dr = M_PI / 180.0;
+    const double angle = radius / EARTH_RADIUS;
+    Box box{{center.lat - angle / dr, -180}, {center.lat + angle / dr, 180}};
+    if (box.min.lat <= -90 || box.max.lat >= 90 || angle >= M_PI / 2) {
+        box.min.lat = std::max(box.min.lat, -90.0);
+        box.max.lat = std::min(box.max.lat, 90.0);
+        return box;
+    }
+    //Полюс вне круга, поэтому sin(angle) < cos(широты)
+    const double delta = std::asin(std::sin(angle) / std::cos(center.lat * dr)) / dr;
+    box.min.lng = center.lng - delta;
+    box.max.lng = center.lng + delta;
+    if (box.min.lng < -180) {
+        box.min.lng += 360;
+    } else if (box.max.lng > 180) {
+        box.max.lng -= 360;
+    }
+    return box;
+}
+
+UnitVector ToUnitVector(Coordinates coordinates) {
+    const double dr = M_PI / 180.0;
+    const double lat = coordinates.lat * dr;
+    const double lng = coordinates.lng * dr;
+    return {std::cos(lat) * std::cos(lng), std::cos(lat) * std::sin(lng), std::sin(lat)};
+}
+
+double ComputeDistance(UnitVector from, UnitVector to) {
+    return ComputeAngle(from, to) * EARTH_RADIUS;
+}
+
+double ComputePathLength(const UnitVector* points, const uint32_t* path, size_t count) {
+    return GetImplementation().path_length(points, path, count);
+}
+
+double ComputePathLength(const UnitVector* points, size_t count) {
+    return GetImplementation().contiguous_path_length(points, count);
+}
+
+std::string_view GetPathLengthImplementationName() {
+    return GetImplementation().name;
+}
+
+}  // namespace geo
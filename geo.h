@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
 namespace geo {
 
 struct Coordinates {
@@ -7,6 +11,39 @@ struct Coordinates {
     double lng;  // Долгота
 };
 
+// Прямоугольник на карте: широта от min.lat до max.lat, долгота от min.lng до max.lng
+struct Box {
+    Coordinates min;
+    Coordinates max;
+};
+
 double ComputeDistance(Coordinates from, Coordinates to);
+// Прямоугольник, содержащий все точки не дальше radius метров от center. Если круг переходит
+// через 180-й меридиан, у прямоугольника min.lng > max.lng; если содержит полюс - долгота не ограничена
+Box GetBoundingBox(Coordinates center, double radius);
+
+// Точка на сфере единичного радиуса. Расстояние между такими точками считается без тригонометрии
+// координат, поэтому её удобно вычислить один раз для каждой остановки
+struct UnitVector {
+    double x;
+    double y;
+    double z;
+};
+
+UnitVector ToUnitVector(Coordinates coordinates);
+// Расстояние в метрах с той же точностью, что и у ComputePathLength
+double ComputeDistance(UnitVector from, UnitVector to);
+
+// Длина ломаной points[path[0]], points[path[1]], ..., points[path[count - 1]] в метрах.
+// Отрезки обрабатываются векторными инструкциями, результат не зависит от выбранной реализации.
+// Погрешность на отрезок - меньше микрометра, в том числе для близких точек, где ComputeDistance
+// из-за acos ошибается на сантиметры и больше
+double ComputePathLength(const UnitVector* points, const uint32_t* path, size_t count);
+// Длина ломаной points[0], points[1], ..., points[count - 1]: то же, что с path = 0, 1, ..., count - 1,
+// но точки читаются подряд
+double ComputePathLength(const UnitVector* points, size_t count);
+
+// Реализация ComputePathLength, выбранная для текущего процессора: "avx2", "sse2" или "scalar"
+std::string_view GetPathLengthImplementationName();
 
-}  // namespace geo
\ No newline at end of file
+}  // namespace geo
@@ -1,351 +1,427 @@
 #include "json.h"
 
-#include <iterator>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+#include "json_scanner.h"
+#include "json_writer.h"
+#include "mapped_file.h"
 
 namespace json {
 
 namespace {
 using namespace std::literals;
 
-Node LoadNode(std::istream& input);
-Node LoadString(std::istream& input);
+// Второй этап разбора JSON. Переходит по позициям, найденным StructuralScanner, и читает текст
+// из его окна: весь буфер или часть потока. Строки без escape-последовательностей передаются
+// обработчику без копирования, числа преобразуются через std::from_chars
+class BufferParser {
+   public:
+    BufferParser(std::string_view text, Handler& handler)
+        : scanner_(text), handler_(handler) {
+    }
+    BufferParser(std::istream& input, Handler& handler)
+        : scanner_(input), handler_(handler) {
+    }
 
-std::string LoadLiteral(std::istream& input) {
-    std::string s;
-    while (std::isalpha(input.peek())) {
-        s.push_back(static_cast<char>(input.get()));
+    void ParseNode() {
+        const size_t pos = scanner_.Next();
+        if (pos == StructuralScanner::npos) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        ParseValue(pos);
     }
-    return s;
-}
 
-Node LoadArray(std::istream& input) {
-    std::vector<Node> result;
+   private:
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+    }
 
-    for (char c; input >> c && c != ']';) {
-        if (c != ',') {
-            input.putback(c);
-        }
-        result.push_back(LoadNode(input));
+    static bool IsDigit(char c) {
+        return c >= '0' && c <= '9';
     }
-    if (!input) {
-        throw ParsingError("Array parsing error"s);
+
+    // Текст с позиции pos до конца окна сканера. Действителен до следующего вызова Next или Peek
+    std::string_view GetText(size_t pos) const {
+        return scanner_.GetText().substr(pos - scanner_.GetTextBegin());
+    }
+    char GetChar(size_t pos) const {
+        return scanner_.GetText()[pos - scanner_.GetTextBegin()];
     }
-    return Node(std::move(result));
-}
 
-Node LoadDict(std::istream& input) {
-    Dict dict;
+    void ParseValue(size_t pos) {
+        switch (GetChar(pos)) {
+            case '[':
+                ParseArray();
+                break;
+            case '{':
+                ParseDict();
+                break;
+            case '"':
+                handler_.String(LoadString(pos));
+                break;
+            case 't':
+                [[fallthrough]];
+            case 'f':
+                ParseBool(pos);
+                break;
+            case 'n':
+                ParseNull(pos);
+                break;
+            default:
+                ParseNumber(pos);
+                break;
+        }
+    }
 
-    for (char c; input >> c && c != '}';) {
-        if (c == '"') {
-            std::string key = LoadString(input).AsString();
-            if (input >> c && c == ':') {
-                if (dict.find(key) != dict.end()) {
-                    throw ParsingError("Duplicate key '"s + key + "' have been found");
-                }
-                dict.emplace(std::move(key), LoadNode(input));
+    void ParseArray() {
+        handler_.StartArray();
+        while (true) {
+            const size_t pos = scanner_.Next();
+            if (pos == StructuralScanner::npos) {
+                throw ParsingError("Array parsing error"s);
+            }
+            const char c = GetChar(pos);
+            if (c == ']') {
+                break;
+            }
+            if (c == ',') {
+                ParseNode();
             } else {
-                throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                ParseValue(pos);
             }
-        } else if (c != ',') {
-            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
         }
+        handler_.EndArray();
     }
-    if (!input) {
-        throw ParsingError("Dictionary parsing error"s);
+
+    void ParseDict() {
+        handler_.StartDict();
+        while (true) {
+            size_t pos = scanner_.Next();
+            if (pos == StructuralScanner::npos) {
+                throw ParsingError("Dictionary parsing error"s);
+            }
+            const char c = GetChar(pos);
+            if (c == '}') {
+                break;
+            }
+            if (c == '"') {
+                //Ключ читается после двоеточия: поиск двоеточия может сдвинуть окно потока
+                const size_t key_end = FindStringEnd();
+                const size_t colon = scanner_.Next();
+                if (colon == StructuralScanner::npos) {
+                    throw ParsingError("Dictionary parsing error"s);
+                }
+                if (GetChar(colon) != ':') {
+                    throw ParsingError(": is expected but '"s + GetChar(colon) + "' has been found"s);
+                }
+                handler_.Key(LoadString(pos, key_end));
+                ParseNode();
+            } else if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            }
+        }
+        handler_.EndDict();
     }
-    return Node(std::move(dict));
-}
 
-Node LoadString(std::istream& input) {
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
-    std::string s;
-    while (true) {
-        if (it == end) {
+    // Позиция закрывающей кавычки строки, открывающая кавычка которой только что выдана сканером
+    size_t FindStringEnd() {
+        const size_t end = scanner_.Next();
+        if (end == StructuralScanner::npos) {
             throw ParsingError("String parsing error");
         }
-        const char ch = *it;
-        if (ch == '"') {
-            ++it;
-            break;
-        } else if (ch == '\\') {
-            ++it;
-            if (it == end) {
-                throw ParsingError("String parsing error");
+        return end;
+    }
+
+    std::string_view LoadString(size_t pos) {
+        return LoadString(pos, FindStringEnd());
+    }
+
+    // Возвращает содержимое строки между кавычками в позициях pos и end.
+    // Если в строке нет escape-последовательностей, результат указывает в текст сканера,
+    // иначе - в scratch_
+    std::string_view LoadString(size_t pos, size_t end) {
+        const std::string_view content = GetText(pos + 1).substr(0, end - pos - 1);
+        if (content.find('\\') == std::string_view::npos) {
+            return content;
+        }
+        scratch_.clear();
+        for (size_t i = 0; i < content.size(); ++i) {
+            const char ch = content[i];
+            if (ch != '\\') {
+                scratch_.push_back(ch);
+                continue;
             }
-            const char escaped_char = *(it);
+            const char escaped_char = content[++i];
             switch (escaped_char) {
                 case 'n':
-                    s.push_back('\n');
+                    scratch_.push_back('\n');
                     break;
                 case 't':
-                    s.push_back('\t');
+                    scratch_.push_back('\t');
                     break;
                 case 'r':
-                    s.push_back('\r');
+                    scratch_.push_back('\r');
                     break;
                 case '"':
-                    s.push_back('"');
+                    scratch_.push_back('"');
                     break;
                 case '\\':
-                    s.push_back('\\');
+                    scratch_.push_back('\\');
                     break;
                 default:
                     throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
             }
-        } else if (ch == '\n' || ch == '\r') {
-            throw ParsingError("Unexpected end of line"s);
-        } else {
-            s.push_back(ch);
         }
-        ++it;
+        return scratch_;
     }
 
-    return Node(std::move(s));
-}
-
-Node LoadBool(std::istream& input) {
-    const auto s = LoadLiteral(input);
-    if (s == "true"sv) {
-        return Node{true};
-    } else if (s == "false"sv) {
-        return Node{false};
-    } else {
-        throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+    // Проверяет, что между концом числа или литерала и следующей структурной позицией next только пробелы
+    void CheckTokenEnd(size_t end, size_t next) {
+        const std::string_view rest = GetText(end);
+        const size_t length = next > end ? std::min(next - end, rest.size()) : 0;
+        for (size_t i = 0; i < length; ++i) {
+            if (!IsSpace(rest[i])) {
+                throw ParsingError("Unexpected character '"s + rest[i] + "'"s);
+            }
+        }
     }
-}
 
-Node LoadNull(std::istream& input) {
-    if (auto literal = LoadLiteral(input); literal == "null"sv) {
-        return Node{nullptr};
-    } else {
-        throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+    std::string_view LoadLiteral(size_t pos) {
+        //Следующая позиция ищется заранее: тогда литерал целиком в окне
+        const size_t next = scanner_.Peek();
+        const std::string_view rest = GetText(pos);
+        size_t length = 0;
+        while (length < rest.size() && std::isalpha(static_cast<unsigned char>(rest[length]))) {
+            ++length;
+        }
+        CheckTokenEnd(pos + length, next);
+        return rest.substr(0, length);
     }
-}
 
-Node LoadNumber(std::istream& input) {
-    std::string parsed_num;
+    void ParseBool(size_t pos) {
+        const auto s = LoadLiteral(pos);
+        if (s == "true"sv) {
+            handler_.Bool(true);
+        } else if (s == "false"sv) {
+            handler_.Bool(false);
+        } else {
+            throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+        }
+    }
 
-    // Считывает в parsed_num очередной символ из input
-    auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) {
-            throw ParsingError("Failed to read number from stream"s);
+    void ParseNull(size_t pos) {
+        if (auto literal = LoadLiteral(pos); literal == "null"sv) {
+            handler_.Null();
+        } else {
+            throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
         }
-    };
+    }
+
+    void ParseNumber(size_t pos) {
+        //Следующая позиция ищется заранее: тогда число целиком в окне
+        const size_t next = scanner_.Peek();
+        const std::string_view rest = GetText(pos);
+        const char* const begin = rest.data();
+        const char* const end = rest.data() + rest.size();
+        const char* it = begin;
+
+        // Пропускает одну или более цифр
+        auto read_digits = [&it, end] {
+            if (it == end || !IsDigit(*it)) {
+                throw ParsingError("A digit is expected"s);
+            }
+            while (it != end && IsDigit(*it)) {
+                ++it;
+            }
+        };
 
-    // Считывает одну или более цифр в parsed_num из input
-    auto read_digits = [&input, read_char] {
-        if (!std::isdigit(input.peek())) {
-            throw ParsingError("A digit is expected"s);
+        if (it != end && *it == '-') {
+            ++it;
         }
-        while (std::isdigit(input.peek())) {
-            read_char();
+        // Парсим целую часть числа
+        if (it != end && *it == '0') {
+            ++it;
+            // После 0 в JSON не могут идти другие цифры
+        } else {
+            read_digits();
         }
-    };
-
-    if (input.peek() == '-') {
-        read_char();
-    }
-    // Парсим целую часть числа
-    if (input.peek() == '0') {
-        read_char();
-        // После 0 в JSON не могут идти другие цифры
-    } else {
-        read_digits();
-    }
 
-    bool is_int = true;
-    // Парсим дробную часть числа
-    if (input.peek() == '.') {
-        read_char();
-        read_digits();
-        is_int = false;
-    }
+        bool is_int = true;
+        // Парсим дробную часть числа
+        if (it != end && *it == '.') {
+            ++it;
+            read_digits();
+            is_int = false;
+        }
 
-    // Парсим экспоненциальную часть числа
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-        read_char();
-        if (ch = input.peek(); ch == '+' || ch == '-') {
-            read_char();
+        // Парсим экспоненциальную часть числа
+        if (it != end && (*it == 'e' || *it == 'E')) {
+            ++it;
+            if (it != end && (*it == '+' || *it == '-')) {
+                ++it;
+            }
+            read_digits();
+            is_int = false;
         }
-        read_digits();
-        is_int = false;
-    }
+        CheckTokenEnd(pos + static_cast<size_t>(it - begin), next);
 
-    try {
         if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return std::stoi(parsed_num);
-            } catch (...) {
-                // В случае неудачи, например, при переполнении
-                // код ниже попробует преобразовать строку в double
+            // Сначала пробуем преобразовать строку в int, при переполнении - в double
+            int value;
+            if (auto [ptr, ec] = std::from_chars(begin, it, value); ec == std::errc{} && ptr == it) {
+                handler_.Int(value);
+                return;
             }
         }
-        return std::stod(parsed_num);
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+        double value;
+        if (auto [ptr, ec] = std::from_chars(begin, it, value); ec != std::errc{} || ptr != it) {
+            throw ParsingError("Failed to convert "s + std::string(begin, it) + " to number"s);
+        }
+        handler_.Double(value);
     }
-}
 
-Node LoadNode(std::istream& input) {
-    char c;
-    if (!(input >> c)) {
-        throw ParsingError("Unexpected EOF"s);
-    }
-    switch (c) {
-        case '[':
-            return LoadArray(input);
-        case '{':
-            return LoadDict(input);
-        case '"':
-            return LoadString(input);
-        case 't':
-            // Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
-            // подсказкой компилятору и человеку, что здесь программист явно задумывал
-            // разрешить переход к инструкции следующей ветки case, а не случайно забыл
-            // написать break, return или throw.
-            // В данном случае, встретив t или f, переходим к попытке парсинга
-            // литералов true либо false
-            [[fallthrough]];
-        case 'f':
-            input.putback(c);
-            return LoadBool(input);
-        case 'n':
-            input.putback(c);
-            return LoadNull(input);
-        default:
-            input.putback(c);
-            return LoadNumber(input);
+    StructuralScanner scanner_;
+    Handler& handler_;
+    std::string scratch_;
+};
+
+}  // namespace
+
+// ---------- Dict ------------------
+
+Dict::Dict(std::vector<value_type> items)
+    : items_(std::move(items)) {
+    auto by_key = [](const value_type& lhs, const value_type& rhs) {
+        return lhs.first < rhs.first;
+    };
+    if (!std::is_sorted(items_.begin(), items_.end(), by_key)) {
+        std::stable_sort(items_.begin(), items_.end(), by_key);
     }
+    items_.erase(std::unique(items_.begin(), items_.end(), [](const value_type& lhs, const value_type& rhs) {
+                     return lhs.first == rhs.first;
+                 }),
+                 items_.end());
 }
 
-struct PrintContext {
-    std::ostream& out;
-    int indent_step = 4;
-    int indent = 0;
+// ---------- TreeBuilder ------------------
 
-    void PrintIndent() const {
-        for (int i = 0; i < indent; ++i) {
-            out.put(' ');
-        }
-    }
+void TreeBuilder::Null() {
+    AddValue(Node{nullptr});
+}
 
-    PrintContext Indented() const {
-        return {out, indent_step, indent_step + indent};
-    }
-};
+void TreeBuilder::Bool(bool value) {
+    AddValue(Node{value});
+}
 
-void PrintNode(const Node& value, const PrintContext& ctx);
+void TreeBuilder::Int(int value) {
+    AddValue(Node{value});
+}
 
-template <typename Value>
-void PrintValue(const Value& value, const PrintContext& ctx) {
-    ctx.out << value;
+void TreeBuilder::Double(double value) {
+    AddValue(Node{value});
 }
 
-void PrintString(const std::string& value, std::ostream& out) {
-    out.put('"');
-    for (const char c : value) {
-        switch (c) {
-            case '\r':
-                out << "\\r"sv;
-                break;
-            case '\n':
-                out << "\\n"sv;
-                break;
-            case '"':
-                // Символы " и \ выводятся как \" или \\, соответственно
-                [[fallthrough]];
-            case '\\':
-                out.put('\\');
-                [[fallthrough]];
-            default:
-                out.put(c);
-                break;
-        }
+void TreeBuilder::String(std::string_view value) {
+    AddValue(Node{std::string(value)});
+}
+
+void TreeBuilder::StartArray() {
+    frames_.push_back({false, {}, {}});
+}
+
+void TreeBuilder::EndArray() {
+    if (frames_.empty() || frames_.back().is_dict) {
+        throw ParsingError("Unexpected end of array"s);
     }
-    out.put('"');
+    Array array = std::move(frames_.back().array);
+    frames_.pop_back();
+    AddValue(Node{std::move(array)});
 }
 
-template <>
-void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
-    PrintString(value, ctx.out);
+void TreeBuilder::StartDict() {
+    frames_.push_back({true, {}, {}});
 }
 
-template <>
-void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx) {
-    ctx.out << "null"sv;
+void TreeBuilder::Key(std::string_view key) {
+    if (frames_.empty() || !frames_.back().is_dict) {
+        throw ParsingError("Unexpected key"s);
+    }
+    frames_.back().items.emplace_back(std::string(key), Node{});
 }
 
-// В специализаци шаблона PrintValue для типа bool параметр value передаётся
-// по константной ссылке, как и в основном шаблоне.
-// В качестве альтернативы можно использовать перегрузку:
-// void PrintValue(bool value, const PrintContext& ctx);
-template <>
-void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
-    ctx.out << (value ? "true"sv : "false"sv);
+void TreeBuilder::EndDict() {
+    if (frames_.empty() || !frames_.back().is_dict) {
+        throw ParsingError("Unexpected end of dictionary"s);
+    }
+    std::vector<Dict::value_type> items = std::move(frames_.back().items);
+    frames_.pop_back();
+    std::sort(items.begin(), items.end(), [](const Dict::value_type& lhs, const Dict::value_type& rhs) {
+        return lhs.first < rhs.first;
+    });
+    auto duplicate = std::adjacent_find(items.begin(), items.end(), [](const Dict::value_type& lhs, const Dict::value_type& rhs) {
+        return lhs.first == rhs.first;
+    });
+    if (duplicate != items.end()) {
+        throw ParsingError("Duplicate key '"s + duplicate->first + "' have been found");
+    }
+    AddValue(Node{Dict(std::move(items))});
 }
 
-template <>
-void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "[\n"sv;
-    bool first = true;
-    auto inner_ctx = ctx.Indented();
-    for (const Node& node : nodes) {
-        if (first) {
-            first = false;
-        } else {
-            out << ",\n"sv;
-        }
-        inner_ctx.PrintIndent();
-        PrintNode(node, inner_ctx);
+Node TreeBuilder::Extract() {
+    if (!IsComplete()) {
+        throw ParsingError("Value is not complete"s);
     }
-    out.put('\n');
-    ctx.PrintIndent();
-    out.put(']');
+    Node result = std::move(*root_);
+    root_.reset();
+    return result;
 }
 
-template <>
-void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "{\n"sv;
-    bool first = true;
-    auto inner_ctx = ctx.Indented();
-    for (const auto& [key, node] : nodes) {
-        if (first) {
-            first = false;
-        } else {
-            out << ",\n"sv;
+void TreeBuilder::AddValue(Node value) {
+    if (frames_.empty()) {
+        if (root_) {
+            throw ParsingError("Unexpected value after the end of document"s);
         }
-        inner_ctx.PrintIndent();
-        PrintString(key, ctx.out);
-        out << ": "sv;
-        PrintNode(node, inner_ctx);
+        root_ = std::move(value);
+        return;
     }
-    out.put('\n');
-    ctx.PrintIndent();
-    out.put('}');
+    Frame& frame = frames_.back();
+    if (!frame.is_dict) {
+        frame.array.push_back(std::move(value));
+        return;
+    }
+    // Значение относится к последнему прочитанному ключу
+    frame.items.back().second = std::move(value);
 }
 
-void PrintNode(const Node& node, const PrintContext& ctx) {
-    std::visit(
-        [&ctx](const auto& value) {
-            PrintValue(value, ctx);
-        },
-        node.GetValue());
+void Parse(std::istream& input, Handler& handler) {
+    BufferParser(input, handler).ParseNode();
 }
 
-}  // namespace
+void Parse(std::string_view text, Handler& handler) {
+    BufferParser(text, handler).ParseNode();
+}
 
 Document Load(std::istream& input) {
-    return Document{LoadNode(input)};
+    TreeBuilder builder;
+    Parse(input, builder);
+    return Document{builder.Extract()};
+}
+
+Document Load(std::string_view text) {
+    TreeBuilder builder;
+    Parse(text, builder);
+    return Document{builder.Extract()};
+}
+
+Document LoadFile(const std::string& path) {
+    io::MappedFile file(path);
+    return Load(file.GetData());
 }
 
 void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext{output});
+    Writer(output).Value(doc.GetRoot());
 }
 
 }  // namespace json
\ No newline at end of file
@@ -1,17 +1,64 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
-#include <map>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace json {
 
 class Node;
-using Dict = std::map<std::string, Node>;
 using Array = std::vector<Node>;
 
+// Словарь JSON в виде отсортированного по ключам непрерывного массива пар.
+// Повторяет используемую часть интерфейса std::map, но хранит элементы без отдельных узлов в куче:
+// объекты JSON обычно содержат несколько ключей, и двоичный поиск по массиву
+// обходится дешевле обхода красно-чёрного дерева
+class Dict {
+public:
+    using value_type = std::pair<std::string, Node>;
+    using iterator = std::vector<value_type>::iterator;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    Dict() = default;
+    // Создаёт словарь из пар в произвольном порядке. При повторе ключа сохраняется первая пара
+    explicit Dict(std::vector<value_type> items);
+
+    const_iterator begin() const {
+        return items_.begin();
+    }
+    const_iterator end() const {
+        return items_.end();
+    }
+    size_t size() const {
+        return items_.size();
+    }
+    bool empty() const {
+        return items_.empty();
+    }
+
+    const_iterator find(std::string_view key) const;
+    iterator find(std::string_view key);
+    size_t count(std::string_view key) const;
+    const Node& at(std::string_view key) const;
+    Node& at(std::string_view key);
+
+    std::pair<iterator, bool> emplace(std::string key, Node value);
+    std::pair<iterator, bool> insert(value_type item);
+
+    bool operator==(const Dict& rhs) const;
+
+private:
+    iterator LowerBound(std::string_view key);
+    const_iterator LowerBound(std::string_view key) const;
+
+    std::vector<value_type> items_;
+};
+
 class ParsingError : public std::runtime_error {
 public:
     using runtime_error::runtime_error;
@@ -113,6 +160,61 @@ inline bool operator!=(const Node& lhs, const Node& rhs) {
     return !(lhs == rhs);
 }
 
+inline bool Dict::operator==(const Dict& rhs) const {
+    return items_ == rhs.items_;
+}
+
+inline Dict::const_iterator Dict::find(std::string_view key) const {
+    auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+inline Dict::iterator Dict::find(std::string_view key) {
+    auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+inline size_t Dict::count(std::string_view key) const {
+    return find(key) == items_.end() ? 0 : 1;
+}
+
+inline const Node& Dict::at(std::string_view key) const {
+    using namespace std::literals;
+    auto it = find(key);
+    if (it == items_.end()) {
+        throw std::out_of_range("Key '"s + std::string(key) + "' not found"s);
+    }
+    return it->second;
+}
+
+inline Node& Dict::at(std::string_view key) {
+    return const_cast<Node&>(static_cast<const Dict&>(*this).at(key));
+}
+
+inline std::pair<Dict::iterator, bool> Dict::insert(value_type item) {
+    auto it = LowerBound(item.first);
+    if (it != items_.end() && it->first == item.first) {
+        return {it, false};
+    }
+    return {items_.insert(it, std::move(item)), true};
+}
+
+inline std::pair<Dict::iterator, bool> Dict::emplace(std::string key, Node value) {
+    return insert({std::move(key), std::move(value)});
+}
+
+inline Dict::iterator Dict::LowerBound(std::string_view key) {
+    return std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view key) {
+        return item.first < key;
+    });
+}
+
+inline Dict::const_iterator Dict::LowerBound(std::string_view key) const {
+    return std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view key) {
+        return item.first < key;
+    });
+}
+
 class Document {
 public:
     explicit Document(Node root)
@@ -135,7 +237,73 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
     return !(lhs == rhs);
 }
 
+// Обработчик событий потокового (SAX) разбора JSON.
+// Парсер вызывает методы по мере чтения входных данных, не строя дерево Node.
+// Строки и ключи передаются через string_view, который действителен только до возврата из метода
+class Handler {
+public:
+    virtual void Null() = 0;
+    virtual void Bool(bool value) = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    virtual void String(std::string_view value) = 0;
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+
+protected:
+    ~Handler() = default;
+};
+
+// Обработчик, собирающий из событий разбора дерево Node.
+// Может использоваться повторно: после Extract() готов принять следующее значение
+class TreeBuilder final : public Handler {
+public:
+    void Null() override;
+    void Bool(bool value) override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void String(std::string_view value) override;
+    void StartArray() override;
+    void EndArray() override;
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+
+    // Возвращает true, если значение верхнего уровня полностью собрано
+    bool IsComplete() const {
+        return root_.has_value() && frames_.empty();
+    }
+    Node Extract();
+
+private:
+    struct Frame {
+        bool is_dict;
+        Array array;
+        // Пары словаря накапливаются без сортировки, словарь строится один раз в EndDict
+        std::vector<Dict::value_type> items;
+    };
+
+    void AddValue(Node value);
+
+    std::vector<Frame> frames_;
+    std::optional<Node> root_;
+};
+
+// Разбирает одно значение JSON из input, сообщая о нём handler. input читается порциями
+// по StructuralScanner::CHUNK_SIZE байт и разбирается тем же двухэтапным разбором, что и буфер,
+// поэтому память не зависит от размера значения; input может быть прочитан дальше конца значения
+void Parse(std::istream& input, Handler& handler);
+// Разбирает одно значение JSON из непрерывного буфера text.
+// Строки без escape-последовательностей передаются в handler как string_view на сам буфер, без копирования
+void Parse(std::string_view text, Handler& handler);
+
 Document Load(std::istream& input);
+Document Load(std::string_view text);
+// Загружает документ из файла, отображённого в память
+Document LoadFile(const std::string& path);
 
 void Print(const Document& doc, std::ostream& output);
 
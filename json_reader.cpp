@@ -1,26 +1,54 @@
 #include "json_reader.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 
-using namespace std::string_literals;
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+using namespace std::literals;
 
 namespace json_reader {
+static std::vector<std::string_view> GetStopsNames(const json::Dict& request) {
+    std::vector<std::string_view> stops;
+    const json::Array& stops_array = request.at("stops").AsArray();
+    stops.reserve(stops_array.size());
+    for (const json::Node& stop : stops_array) {
+        stops.push_back(stop.AsString());
+    }
+    return stops;
+}
+
+static domain::TypeRoute GetTypeRoute(const json::Dict& request) {
+    if (request.at("is_roundtrip").AsBool()) {
+        return domain::TypeRoute::circular;
+    }
+    return domain::TypeRoute::linear;
+}
+
 void JsonReader::AddStops(transport_catalogue::TransportCatalogue& db) const {
-    json::Node root = document_.GetRoot();
-    json::Dict dict;
+    const json::Node& root = document_.GetRoot();
 
     if (root.IsDict()) {
-        dict = root.AsDict();
-        json::Node base_requests = dict.at("base_requests");
-
-        json::Array requests = base_requests.AsArray();
+        const json::Array& requests = root.AsDict().at("base_requests").AsArray();
         for (const json::Node& request : requests) {
             if (request.AsDict().at("type").AsString() == "Stop") {
-                std::string name = request.AsDict().at("name").AsString();
+                const std::string& name = request.AsDict().at("name").AsString();
                 double latitude = request.AsDict().at("latitude").AsDouble();
                 double longitude = request.AsDict().at("longitude").AsDouble();
                 db.AddStop(name, {latitude, longitude});
@@ -30,11 +58,14 @@ void JsonReader::AddStops(transport_catalogue::TransportCatalogue& db) const {
         for (const json::Node& request : requests) {
             if (request.AsDict().at("type").AsString() == "Stop") {
                 if (request.AsDict().at("road_distances").IsDict()) {
-                    json::Dict road_distances = request.AsDict().at("road_distances").AsDict();
+                    const json::Dict& road_distances = request.AsDict().at("road_distances").AsDict();
+                    const domain::StopId this_stop = *db.FindStop(request.AsDict().at("name").AsString());
                     for (const auto& [stop_name, distance] : road_distances) {
-                        std::string name_this_stop = request.AsDict().at("name").AsString();
                         int distance_int = distance.AsInt();
-                        db.AddDistanceToStops(db.GetStop(name_this_stop), db.GetStop(stop_name), distance_int);
+                        //Расстояния до неизвестных остановок пропускаются
+                        if (std::optional<domain::StopId> stop = db.FindStop(stop_name)) {
+                            db.AddDistanceToStops(this_stop, *stop, distance_int);
+                        }
                     }
                 }
             }
@@ -43,28 +74,11 @@ void JsonReader::AddStops(transport_catalogue::TransportCatalogue& db) const {
 }
 
 void JsonReader::AddBuses(transport_catalogue::TransportCatalogue& db) const {
-    json::Node root = document_.GetRoot();
-    json::Dict dict;
-
-    dict = root.AsDict();
-    json::Node base_requests = dict.at("base_requests");
-
-    json::Array requests = base_requests.AsArray();
+    const json::Array& requests = document_.GetRoot().AsDict().at("base_requests").AsArray();
     for (const json::Node& request : requests) {
         if (request.AsDict().at("type").AsString() == "Bus") {
-            std::string bus_name = request.AsDict().at("name").AsString();
-            json::Array stops_array = request.AsDict().at("stops").AsArray();
-            std::vector<std::string> stops;
-            for (const json::Node& stop : stops_array) {
-                stops.push_back(stop.AsString());
-            }
-            domain::TypeRoute type;
-            if (request.AsDict().at("is_roundtrip").AsBool()) {
-                type = domain::TypeRoute::circular;
-            } else {
-                type = domain::TypeRoute::linear;
-            }
-            db.AddBus(bus_name, stops, type);
+            const std::string& bus_name = request.AsDict().at("name").AsString();
+            db.AddBus(bus_name, GetStopsNames(request.AsDict()), GetTypeRoute(request.AsDict()));
         }
     }
 }
@@ -72,118 +86,990 @@ void JsonReader::AddBuses(transport_catalogue::TransportCatalogue& db) const {
 void JsonReader::FillDataBase(transport_catalogue::TransportCatalogue& db) const {
     AddStops(db);
     AddBuses(db);
+    db.Finalize();
 }
 
-std::vector<StatRequest> JsonReader::GetRequest(void) const {
-    using namespace std::string_literals;
+namespace {
+// Обработчик потокового разбора входного документа.
+// Каждый элемент base_requests собирается в отдельный небольшой Node и сразу добавляется в каталог,
+// остальные секции документа сохраняются целиком.
+// Расстояния и маршруты, ссылающиеся на ещё не прочитанные остановки, откладываются до конца base_requests
+class BaseRequestsLoader final : public json::Handler {
+   public:
+    explicit BaseRequestsLoader(transport_catalogue::TransportCatalogue& db) : db_(db) {}
 
-    std::vector<StatRequest> result;
-    StatRequest req;
-    json::Node root = document_.GetRoot();
-    json::Dict dict = root.AsDict();
-    json::Node base_requests = dict.at("stat_requests");
-    json::Array requests = base_requests.AsArray();
-    for (const json::Node& request : requests) {
-        std::string type = request.AsDict().at("type").AsString();
-        req.id = request.AsDict().at("id").AsInt();
-        if (type == "Map") {
-            req.type = TypeRequest::Map;
+    void Null() override {
+        Forward(0, [](json::Handler& handler) { handler.Null(); });
+    }
+    void Bool(bool value) override {
+        Forward(0, [value](json::Handler& handler) { handler.Bool(value); });
+    }
+    void Int(int value) override {
+        Forward(0, [value](json::Handler& handler) { handler.Int(value); });
+    }
+    void Double(double value) override {
+        Forward(0, [value](json::Handler& handler) { handler.Double(value); });
+    }
+    void String(std::string_view value) override {
+        Forward(0, [value](json::Handler& handler) { handler.String(value); });
+    }
+    void StartArray() override {
+        if (depth_ == 1 && key_ == "base_requests"s) {
+            in_base_requests_ = true;
+            has_base_requests_ = true;
+            ++depth_;
+            return;
+        }
+        Forward(1, [](json::Handler& handler) { handler.StartArray(); });
+    }
+    void EndArray() override {
+        if (in_base_requests_ && depth_ == 2) {
+            in_base_requests_ = false;
+            --depth_;
+            AddPending();
+            return;
+        }
+        Forward(-1, [](json::Handler& handler) { handler.EndArray(); });
+    }
+    void StartDict() override {
+        if (depth_ == 0) {
+            ++depth_;
+            return;
+        }
+        Forward(1, [](json::Handler& handler) { handler.StartDict(); });
+    }
+    void Key(std::string_view key) override {
+        if (depth_ == 1) {
+            key_ = key;
+            return;
+        }
+        Forward(0, [key](json::Handler& handler) { handler.Key(key); });
+    }
+    void EndDict() override {
+        if (depth_ == 1) {
+            --depth_;
+            return;
+        }
+        Forward(-1, [](json::Handler& handler) { handler.EndDict(); });
+    }
+
+    json::Document GetDocument() {
+        return json::Document{json::Node{std::move(sections_)}};
+    }
+    bool HasBaseRequests() const {
+        return has_base_requests_;
+    }
+
+   private:
+    struct PendingDistance {
+        domain::StopId from;
+        std::string to;
+        int distance;
+    };
+
+    // Передаёт событие сборщику текущего значения и, если значение собрано, обрабатывает его
+    template <typename Event>
+    void Forward(int depth_delta, Event event) {
+        if (depth_ == 0) {
+            throw json::ParsingError("Root of the document must be a dict"s);
+        }
+        json::TreeBuilder& builder = in_base_requests_ ? request_ : section_;
+        event(builder);
+        depth_ += depth_delta;
+        if (!builder.IsComplete()) {
+            return;
+        }
+        if (in_base_requests_) {
+            AddBaseRequest(builder.Extract());
+        } else {
+            sections_.emplace(key_, builder.Extract());
+        }
+    }
+
+    void AddBaseRequest(json::Node node) {
+        const json::Dict& request = node.AsDict();
+        const std::string& type = request.at("type").AsString();
+        if (type == "Stop"s) {
+            const std::string& name = request.at("name").AsString();
+            const domain::StopId from = db_.AddStop(name, {request.at("latitude").AsDouble(), request.at("longitude").AsDouble()});
+            const json::Node& road_distances = request.at("road_distances");
+            if (!road_distances.IsDict()) {
+                return;
+            }
+            for (const auto& [stop_name, distance] : road_distances.AsDict()) {
+                if (std::optional<domain::StopId> to = db_.FindStop(stop_name)) {
+                    db_.AddDistanceToStops(from, *to, distance.AsInt());
+                } else {
+                    pending_distances_.push_back({from, stop_name, distance.AsInt()});
+                }
+            }
         } else if (type == "Bus"s) {
-            req.type = TypeRequest::Bus;
-        } else if (type == "Stop"s) {
-            req.type = TypeRequest::Stop;
+            std::vector<std::string_view> stops = GetStopsNames(request);
+            bool all_stops_known = std::all_of(stops.begin(), stops.end(), [this](std::string_view stop) {
+                return db_.FindStop(stop).has_value();
+            });
+            if (all_stops_known) {
+                db_.AddBus(request.at("name").AsString(), stops, GetTypeRoute(request));
+            } else {
+                //Запрос сохраняется целиком, названия остановок в нём не копируются
+                pending_buses_.push_back(std::move(node));
+            }
+        }
+    }
+
+    // Добавляет отложенные расстояния и маршруты, когда все остановки уже прочитаны
+    void AddPending() {
+        for (const PendingDistance& distance : pending_distances_) {
+            //Расстояния до остановок, которых нет в документе, пропускаются
+            if (std::optional<domain::StopId> to = db_.FindStop(distance.to)) {
+                db_.AddDistanceToStops(distance.from, *to, distance.distance);
+            }
         }
-        if (req.type == TypeRequest::Bus || req.type == TypeRequest::Stop) {
-            req.name = request.AsDict().at("name").AsString();
+        pending_distances_.clear();
+        for (const json::Node& bus : pending_buses_) {
+            const json::Dict& request = bus.AsDict();
+            db_.AddBus(request.at("name").AsString(), GetStopsNames(request), GetTypeRoute(request));
         }
-        result.push_back(req);
+        pending_buses_.clear();
     }
 
-    return result;
+    transport_catalogue::TransportCatalogue& db_;
+    int depth_ = 0;
+    bool in_base_requests_ = false;
+    bool has_base_requests_ = false;
+    std::string key_;
+    json::TreeBuilder request_;
+    json::TreeBuilder section_;
+    json::Dict sections_;
+    std::vector<PendingDistance> pending_distances_;
+    std::vector<json::Node> pending_buses_;
+};
+
+template <typename Input>
+json::Document LoadStreaming(Input& input, transport_catalogue::TransportCatalogue& db) {
+    BaseRequestsLoader loader(db);
+    json::Parse(input, loader);
+    //Без base_requests справочник остаётся незафиксированным, чтобы его можно было заполнить из файла
+    if (loader.HasBaseRequests()) {
+        db.Finalize();
+    }
+    return loader.GetDocument();
+}
+}  // namespace
+
+JsonReader::JsonReader(std::istream& input, transport_catalogue::TransportCatalogue& db) {
+    document_ = LoadStreaming(input, db);
 }
 
-static json::Dict GetErrorMessage(const json_reader::StatRequest& request) {
-    return json::Builder{}.StartDict()
-                            .Key("request_id"s).Value(request.id)
-                            .Key("error_message"s).Value("not found"s)
-                          .EndDict()
-                        .Build()
-                        .AsDict();
+JsonReader::JsonReader(std::string_view text, transport_catalogue::TransportCatalogue& db) {
+    document_ = LoadStreaming(text, db);
 }
 
-static json::Dict GetStop(const transport_catalogue::TransportCatalogue& db, const json_reader::StatRequest& request, const RequestHandler& request_handler) {
-    const domain::Stop* stop = db.GetStop(request.name);
-    if (stop == nullptr) {
-        return GetErrorMessage(request);
+std::optional<StatRequest> ParseStatRequest(const json::Dict& request) {
+    StatRequest req;
+    const std::string& type = request.at("type").AsString();
+    req.id = request.at("id").AsInt();
+    if (type == "Map"s) {
+        req.type = TypeRequest::Map;
+    } else if (type == "Bus"s) {
+        req.type = TypeRequest::Bus;
+    } else if (type == "Stop"s) {
+        req.type = TypeRequest::Stop;
+    } else if (type == "Update"s) {
+        req.type = TypeRequest::Update;
+    } else if (type == "NearestStops"s) {
+        req.type = TypeRequest::NearestStops;
+    } else if (type == "StopsInRadius"s) {
+        req.type = TypeRequest::StopsInRadius;
+    } else if (type == "Box"s) {
+        req.type = TypeRequest::Box;
+    } else if (type == "Cities"s) {
+        req.type = TypeRequest::Cities;
+    } else if (type == "Route"s) {
+        req.type = TypeRequest::Route;
     } else {
-        std::set<std::string> buses = request_handler.GetBusesByStop(request.name);
-        if (buses.size() == 0) {
-            json::Array buses_arr;
-            return json::Builder{}.StartDict()
-                                    .Key("buses"s).Value(buses_arr)
-                                    .Key("request_id"s).Value(request.id)
-                                  .EndDict()
-                                  .Build()
-                                  .AsDict();
+        return std::nullopt;
+    }
+    if (const auto city = request.find("city"sv); city != request.end()) {
+        req.city = city->second.AsString();
+    }
+    if (req.type == TypeRequest::Bus || req.type == TypeRequest::Stop) {
+        req.name = request.at("name").AsString();
+    } else if (req.type == TypeRequest::Update) {
+        req.updates = &request.at("requests").AsArray();
+    } else if (req.type == TypeRequest::NearestStops || req.type == TypeRequest::StopsInRadius) {
+        req.point = {request.at("latitude").AsDouble(), request.at("longitude").AsDouble()};
+        if (req.type == TypeRequest::NearestStops) {
+            req.count = request.at("count").AsInt();
         } else {
-            json::Array buses_arr;
-            for (const std::string& bus : buses) {
-                buses_arr.push_back(bus);
+            req.radius = request.at("radius").AsDouble();
+        }
+    } else if (req.type == TypeRequest::Route) {
+        req.from = request.at("from").AsString();
+        req.to = request.at("to").AsString();
+        if (const auto metric = request.find("metric"sv); metric != request.end()) {
+            if (metric->second.AsString() == "distance"sv) {
+                req.metric = router::Metric::Distance;
+            } else if (metric->second.AsString() != "time"sv) {
+                throw std::invalid_argument("unknown metric "s + metric->second.AsString());
             }
-            return json::Builder{}.StartDict()
-                                    .Key("buses"s).Value(buses_arr)
-                                    .Key("request_id"s).Value(request.id)
-                                  .EndDict()
-                                  .Build()
-                                  .AsDict();
         }
+    } else if (req.type == TypeRequest::Box) {
+        req.box = {{request.at("min_latitude").AsDouble(), request.at("min_longitude").AsDouble()},
+                   {request.at("max_latitude").AsDouble(), request.at("max_longitude").AsDouble()}};
+    }
+    return req;
+}
+
+std::vector<StatRequest> JsonReader::GetRequest(void) const {
+    std::vector<StatRequest> result;
+    const json::Array& requests = document_.GetRoot().AsDict().at("stat_requests").AsArray();
+    result.reserve(requests.size());
+    for (const json::Node& request : requests) {
+        //Запросы неизвестного типа пропускаются
+        if (std::optional<StatRequest> req = ParseStatRequest(request.AsDict())) {
+            result.push_back(std::move(*req));
+        }
+    }
+
+    return result;
+}
+
+static void WriteErrorMessage(const json_reader::StatRequest& request, json::Writer& writer) {
+    writer.StartDict()
+            .Key("error_message"s).Value("not found"sv)
+            .Key("request_id"s).Value(request.id)
+          .EndDict();
+}
+
+static void WriteStop(const transport_catalogue::TransportCatalogue& db, const json_reader::StatRequest& request, const RequestHandler& request_handler, json::Writer& writer) {
+    const std::optional<domain::Span<domain::BusId>> buses = request_handler.GetBusesByStop(request.name);
+    if (!buses) {
+        WriteErrorMessage(request, writer);
+        return;
     }
+    json::Writer::ArrayContext buses_arr = writer.StartDict().Key("buses"s).StartArray();
+    for (domain::BusId bus : *buses) {
+        buses_arr.Value(db.GetBusName(bus));
+    }
+    buses_arr.EndArray()
+            .Key("request_id"s).Value(request.id)
+          .EndDict();
 }
 
-static json::Dict GetBus(const json_reader::StatRequest& request, const RequestHandler& request_handler) {
+static void WriteBus(const json_reader::StatRequest& request, const RequestHandler& request_handler, json::Writer& writer) {
     std::optional<domain::BusStat> bus = request_handler.GetBusStat(request.name);
     if (bus == std::nullopt) {
-        return GetErrorMessage(request);
+        WriteErrorMessage(request, writer);
+        return;
+    }
+    const domain::BusStat& b = *bus;
+    writer.StartDict()
+            .Key("curvature"s).Value(b.curvature)
+            .Key("request_id"s).Value(request.id)
+            .Key("route_length"s).Value(b.route_length)
+            .Key("stop_count"s).Value(b.stop_count)
+            .Key("unique_stop_count"s).Value(b.unique_stop_count)
+          .EndDict();
+}
+
+static void WriteMap(const json_reader::StatRequest& request, const RequestHandler& request_handler, json::Writer& writer) {
+    const std::shared_ptr<const std::string> map = request_handler.RenderMapSvg();
+    writer.StartDict()
+            .Key("map"s).Value(*map)
+            .Key("request_id"s).Value(request.id)
+          .EndDict();
+}
+
+static void WriteNearbyStops(const transport_catalogue::TransportCatalogue& db, const json_reader::StatRequest& request,
+                             const std::vector<domain::NearbyStop>& stops, json::Writer& writer) {
+    json::Writer::ArrayContext stops_arr = writer.StartDict().Key("request_id"s).Value(request.id).Key("stops"s).StartArray();
+    for (const domain::NearbyStop& stop : stops) {
+        stops_arr.StartDict()
+                .Key("distance"s).Value(stop.distance)
+                .Key("name"s).Value(db.GetStopName(stop.stop))
+              .EndDict();
+    }
+    stops_arr.EndArray()
+          .EndDict();
+}
+
+static void WriteBox(const transport_catalogue::TransportCatalogue& db, const json_reader::StatRequest& request, const RequestHandler& request_handler, json::Writer& writer) {
+    const std::vector<domain::StopId> stops = request_handler.GetStopsInBox(request.box);
+    json::Writer::ArrayContext buses_arr = writer.StartDict().Key("buses"s).StartArray();
+    for (domain::BusId bus : request_handler.GetBusesByStops(stops)) {
+        buses_arr.Value(db.GetBusName(bus));
+    }
+    json::Writer::ArrayContext stops_arr = buses_arr.EndArray().Key("request_id"s).Value(request.id).Key("stops"s).StartArray();
+    for (domain::StopId stop : stops) {
+        stops_arr.Value(db.GetStopName(stop));
+    }
+    stops_arr.EndArray()
+          .EndDict();
+}
+
+static void WriteRoute(const transport_catalogue::TransportCatalogue& db, const json_reader::StatRequest& request, const RequestHandler& request_handler, json::Writer& writer) {
+    if (!request_handler.HasRouting()) {
+        writer.StartDict()
+                .Key("error_message"s).Value("no routing settings"sv)
+                .Key("request_id"s).Value(request.id)
+              .EndDict();
+        return;
+    }
+    const std::optional<router::RouteInfo> route = request_handler.GetRoute(request.from, request.to, request.metric);
+    if (!route) {
+        WriteErrorMessage(request, writer);
+        return;
+    }
+    json::Writer::ArrayContext items = writer.StartDict().Key("items"s).StartArray();
+    for (const router::RouteItem& item : route->items) {
+        if (item.type == router::RouteItem::Type::Wait) {
+            items.StartDict()
+                    .Key("stop_name"s).Value(db.GetStopName(item.stop))
+                    .Key("time"s).Value(item.time)
+                    .Key("type"s).Value("Wait"sv)
+                  .EndDict();
+        } else {
+            items.StartDict()
+                    .Key("bus"s).Value(db.GetBusName(item.bus))
+                    .Key("span_count"s).Value(item.span_count)
+                    .Key("time"s).Value(item.time)
+                    .Key("type"s).Value("Bus"sv)
+                  .EndDict();
+        }
+    }
+    json::Writer::DictContext result = items.EndArray()
+            .Key("request_id"s).Value(request.id);
+    if (request.metric == router::Metric::Distance) {
+        result.Key("total_distance"s).Value(route->total_distance);
+    }
+    result.Key("total_time"s).Value(route->total_time)
+          .EndDict();
+}
+
+void WriteResponse(const transport_catalogue::TransportCatalogue& db, const StatRequest& request, const RequestHandler& request_handler, json::Writer& writer) {
+    switch (request.type) {
+        case TypeRequest::Stop:
+            WriteStop(db, request, request_handler, writer);
+            break;
+        case TypeRequest::Bus:
+            WriteBus(request, request_handler, writer);
+            break;
+        case TypeRequest::Map:
+            WriteMap(request, request_handler, writer);
+            break;
+        case TypeRequest::NearestStops:
+            WriteNearbyStops(db, request, request_handler.GetNearestStops(request.point, std::max(request.count, 0)), writer);
+            break;
+        case TypeRequest::StopsInRadius:
+            WriteNearbyStops(db, request, request_handler.GetStopsInRadius(request.point, request.radius), writer);
+            break;
+        case TypeRequest::Box:
+            WriteBox(db, request, request_handler, writer);
+            break;
+        case TypeRequest::Route:
+            WriteRoute(db, request, request_handler, writer);
+            break;
+        case TypeRequest::Update:
+            writer.StartDict()
+                    .Key("error_message"s).Value("catalogue is read-only"sv)
+                    .Key("request_id"s).Value(request.id)
+                  .EndDict();
+            break;
+        case TypeRequest::Cities:
+            writer.StartDict()
+                    .Key("error_message"s).Value("no city registry"sv)
+                    .Key("request_id"s).Value(request.id)
+                  .EndDict();
+            break;
+    }
+}
+
+static domain::StopId GetStopId(const transport_catalogue::TransportCatalogue& db, std::string_view name) {
+    if (std::optional<domain::StopId> stop = db.FindStop(name)) {
+        return *stop;
+    }
+    throw std::invalid_argument("unknown stop "s + std::string(name));
+}
+
+static bool IsRemoval(const json::Dict& update) {
+    const auto action = update.find("action"sv);
+    if (action == update.end() || action->second.AsString() == "set"s) {
+        return false;
+    }
+    if (action->second.AsString() == "remove"s) {
+        return true;
+    }
+    throw std::invalid_argument("unknown action "s + action->second.AsString());
+}
+
+static void ApplyStopUpdate(transport_catalogue::TransportCatalogue& db, const json::Dict& update) {
+    const std::string& name = update.at("name").AsString();
+    if (IsRemoval(update)) {
+        db.RemoveStop(GetStopId(db, name));
+        return;
+    }
+    const geo::Coordinates coordinates{update.at("latitude").AsDouble(), update.at("longitude").AsDouble()};
+    domain::StopId stop;
+    if (std::optional<domain::StopId> existing = db.FindStop(name)) {
+        stop = *existing;
+        db.SetStopCoordinates(stop, coordinates);
+    } else {
+        stop = db.AddStop(name, coordinates);
+    }
+    const auto road_distances = update.find("road_distances"sv);
+    if (road_distances == update.end() || !road_distances->second.IsDict()) {
+        return;
+    }
+    for (const auto& [stop_name, distance] : road_distances->second.AsDict()) {
+        db.AddDistanceToStops(stop, GetStopId(db, stop_name), distance.AsInt());
+    }
+}
+
+static void ApplyBusUpdate(transport_catalogue::TransportCatalogue& db, const json::Dict& update) {
+    const std::string& name = update.at("name").AsString();
+    const std::optional<domain::BusId> bus = db.FindBus(name);
+    if (IsRemoval(update)) {
+        if (!bus) {
+            throw std::invalid_argument("unknown bus "s + name);
+        }
+        db.RemoveBus(*bus);
+        return;
+    }
+    std::vector<domain::StopId> stops;
+    for (std::string_view stop_name : GetStopsNames(update)) {
+        stops.push_back(GetStopId(db, stop_name));
+    }
+    if (bus) {
+        db.SetRoute(*bus, stops, GetTypeRoute(update));
+    } else {
+        db.AddBus(name, stops, GetTypeRoute(update));
+    }
+}
+
+static void ApplyDistanceUpdate(transport_catalogue::TransportCatalogue& db, const json::Dict& update) {
+    const domain::StopId from = GetStopId(db, update.at("from").AsString());
+    const domain::StopId to = GetStopId(db, update.at("to").AsString());
+    if (IsRemoval(update)) {
+        db.RemoveDistance(from, to);
     } else {
-        domain::BusStat b = *bus;
-        return json::Builder{}.StartDict()
-                                .Key("curvature"s).Value(b.curvature)
-                                .Key("request_id"s).Value(request.id)
-                                .Key("route_length"s).Value(b.route_length)
-                                .Key("stop_count"s).Value(b.stop_count)
-                                .Key("unique_stop_count"s).Value(b.unique_stop_count)
-                              .EndDict()
-                              .Build()
-                              .AsDict();
-    }
-}
-
-static json::Dict GetMap(const json_reader::StatRequest& request, const RequestHandler& request_handler) {
-    std::stringstream sstrm;
-    svg::Document doc = request_handler.RenderMap();
-    doc.Render(sstrm);
-    std::string test_str = sstrm.str();
-    return json::Builder{}.StartDict()
-                            .Key("map"s).Value(sstrm.str())
-                            .Key("request_id"s).Value(request.id)
-                          .EndDict().Build().AsDict();    
-}
-
-void JsonReader::Out(transport_catalogue::TransportCatalogue& db, const RequestHandler& request_handler, std::ostream& output) const {
+        db.AddDistanceToStops(from, to, update.at("distance").AsInt());
+    }
+}
+
+//Применяет изменения по порядку и возвращает их число. Исключение первого неудачного изменения
+//пробрасывается с его номером, а db тогда остаётся изменённым наполовину
+static int ApplyUpdates(transport_catalogue::TransportCatalogue& db, const StatRequest& request) {
+    int applied = 0;
+    for (const json::Node& node : *request.updates) {
+        try {
+            const json::Dict& update = node.AsDict();
+            const std::string& type = update.at("type").AsString();
+            if (type == "Stop"s) {
+                ApplyStopUpdate(db, update);
+            } else if (type == "Bus"s) {
+                ApplyBusUpdate(db, update);
+            } else if (type == "Distance"s) {
+                ApplyDistanceUpdate(db, update);
+            } else {
+                throw std::invalid_argument("unknown update type "s + type);
+            }
+        } catch (const std::exception& e) {
+            throw std::invalid_argument("update "s + std::to_string(applied) + ": "s + e.what());
+        }
+        ++applied;
+    }
+    return applied;
+}
+
+static void WriteUpdateResult(const StatRequest& request, int applied, const std::string* error, json::Writer& writer) {
+    json::Writer::DictContext dict = writer.StartDict().Key("applied"s).Value(applied);
+    if (error != nullptr) {
+        dict.Key("error_message"s).Value(*error);
+    }
+    dict.Key("request_id"s).Value(request.id).EndDict();
+}
+
+void ApplyUpdate(transport_catalogue::TransportCatalogue& db, const StatRequest& request, json::Writer& writer) {
+    //Изменения применяются к копии, которая разделяет с db неизменённые столбцы.
+    //При ошибке копия отбрасывается, и db остаётся прежним
+    transport_catalogue::TransportCatalogue updated = db;
+    try {
+        const int applied = ApplyUpdates(updated, request);
+        db = std::move(updated);
+        WriteUpdateResult(request, applied, nullptr, writer);
+    } catch (const std::exception& e) {
+        const std::string error = e.what();
+        WriteUpdateResult(request, 0, &error, writer);
+    }
+}
+
+//План ответов на stat_requests: одинаковые запросы Bus, Stop и Map между двумя Update
+//получают общий ответ, который вычисляется один раз
+struct RequestPlan {
+    static constexpr size_t UNIQUE = std::numeric_limits<size_t>::max();
+
+    std::vector<size_t> shared;  // для каждого запроса - номер общего ответа или UNIQUE
+    size_t shared_count = 0;
+    DedupStats stats;
+};
+
+static RequestPlan PlanRequests(const std::vector<StatRequest>& requests) {
+    RequestPlan plan;
+    std::vector<size_t> groups(requests.size(), RequestPlan::UNIQUE);
+    std::vector<size_t> group_sizes;
+    std::unordered_map<std::string_view, size_t> buses;
+    std::unordered_map<std::string_view, size_t> stops;
+    size_t map = RequestPlan::UNIQUE;
+    //Добавляет запрос в группу group, а если её ещё нет (UNIQUE) - создаёт
+    auto add_to_group = [&](size_t& group, DedupCount& count) {
+        ++count.requests;
+        if (group == RequestPlan::UNIQUE) {
+            group = group_sizes.size();
+            group_sizes.push_back(0);
+            ++count.answers;
+        }
+        ++group_sizes[group];
+        return group;
+    };
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const StatRequest& request = requests[i];
+        switch (request.type) {
+            case TypeRequest::Bus:
+                groups[i] = add_to_group(buses.try_emplace(request.name, RequestPlan::UNIQUE).first->second, plan.stats.bus);
+                break;
+            case TypeRequest::Stop:
+                groups[i] = add_to_group(stops.try_emplace(request.name, RequestPlan::UNIQUE).first->second, plan.stats.stop);
+                break;
+            case TypeRequest::Map:
+                groups[i] = add_to_group(map, plan.stats.map);
+                break;
+            case TypeRequest::Update:
+                //После изменения справочника ответы вычисляются заново
+                buses.clear();
+                stops.clear();
+                map = RequestPlan::UNIQUE;
+                break;
+            default:
+                break;
+        }
+    }
+
+    //Запросы без повторов отвечаются напрямую, без буфера
+    std::vector<size_t> shared_numbers(group_sizes.size(), RequestPlan::UNIQUE);
+    for (size_t group = 0; group < group_sizes.size(); ++group) {
+        if (group_sizes[group] > 1) {
+            shared_numbers[group] = plan.shared_count++;
+        }
+    }
+    plan.shared.resize(requests.size(), RequestPlan::UNIQUE);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (groups[i] != RequestPlan::UNIQUE) {
+            plan.shared[i] = shared_numbers[groups[i]];
+        }
+    }
+    return plan;
+}
+
+//Позиция и длина значения request_id в записанном ответе
+struct IdPosition {
+    size_t offset = 0;
+    size_t length = 0;
+};
+
+//Дописывает в text ответ на request, записанный как элемент массива верхнего уровня, но без отступа
+//перед ним. Возвращает, где в text записано значение request_id
+static IdPosition AppendAnswer(const transport_catalogue::TransportCatalogue& db, const StatRequest& request,
+                           const RequestHandler& request_handler, bool compact, std::string& text) {
+    std::ostringstream output;
+    json::Writer writer(output, compact);
+    writer.ContinueArray(false);
+    WriteResponse(db, request, request_handler, writer);
+    const std::string answer = std::move(output).str();
+    const size_t begin = answer.find_first_not_of(' ');
+
+    //Ключ с двоеточием не может встретиться внутри строки: кавычки в строках экранируются
+    const std::string_view key = "\"request_id\":"sv;
+    const size_t key_offset = answer.find(key);
+    assert(key_offset != std::string::npos);
+    //Границы значения берутся из записанного текста, а не из формата и длины request_id
+    const size_t value_begin = answer.find_first_not_of(' ', key_offset + key.size());
+    const size_t value_end = answer.find_first_not_of("-0123456789"sv, value_begin);
+    assert(value_end != std::string::npos && value_end > value_begin);
+    const IdPosition position{text.size() + value_begin - begin, value_end - value_begin};
+    text.append(answer, begin);
+    return position;
+}
+
+//Общий ответ на одинаковые запросы. Вычисляется первым запросом группы, который до него дошёл,
+//в том числе из разных потоков
+struct SharedAnswer {
+    std::once_flag computed;
+    std::string text;
+    IdPosition id;  // значение request_id в text
+};
+
+static void WritePlannedResponse(const transport_catalogue::TransportCatalogue& db, const StatRequest& request,
+                                 const RequestHandler& request_handler, SharedAnswer* answer, json::Writer& writer) {
+    if (answer == nullptr) {
+        WriteResponse(db, request, request_handler, writer);
+        return;
+    }
+    std::call_once(answer->computed, [&] {
+        answer->id = AppendAnswer(db, request, request_handler, false, answer->text);
+    });
+    const std::string_view text = answer->text;
+    writer.RawValue(text.substr(0, answer->id.offset), request.id, text.substr(answer->id.offset + answer->id.length));
+}
+
+MaterializedAnswers::MaterializedAnswers(const transport_catalogue::TransportCatalogue& db, const RequestHandler& request_handler, bool compact)
+    : db_(db)
+    , buses_(db.GetBusCount())
+    , stops_(db.GetStopCount()) {
+    //Ответы записываются с request_id = 0, при выводе значение заменяется на request_id запроса
+    StatRequest request;
+    request.id = 0;
+    request.type = TypeRequest::Bus;
+    auto append = [&](Fragment& fragment) {
+        fragment.offset = arena_.size();
+        const IdPosition id = AppendAnswer(db, request, request_handler, compact, arena_);
+        fragment.id_offset = static_cast<uint32_t>(id.offset - fragment.offset);
+        fragment.id_length = static_cast<uint32_t>(id.length);
+        fragment.length = static_cast<uint32_t>(arena_.size() - fragment.offset);
+    };
+    for (domain::BusId bus = 0; bus < buses_.size(); ++bus) {
+        //Удалённые и заменённые маршруты не находятся по имени, им ответ не нужен
+        request.name = db.GetBusName(bus);
+        if (db.FindBus(request.name) == bus) {
+            append(buses_[bus]);
+        }
+    }
+    request.type = TypeRequest::Stop;
+    for (domain::StopId stop = 0; stop < stops_.size(); ++stop) {
+        request.name = db.GetStopName(stop);
+        if (db.FindStop(request.name) == stop) {
+            append(stops_[stop]);
+        }
+    }
+    arena_.shrink_to_fit();
+}
+
+bool MaterializedAnswers::Write(const StatRequest& request, json::Writer& writer) const {
+    const Fragment* fragment = nullptr;
+    if (request.type == TypeRequest::Bus) {
+        if (const std::optional<domain::BusId> bus = db_.FindBus(request.name)) {
+            fragment = &buses_[*bus];
+        }
+    } else if (request.type == TypeRequest::Stop) {
+        if (const std::optional<domain::StopId> stop = db_.FindStop(request.name)) {
+            fragment = &stops_[*stop];
+        }
+    }
+    if (fragment == nullptr || fragment->length == 0) {
+        return false;
+    }
+    const std::string_view answer(arena_.data() + fragment->offset, fragment->length);
+    writer.RawValue(answer.substr(0, fragment->id_offset), request.id, answer.substr(fragment->id_offset + fragment->id_length));
+    return true;
+}
+
+size_t MaterializedAnswers::GetAnswerCount() const {
+    auto count = [](const std::vector<Fragment>& fragments) {
+        return std::count_if(fragments.begin(), fragments.end(), [](const Fragment& fragment) {
+            return fragment.length > 0;
+        });
+    };
+    return count(buses_) + count(stops_);
+}
+
+size_t MaterializedAnswers::GetMemoryUsage() const {
+    return arena_.capacity() + (buses_.capacity() + stops_.capacity()) * sizeof(Fragment);
+}
+
+//Порция запросов для параллельного ответа. Map отрисовывает всю карту, поэтому получает
+//отдельную порцию и не задерживает ответы на соседние запросы
+static constexpr size_t REQUESTS_PER_CHUNK = 256;
+
+//Отвечает на запросы [begin, end) без Update в потоках pool и выводит ответы как продолжение массива.
+//Свободный поток забирает следующую порцию по атомарному счётчику и записывает ответы в свой буфер,
+//а вызывающий поток выводит буферы по порядку, как только готова очередная порция.
+//respond(request, writer) записывает ответ на запрос
+template <typename Respond>
+static void AnswerInParallel(const StatRequest* begin, const StatRequest* end, bool has_items,
+                             concurrency::ThreadPool& pool, std::ostream& output, Respond respond) {
+    struct Chunk {
+        const StatRequest* begin;
+        const StatRequest* end;
+        std::string answers;
+        std::exception_ptr error;
+        bool ready = false;
+    };
+    std::vector<Chunk> chunks;
+    for (const StatRequest* chunk_begin = begin; chunk_begin != end;) {
+        const StatRequest* chunk_end = chunk_begin + 1;
+        if (chunk_begin->type != TypeRequest::Map) {
+            const StatRequest* limit = chunk_begin + std::min<size_t>(REQUESTS_PER_CHUNK, end - chunk_begin);
+            chunk_end = std::find_if(chunk_begin, limit, [](const StatRequest& request) {
+                return request.type == TypeRequest::Map;
+            });
+        }
+        chunks.push_back({chunk_begin, chunk_end, {}, nullptr, false});
+        chunk_begin = chunk_end;
+    }
+
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t running = std::min(pool.GetThreadCount(), chunks.size());
+    for (size_t i = 0; i < running; ++i) {
+        pool.Submit([&] {
+            for (size_t index = next.fetch_add(1); index < chunks.size(); index = next.fetch_add(1)) {
+                Chunk& chunk = chunks[index];
+                std::ostringstream answers;
+                std::exception_ptr error;
+                try {
+                    json::Writer writer(answers);
+                    writer.ContinueArray(has_items || index > 0);
+                    for (const StatRequest* request = chunk.begin; request != chunk.end; ++request) {
+                        respond(*request, writer);
+                    }
+                } catch (...) {
+                    error = std::current_exception();
+                    next = chunks.size();
+                }
+                std::lock_guard lock(mutex);
+                chunk.answers = std::move(answers).str();
+                chunk.error = error;
+                chunk.ready = true;
+                changed.notify_all();
+            }
+            std::lock_guard lock(mutex);
+            --running;
+            changed.notify_all();
+        });
+    }
+
+    std::exception_ptr error;
+    for (Chunk& chunk : chunks) {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] {
+            return chunk.ready || running == 0;
+        });
+        if (!chunk.ready || chunk.error) {
+            error = chunk.error;
+            break;
+        }
+        const std::string answers = std::move(chunk.answers);
+        lock.unlock();
+        output << answers;
+    }
+    //Задачи ссылаются на локальные переменные, поэтому выходим только после их завершения
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [&] {
+        return running == 0;
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+DedupStats JsonReader::Out(transport_catalogue::TransportCatalogue& db, const RequestHandler& request_handler, std::ostream& output,
+                           size_t thread_count) const {
     std::vector<StatRequest> stat_requests = GetRequest();  //Получаем Запросы
-    json::Array arr;
-    for (const json_reader::StatRequest& request : stat_requests) {
-        if (request.type == json_reader::TypeRequest::Stop) {
-            arr.emplace_back(GetStop(db, request, request_handler));
+    const RequestPlan plan = PlanRequests(stat_requests);
+    std::vector<SharedAnswer> shared_answers(plan.shared_count);
+    const StatRequest* const first = stat_requests.data();
+    auto respond = [&](const StatRequest& request, json::Writer& writer) {
+        const size_t shared = plan.shared[&request - first];
+        WritePlannedResponse(db, request, request_handler, shared == RequestPlan::UNIQUE ? nullptr : &shared_answers[shared], writer);
+    };
+
+    json::Writer writer(output);
+    writer.StartArray();
+    if (thread_count <= 1 || stat_requests.size() <= REQUESTS_PER_CHUNK) {
+        //Ответ на каждый запрос выводится сразу после вычисления, поэтому ответы не накапливаются в памяти
+        for (const json_reader::StatRequest& request : stat_requests) {
+            if (request.type == TypeRequest::Update) {
+                ApplyUpdate(db, request, writer);
+            } else {
+                respond(request, writer);
+            }
         }
-        if (request.type == json_reader::TypeRequest::Bus) {
-            arr.emplace_back(GetBus(request, request_handler));
+    } else {
+        concurrency::ThreadPool pool(thread_count);
+        const StatRequest* const last = first + stat_requests.size();
+        for (const StatRequest* begin = first; begin != last;) {
+            const StatRequest* update = std::find_if(begin, last, [](const StatRequest& request) {
+                return request.type == TypeRequest::Update;
+            });
+            if (update != begin) {
+                AnswerInParallel(begin, update, begin != first, pool, output, respond);
+            }
+            if (update == last) {
+                break;
+            }
+            //Update меняет справочник, поэтому применяется, когда ответы на предыдущие запросы уже выведены
+            json::Writer update_writer(output);
+            update_writer.ContinueArray(update != first);
+            ApplyUpdate(db, *update, update_writer);
+            begin = update + 1;
         }
-        if (request.type == json_reader::TypeRequest::Map) {
-            arr.emplace_back(GetMap(request, request_handler));
+    }
+    writer.EndArray();
+    return plan.stats;
+}
+
+static void WriteLineError(const json::Node* id, std::string_view message, std::ostream& output) {
+    json::Writer writer(output, true);
+    json::Writer::DictContext dict = writer.StartDict().Key("error_message"s).Value(message);
+    if (id != nullptr && id->IsInt()) {
+        dict.Key("request_id"s).Value(id->AsInt());
+    } else {
+        dict.Key("request_id"s).Value(nullptr);
+    }
+    dict.EndDict();
+}
+
+//Разобранный запрос передаётся в respond вместе с компактным json::Writer для ответа
+template <typename Respond>
+static bool AnswerLine(std::string_view line, std::ostream& output, Respond respond) {
+    if (line.find_first_not_of(" \t\r"sv) == std::string_view::npos) {
+        return false;
+    }
+    json::Document document{nullptr};
+    try {
+        document = json::Load(line);
+    } catch (const json::ParsingError& e) {
+        WriteLineError(nullptr, e.what(), output);
+        return true;
+    }
+    if (!document.GetRoot().IsDict()) {
+        WriteLineError(nullptr, "request must be a dict"sv, output);
+        return true;
+    }
+    const json::Dict& request = document.GetRoot().AsDict();
+    const auto id = request.find("id"sv);
+    const json::Node* id_node = id == request.end() ? nullptr : &id->second;
+    try {
+        if (std::optional<StatRequest> req = ParseStatRequest(request)) {
+            json::Writer writer(output, true);
+            respond(*req, writer);
+        } else {
+            WriteLineError(id_node, "unknown request type"sv, output);
         }
+    } catch (const std::exception& e) {
+        WriteLineError(id_node, e.what(), output);
     }
-    json::Print(json::Document{arr}, output);
+    return true;
+}
+
+bool AnswerJsonLine(std::string_view line, std::ostream& output, const transport_catalogue::TransportCatalogue& db,
+                    const RequestHandler& request_handler) {
+    return AnswerLine(line, output, [&](const StatRequest& request, json::Writer& writer) {
+        WriteResponse(db, request, request_handler, writer);
+    });
+}
+
+bool AnswerJsonLine(std::string_view line, std::ostream& output, transport_catalogue::TransportCatalogue& db,
+                    const RequestHandler& request_handler) {
+    return AnswerLine(line, output, [&](const StatRequest& request, json::Writer& writer) {
+        if (request.type == TypeRequest::Update) {
+            ApplyUpdate(db, request, writer);
+        } else {
+            WriteResponse(db, request, request_handler, writer);
+        }
+    });
+}
+
+static void RespondVersioned(transport_catalogue::VersionedCatalogue& catalogue, const StatRequest& request, json::Writer& writer) {
+    if (request.type == TypeRequest::Update) {
+        //Modify сам работает с копией: если пакет не применился, копия отбрасывается без новой версии
+        int applied = 0;
+        try {
+            catalogue.Modify([&](transport_catalogue::TransportCatalogue& db) {
+                applied = ApplyUpdates(db, request);
+            });
+        } catch (const std::exception& e) {
+            const std::string error = e.what();
+            WriteUpdateResult(request, 0, &error, writer);
+            return;
+        }
+        WriteUpdateResult(request, applied, nullptr, writer);
+    } else {
+        const transport_catalogue::VersionedCatalogue::Snapshot version = catalogue.Read();
+        WriteResponse(version->GetCatalogue(), request, version->GetHandler(), writer);
+    }
+}
+
+static void WriteCities(const transport_catalogue::CatalogueRegistry& registry, const StatRequest& request, json::Writer& writer) {
+    json::Writer::ArrayContext cities_arr = writer.StartDict().Key("cities"s).StartArray();
+    for (const transport_catalogue::CatalogueRegistry::CityInfo& city : registry.GetCities()) {
+        cities_arr.StartDict()
+                .Key("bus_count"s).Value(static_cast<int>(city.bus_count))
+                .Key("memory_kb"s).Value(static_cast<int>(city.memory_usage / 1024))
+                .Key("name"s).Value(city.key)
+                .Key("stop_count"s).Value(static_cast<int>(city.stop_count))
+                .Key("version"s).Value(static_cast<int>(city.version))
+              .EndDict();
+    }
+    cities_arr.EndArray()
+            .Key("request_id"s).Value(request.id)
+          .EndDict();
+}
+
+bool AnswerJsonLine(std::string_view line, std::ostream& output, transport_catalogue::VersionedCatalogue& catalogue) {
+    return AnswerLine(line, output, [&](const StatRequest& request, json::Writer& writer) {
+        RespondVersioned(catalogue, request, writer);
+    });
+}
+
+bool AnswerJsonLine(std::string_view line, std::ostream& output, const transport_catalogue::CatalogueRegistry& registry) {
+    return AnswerLine(line, output, [&](const StatRequest& request, json::Writer& writer) {
+        if (request.type == TypeRequest::Cities) {
+            WriteCities(registry, request, writer);
+        } else if (transport_catalogue::VersionedCatalogue* catalogue = registry.Find(request.city)) {
+            RespondVersioned(*catalogue, request, writer);
+        } else {
+            writer.StartDict()
+                    .Key("error_message"s).Value("unknown city"sv)
+                    .Key("request_id"s).Value(request.id)
+                  .EndDict();
+        }
+    });
+}
+
+JsonLinesStats ServeJsonLines(std::istream& input, std::ostream& output, transport_catalogue::TransportCatalogue& db,
+                              const RequestHandler& request_handler, size_t batch_size, const MaterializedAnswers* answers) {
+    using Clock = std::chrono::steady_clock;
+    auto respond = [&](const StatRequest& request, json::Writer& writer) {
+        if (request.type == TypeRequest::Update) {
+            ApplyUpdate(db, request, writer);
+            answers = nullptr;  //Заранее записанные ответы устарели
+        } else if (answers == nullptr || !answers->Write(request, writer)) {
+            WriteResponse(db, request, request_handler, writer);
+        }
+    };
+    JsonLinesStats stats;
+    size_t pending = 0;
+    std::string line;
+    while (std::getline(input, line)) {
+        const auto start = Clock::now();
+        if (!AnswerLine(line, output, respond)) {
+            continue;
+        }
+        output.put('\n');
+        //Ответы придерживаются, пока во входном буфере есть следующие запросы, но не больше batch_size
+        if (++pending >= batch_size || input.rdbuf()->in_avail() <= 0) {
+            output.flush();
+            pending = 0;
+        }
+        const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        ++stats.requests;
+        stats.total_latency += latency;
+        stats.max_latency = std::max(stats.max_latency, latency);
+    }
+    output.flush();
+    return stats;
 }
 
 static void AddSvgSettings(const json::Dict& settings, renderer::SvgRenderSettings& svg) {
@@ -258,13 +1144,11 @@ static void AddColorPalette(const json::Dict& settings, std::vector<svg::Color>&
 }
 renderer::RenderSettings JsonReader::GetRenderSettings() const {
     renderer::RenderSettings render_setting;
-    json::Node root = document_.GetRoot();
-    json::Dict dict;
+    const json::Node& root = document_.GetRoot();
     if (root.IsDict()) {
-        dict = root.AsDict();
+        const json::Dict& dict = root.AsDict();
         if (dict.count("render_settings"s) > 0) {
-            json::Node render_settings_node = dict.at("render_settings"s);
-            json::Dict settings = render_settings_node.AsDict();
+            const json::Dict& settings = dict.at("render_settings"s).AsDict();
             AddSvgSettings(settings, render_setting.svg);
             AddBusSettings(settings, render_setting.bus);
             AddStopSettings(settings, render_setting.stop);
@@ -275,4 +1159,37 @@ renderer::RenderSettings JsonReader::GetRenderSettings() const {
     return render_setting;
 }
 
+std::optional<router::RoutingSettings> JsonReader::GetRoutingSettings() const {
+    const json::Node& root = document_.GetRoot();
+    if (!root.IsDict() || root.AsDict().count("routing_settings"s) == 0) {
+        return std::nullopt;
+    }
+    const json::Dict& settings = root.AsDict().at("routing_settings"s).AsDict();
+    router::RoutingSettings result{settings.at("bus_wait_time"s).AsInt(), settings.at("bus_velocity"s).AsDouble()};
+    if (const auto hierarchies = settings.find("contraction_hierarchies"sv); hierarchies != settings.end()) {
+        result.contraction_hierarchies = hierarchies->second.AsBool();
+    }
+    return result;
+}
+
+void LoadBaseFile(const std::string& path, transport_catalogue::TransportCatalogue& db, renderer::RenderSettings& render_settings,
+                  std::optional<router::RoutingSettings>& routing_settings,
+                  std::shared_ptr<const router::TransportRouter>& transport_router) {
+    io::MappedFile file(path);
+    if (serialization::IsSnapshot(file.GetData())) {
+        serialization::LoadSnapshot(path, db, render_settings, routing_settings, transport_router);
+        return;
+    }
+    transport_router.reset();
+    JsonReader reader(file.GetData(), db);
+    render_settings = reader.GetRenderSettings();
+    routing_settings = reader.GetRoutingSettings();
+}
+
+serialization::SerializationSettings JsonReader::GetSerializationSettings() const {
+    serialization::SerializationSettings settings;
+    settings.file = document_.GetRoot().AsDict().at("serialization_settings"s).AsDict().at("file"s).AsString();
+    return settings;
+}
+
 }  // namespace json_reader
\ No newline at end of file
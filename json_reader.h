@@ -1,38 +1,177 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "json.h"
 #include "json_builder.h"
+#include "json_writer.h"
 #include "map_renderer.h"
 #include "request_handler.h"
+#include "serialization.h"
+#include "catalogue_registry.h"
 #include "transport_catalogue.h"
+#include "transport_router.h"
+#include "versioned_catalogue.h"
 
 namespace json_reader {
 enum class TypeRequest {
     Bus,
     Stop,
-    Map
+    Map,
+    Update,
+    NearestStops,
+    StopsInRadius,
+    Box,
+    Cities,
+    Route
 };
 
 struct StatRequest {
     int id;
     TypeRequest type;
-    std::string name;
+    std::string_view name;  // указывает на строку в разобранном документе
+    std::string_view from;  // остановки запроса Route
+    std::string_view to;
+    router::Metric metric = router::Metric::Time;  // что минимизирует запрос Route
+    std::string_view city;  // ключ города для CatalogueRegistry, пустой - если не задан
+    const json::Array* updates = nullptr;  // изменения запроса Update
+    geo::Coordinates point{};              // точка запросов NearestStops и StopsInRadius
+    int count = 0;                         // число остановок запроса NearestStops
+    double radius = 0;                     // радиус запроса StopsInRadius в метрах
+    geo::Box box{};                        // прямоугольник запроса Box
 };
 
+// Разбирает запрос из stat_requests. Для запроса неизвестного типа возвращает nullopt.
+// Запрос ссылается на request и действителен, пока жив документ
+std::optional<StatRequest> ParseStatRequest(const json::Dict& request);
+
+// Записывает ответ на запрос request в writer. На запросы Update и Cities отвечает ошибкой:
+// справочник только для чтения и не входит в CatalogueRegistry
+void WriteResponse(const transport_catalogue::TransportCatalogue& db, const StatRequest& request,
+                   const RequestHandler& request_handler, json::Writer& writer);
+
+// Применяет к db изменения из запроса Update по порядку. Каждое изменение устроено как элемент base_requests:
+// {"type": "Stop", "name", "latitude", "longitude", "road_distances"} добавляет остановку или переносит
+// существующую и задаёт расстояния от неё; {"type": "Bus", "name", "stops", "is_roundtrip"} добавляет маршрут
+// или заменяет его остановки; {"type": "Distance", "from", "to", "distance"} задаёт расстояние.
+// С "action": "remove" остановка, маршрут или расстояние удаляются. Пакет применяется целиком или никак:
+// ответ содержит число применённых изменений applied, а при ошибке db не меняется, applied равно 0
+// и в ответ добавляется error_message с номером неудачного изменения (с нуля)
+void ApplyUpdate(transport_catalogue::TransportCatalogue& db, const StatRequest& request, json::Writer& writer);
+
+// Сколько запросов одного типа пришло в stat_requests и сколько разных ответов на них вычислено
+struct DedupCount {
+    size_t requests = 0;
+    size_t answers = 0;
+};
+
+struct DedupStats {
+    DedupCount bus;
+    DedupCount stop;
+    DedupCount map;
+};
+
+// Заранее записанные ответы на все запросы Bus и Stop неизменяемого справочника. Ответы без значения
+// request_id хранятся подряд в одном буфере, для каждого маршрута и остановки - смещение и длина ответа
+// и позиция и длина request_id в нём. Ответ на запрос - копирование из буфера со вставкой request_id,
+// без json::Builder и json::Dict. После изменения справочника ответы устаревают
+class MaterializedAnswers {
+   public:
+    // compact - формат ответов: компактный, как у AnswerJsonLine, или с отступами, как у JsonReader::Out
+    MaterializedAnswers(const transport_catalogue::TransportCatalogue& db, const RequestHandler& request_handler, bool compact);
+
+    // Записывает готовый ответ на запрос Bus или Stop. Для других запросов и неизвестных имён
+    // возвращает false, тогда отвечать нужно через WriteResponse
+    bool Write(const StatRequest& request, json::Writer& writer) const;
+
+    size_t GetAnswerCount() const;
+    // Буфер ответов и индекс в байтах
+    size_t GetMemoryUsage() const;
+
+   private:
+    struct Fragment {
+        size_t offset = 0;       // начало ответа в arena_
+        uint32_t id_offset = 0;  // позиция request_id от начала ответа
+        uint32_t id_length = 0;  // длина записанного значения request_id
+        uint32_t length = 0;     // 0 - ответа нет
+    };
+
+    const transport_catalogue::TransportCatalogue& db_;
+    std::string arena_;
+    std::vector<Fragment> buses_;  // по BusId
+    std::vector<Fragment> stops_;  // по StopId
+};
+
+struct JsonLinesStats {
+    size_t requests = 0;
+    std::chrono::nanoseconds total_latency{0};
+    std::chrono::nanoseconds max_latency{0};
+};
+
+// Отвечает на запрос из одной строки JSON Lines: выводит ответ в компактном виде без перевода строки.
+// Ошибки разбора запроса выводятся как ответ с error_message. Для пустой строки ничего не выводит и возвращает false
+bool AnswerJsonLine(std::string_view line, std::ostream& output, const transport_catalogue::TransportCatalogue& db,
+                    const RequestHandler& request_handler);
+// То же, но запросы Update применяются к db
+bool AnswerJsonLine(std::string_view line, std::ostream& output, transport_catalogue::TransportCatalogue& db,
+                    const RequestHandler& request_handler);
+// То же для справочника с версиями: запрос читает текущую версию, а Update публикует новую.
+// Можно вызывать из нескольких потоков одновременно
+bool AnswerJsonLine(std::string_view line, std::ostream& output, transport_catalogue::VersionedCatalogue& catalogue);
+// То же для нескольких городов: запрос направляется в город по ключу "city" (без ключа - в город
+// с пустым ключом), а запрос Cities возвращает версию, размеры и занятую память каждого города
+bool AnswerJsonLine(std::string_view line, std::ostream& output, const transport_catalogue::CatalogueRegistry& registry);
+
+// Режим сервера: читает из input по одному запросу JSON в строке и выводит ответ одной строкой в компактном виде.
+// Поток вывода сбрасывается, когда входной буфер опустел или накоплено batch_size ответов.
+// Если заданы answers (в компактном формате), запросы Bus и Stop отвечаются из них до первого Update
+JsonLinesStats ServeJsonLines(std::istream& input, std::ostream& output, transport_catalogue::TransportCatalogue& db,
+                              const RequestHandler& request_handler, size_t batch_size = 1,
+                              const MaterializedAnswers* answers = nullptr);
+
+// Загружает справочник и настройки визуализации и маршрутизации из файла: либо из бинарного файла,
+// созданного make_base, либо из документа JSON с base_requests, render_settings и routing_settings.
+// Без настроек маршрутизации routing_settings - nullopt. transport_router - граф путей с иерархиями сжатия
+// из файла make_base или nullptr, если их нет: тогда граф строится при первом обращении
+void LoadBaseFile(const std::string& path, transport_catalogue::TransportCatalogue& db, renderer::RenderSettings& render_settings,
+                  std::optional<router::RoutingSettings>& routing_settings,
+                  std::shared_ptr<const router::TransportRouter>& transport_router);
+
 class JsonReader {
    public:
     JsonReader(std::istream& input) : document_(json::Load(input)){};
+    // Потоковый режим: запросы base_requests добавляются в db по мере разбора
+    // и не сохраняются в документе, поэтому FillDataBase для такого объекта не вызывается.
+    // Если в документе есть base_requests, после них вызывается TransportCatalogue::Finalize.
+    // input читается порциями (см. json::Parse), поэтому память занимают справочник и окно чтения, а не весь документ
+    JsonReader(std::istream& input, transport_catalogue::TransportCatalogue& db);
+    // Потоковый режим для документа в непрерывном буфере, например в файле, отображённом в память
+    JsonReader(std::string_view text, transport_catalogue::TransportCatalogue& db);
 
+    // Заполняет справочник и вычисляет статистику маршрутов (TransportCatalogue::Finalize)
     void FillDataBase(transport_catalogue::TransportCatalogue& db) const;
-    void Out(transport_catalogue::TransportCatalogue& db, const RequestHandler& request_handler, std::ostream& output) const;
+    // Отвечает на stat_requests по порядку, запросы Update применяются к db.
+    // Одинаковые запросы Bus и Stop (с тем же name) и Map между двумя Update отвечаются один раз:
+    // ответ записывается в буфер и выводится для каждого запроса со своим request_id.
+    // При thread_count > 1 запросы между двумя Update обрабатываются параллельно,
+    // а ответы выводятся в порядке запросов; сами Update применяются в вызывающем потоке
+    DedupStats Out(transport_catalogue::TransportCatalogue& db, const RequestHandler& request_handler, std::ostream& output,
+                   size_t thread_count = 1) const;
     renderer::RenderSettings GetRenderSettings() const;
+    // Настройки из routing_settings или nullopt, если раздела нет
+    std::optional<router::RoutingSettings> GetRoutingSettings() const;
+    serialization::SerializationSettings GetSerializationSettings() const;
 
    private:
     void AddStops(transport_catalogue::TransportCatalogue& db) const;
     void AddBuses(transport_catalogue::TransportCatalogue& db) const;
 
     std::vector<StatRequest> GetRequest(void) const;
-    json::Document document_;
+    json::Document document_{nullptr};
 };
 }  // namespace json_reader
@@ -0,0 +1,298 @@
+#include "json_scanner.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "json.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define JSON_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace json {
+
+namespace {
+using namespace std::literals;
+
+constexpr size_t BLOCK_SIZE = 64;
+// Количество позиций, после которого порция индекса считается заполненной
+constexpr size_t POSITIONS_PER_REFILL = 4096;
+
+// Битовые маски блока из 64 символов: бит i соответствует i-му символу блока
+struct BlockMasks {
+    uint64_t backslash;
+    uint64_t quote;
+    uint64_t whitespace;
+    uint64_t structural;  // { } [ ] : ,
+    uint64_t newline;     // \n и \r
+};
+
+using ClassifyFunction = BlockMasks (*)(const char* block);
+
+// ---------- Скалярная реализация ------------------
+
+//Нужна только там, где нет векторных инструкций x86
+#ifndef JSON_SCANNER_X86
+enum CharClass : uint8_t {
+    BACKSLASH = 1,
+    QUOTE = 2,
+    WHITESPACE = 4,
+    STRUCTURAL = 8,
+    NEWLINE = 16,
+};
+
+constexpr std::array<uint8_t, 256> MakeCharClasses() {
+    std::array<uint8_t, 256> classes{};
+    classes['\\'] = BACKSLASH;
+    classes['"'] = QUOTE;
+    classes[' '] = WHITESPACE;
+    classes['\t'] = WHITESPACE;
+    classes['\f'] = WHITESPACE;
+    classes['\v'] = WHITESPACE;
+    classes['\n'] = WHITESPACE | NEWLINE;
+    classes['\r'] = WHITESPACE | NEWLINE;
+    for (char c : {'{', '}', '[', ']', ':', ','}) {
+        classes[static_cast<unsigned char>(c)] = STRUCTURAL;
+    }
+    return classes;
+}
+
+constexpr std::array<uint8_t, 256> CHAR_CLASSES = MakeCharClasses();
+
+BlockMasks ClassifyScalar(const char* block) {
+    BlockMasks masks{};
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        const uint8_t char_class = CHAR_CLASSES[static_cast<unsigned char>(block[i])];
+        const uint64_t bit = uint64_t{1} << i;
+        masks.backslash |= (char_class & BACKSLASH) ? bit : 0;
+        masks.quote |= (char_class & QUOTE) ? bit : 0;
+        masks.whitespace |= (char_class & WHITESPACE) ? bit : 0;
+        masks.structural |= (char_class & STRUCTURAL) ? bit : 0;
+        masks.newline |= (char_class & NEWLINE) ? bit : 0;
+    }
+    return masks;
+}
+#endif
+
+// ---------- Векторные реализации ------------------
+
+#ifdef JSON_SCANNER_X86
+BlockMasks ClassifySse2(const char* block) {
+    BlockMasks masks{};
+    for (size_t offset = 0; offset < BLOCK_SIZE; offset += 16) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + offset));
+        auto match = [chars](char c) {
+            return _mm_cmpeq_epi8(chars, _mm_set1_epi8(c));
+        };
+        auto to_mask = [offset](__m128i bytes) {
+            return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(bytes))) << offset;
+        };
+        const __m128i newline = _mm_or_si128(match('\n'), match('\r'));
+        const __m128i whitespace = _mm_or_si128(_mm_or_si128(match(' '), match('\t')),
+                                                _mm_or_si128(_mm_or_si128(match('\f'), match('\v')), newline));
+        const __m128i brackets = _mm_or_si128(_mm_or_si128(match('{'), match('}')), _mm_or_si128(match('['), match(']')));
+        const __m128i structural = _mm_or_si128(brackets, _mm_or_si128(match(':'), match(',')));
+        masks.backslash |= to_mask(match('\\'));
+        masks.quote |= to_mask(match('"'));
+        masks.whitespace |= to_mask(whitespace);
+        masks.structural |= to_mask(structural);
+        masks.newline |= to_mask(newline);
+    }
+    return masks;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_SCANNER_AVX2 1
+__attribute__((target("avx2"))) BlockMasks ClassifyAvx2(const char* block) {
+    BlockMasks masks{};
+    for (size_t offset = 0; offset < BLOCK_SIZE; offset += 32) {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + offset));
+        auto match = [chars](char c) __attribute__((target("avx2"))) {
+            return _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(c));
+        };
+        auto to_mask = [offset](__m256i bytes) __attribute__((target("avx2"))) {
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(bytes))) << offset;
+        };
+        const __m256i newline = _mm256_or_si256(match('\n'), match('\r'));
+        const __m256i whitespace = _mm256_or_si256(_mm256_or_si256(match(' '), match('\t')),
+                                                   _mm256_or_si256(_mm256_or_si256(match('\f'), match('\v')), newline));
+        const __m256i brackets = _mm256_or_si256(_mm256_or_si256(match('{'), match('}')), _mm256_or_si256(match('['), match(']')));
+        const __m256i structural = _mm256_or_si256(brackets, _mm256_or_si256(match(':'), match(',')));
+        masks.backslash |= to_mask(match('\\'));
+        masks.quote |= to_mask(match('"'));
+        masks.whitespace |= to_mask(whitespace);
+        masks.structural |= to_mask(structural);
+        masks.newline |= to_mask(newline);
+    }
+    return masks;
+}
+#endif
+#endif
+
+struct Implementation {
+    ClassifyFunction classify;
+    std::string_view name;
+};
+
+Implementation ChooseImplementation() {
+#ifdef JSON_SCANNER_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return {ClassifyAvx2, "avx2"sv};
+    }
+#endif
+#ifdef JSON_SCANNER_X86
+    return {ClassifySse2, "sse2"sv};
+#else
+    return {ClassifyScalar, "scalar"sv};
+#endif
+}
+
+const Implementation& GetImplementation() {
+    static const Implementation implementation = ChooseImplementation();
+    return implementation;
+}
+
+// ---------- Операции над масками ------------------
+
+int CountTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// Бит i результата равен xor битов 0..i аргумента
+uint64_t PrefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// Возвращает маску символов, экранированных нечётной последовательностью обратных слэшей.
+// prev_ends_odd_backslash - признак того, что предыдущий блок закончился такой последовательностью
+uint64_t FindEscapedChars(uint64_t backslash, uint64_t& prev_ends_odd_backslash) {
+    constexpr uint64_t even_bits = 0x5555555555555555ULL;
+    constexpr uint64_t odd_bits = ~even_bits;
+
+    const uint64_t start_edges = backslash & ~(backslash << 1);
+    // Если предыдущий блок закончился нечётной серией, чётность начала серии в этом блоке меняется
+    const uint64_t even_start_mask = even_bits ^ prev_ends_odd_backslash;
+    const uint64_t even_starts = start_edges & even_start_mask;
+    const uint64_t odd_starts = start_edges & ~even_start_mask;
+    const uint64_t even_carries = backslash + even_starts;
+
+    uint64_t odd_carries = backslash + odd_starts;
+    const bool ends_odd_backslash = odd_carries < backslash;
+    odd_carries |= prev_ends_odd_backslash;
+    prev_ends_odd_backslash = ends_odd_backslash ? 1 : 0;
+
+    const uint64_t even_carry_ends = even_carries & ~backslash;
+    const uint64_t odd_carry_ends = odd_carries & ~backslash;
+    const uint64_t even_start_odd_end = even_carry_ends & odd_bits;
+    const uint64_t odd_start_even_end = odd_carry_ends & even_bits;
+    return even_start_odd_end | odd_start_even_end;
+}
+
+}  // namespace
+
+StructuralScanner::StructuralScanner(std::string_view text)
+    : text_(text) {
+    positions_.reserve(POSITIONS_PER_REFILL + BLOCK_SIZE);
+}
+
+StructuralScanner::StructuralScanner(std::istream& input)
+    : input_(&input) {
+    positions_.reserve(POSITIONS_PER_REFILL + BLOCK_SIZE);
+    window_.reserve(2 * CHUNK_SIZE);
+}
+
+std::string_view StructuralScanner::GetImplementationName() {
+    return GetImplementation().name;
+}
+
+bool StructuralScanner::Refill() {
+    positions_.clear();
+    current_ = 0;
+    while (positions_.size() < POSITIONS_PER_REFILL) {
+        if (input_ != nullptr && next_block_ + BLOCK_SIZE > text_begin_ + text_.size()) {
+            ReadInput();
+        }
+        const size_t text_end = text_begin_ + text_.size();
+        if (next_block_ >= text_end) {
+            break;
+        }
+        const size_t block_start = next_block_;
+        next_block_ += BLOCK_SIZE;
+        if (next_block_ <= text_end) {
+            ScanBlock(text_.data() + (block_start - text_begin_), block_start);
+        } else {
+            // Неполный последний блок дополняется пробелами. В потоковом режиме он бывает только в конце потока
+            char block[BLOCK_SIZE];
+            std::memset(block, ' ', BLOCK_SIZE);
+            std::memcpy(block, text_.data() + (block_start - text_begin_), text_end - block_start);
+            ScanBlock(block, block_start);
+            if (prev_in_string_) {
+                throw ParsingError("String parsing error"s);
+            }
+        }
+    }
+    return !positions_.empty();
+}
+
+void StructuralScanner::ReadInput() {
+    //Позиции выдаются по возрастанию, поэтому текст до предпоследней из них парсеру уже не нужен.
+    //Он отбрасывается, только когда его набралось на порцию, чтобы не сдвигать окно на каждом блоке
+    const size_t unused = std::min(previous_, next_block_) - text_begin_;
+    if (unused >= CHUNK_SIZE) {
+        window_.erase(0, unused);
+        text_begin_ += unused;
+    }
+    while (*input_ && next_block_ + BLOCK_SIZE > text_begin_ + window_.size()) {
+        const size_t size = window_.size();
+        window_.resize(size + CHUNK_SIZE);
+        input_->read(window_.data() + size, static_cast<std::streamsize>(CHUNK_SIZE));
+        window_.resize(size + static_cast<size_t>(input_->gcount()));
+    }
+    text_ = window_;
+}
+
+void StructuralScanner::ScanBlock(const char* block, size_t block_start) {
+    const BlockMasks masks = GetImplementation().classify(block);
+
+    const uint64_t escaped = FindEscapedChars(masks.backslash, prev_ends_odd_backslash_);
+    const uint64_t quotes = masks.quote & ~escaped;
+    // Биты внутри строк, включая открывающую кавычку и исключая закрывающую
+    const uint64_t in_string = PrefixXor(quotes) ^ prev_in_string_;
+    prev_in_string_ = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+    if (masks.newline & in_string) {
+        throw ParsingError("Unexpected end of line"s);
+    }
+
+    uint64_t structurals = (masks.structural & ~in_string) | quotes;
+    // Начала чисел и литералов: символы вне строк, перед которыми стоит пробел или структурный символ
+    const uint64_t pseudo_pred = structurals | masks.whitespace;
+    const uint64_t shifted_pseudo_pred = (pseudo_pred << 1) | prev_ends_pseudo_pred_;
+    prev_ends_pseudo_pred_ = pseudo_pred >> 63;
+    structurals |= shifted_pseudo_pred & ~masks.whitespace & ~in_string & ~quotes;
+
+    while (structurals != 0) {
+        positions_.push_back(block_start + CountTrailingZeros(structurals));
+        structurals &= structurals - 1;
+    }
+}
+
+}  // namespace json
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+// Первый этап двухэтапного разбора JSON из непрерывного буфера - поиск структурных позиций.
+// Текст обрабатывается блоками по 64 байта: для каждого блока векторными инструкциями
+// (AVX2 или SSE2, выбор во время выполнения) либо скалярным кодом строятся битовые маски
+// кавычек, обратных слэшей, пробельных и структурных символов. Из масок без ветвлений вычисляются
+// экранированные символы и области строк, а затем позиции { } [ ] : , кавычек
+// (открывающих и закрывающих) и начал чисел и литералов вне строк.
+// Позиции выдаются порциями, поэтому память под индекс не зависит от размера текста.
+// Позиции отсчитываются от начала текста, а сам текст доступен через GetText
+class StructuralScanner {
+   public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    // Порция чтения из потока в байтах
+    static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+    explicit StructuralScanner(std::string_view text);
+    // Потоковый режим: текст читается из input порциями по CHUNK_SIZE байт в окно, состояние блоков
+    // переносится через границы порций. Окно хранит текст с предпоследней выданной позиции,
+    // поэтому память не зависит от размера текста. input может быть прочитан дальше конца значения
+    explicit StructuralScanner(std::istream& input);
+
+    // Возвращает позицию следующего структурного символа или npos, если текст закончился
+    size_t Next() {
+        if (current_ == positions_.size() && !Refill()) {
+            return npos;
+        }
+        previous_ = last_;
+        last_ = positions_[current_++];
+        return last_;
+    }
+
+    // Возвращает позицию следующего структурного символа, не продвигаясь по тексту
+    size_t Peek() {
+        if (current_ == positions_.size() && !Refill()) {
+            return npos;
+        }
+        return positions_[current_];
+    }
+
+    // Доступный текст: с позиции GetTextBegin() до конца прочитанного. Он содержит предпоследнюю
+    // выданную позицию и всё после неё вплоть до следующей найденной. В потоковом режиме
+    // окно сдвигается при Next и Peek, и string_view на него действительны только до этих вызовов
+    std::string_view GetText() const {
+        return text_;
+    }
+    size_t GetTextBegin() const {
+        return text_begin_;
+    }
+
+    // Название реализации, выбранной для текущего процессора: "avx2", "sse2" или "scalar"
+    static std::string_view GetImplementationName();
+
+   private:
+    bool Refill();
+    void ScanBlock(const char* block, size_t block_start);
+    // Отбрасывает текст до предпоследней выданной позиции и дочитывает input, пока после
+    // next_block_ не наберётся целый блок или поток не закончится
+    void ReadInput();
+
+    std::string_view text_;
+    size_t text_begin_ = 0;  // позиция начала text_ в тексте
+    size_t next_block_ = 0;
+    size_t last_ = 0;      // последняя выданная позиция
+    size_t previous_ = 0;  // предпоследняя выданная позиция
+
+    // Потоковый режим: окно текста и его источник
+    std::istream* input_ = nullptr;
+    std::string window_;
+    std::vector<size_t> positions_;
+    size_t current_ = 0;
+
+    // Состояние, переносимое между блоками
+    uint64_t prev_in_string_ = 0;
+    uint64_t prev_ends_odd_backslash_ = 0;
+    uint64_t prev_ends_pseudo_pred_ = 1;
+};
+
+}  // namespace json
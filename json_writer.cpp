@@ -0,0 +1,235 @@
+#include "json_writer.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace json {
+
+using namespace std::literals;
+
+Writer::ArrayContext Writer::StartArray() {
+    BeforeValue();
+    out_.put('[');
+    if (!compact_) {
+        out_.put('\n');
+    }
+    frames_.push_back({false});
+    return *this;
+}
+
+Writer::ArrayContext Writer::ContinueArray(bool has_items) {
+    if (!frames_.empty() || complete_) {
+        throw std::logic_error("Array can be continued only by an empty writer");
+    }
+    frames_.push_back({false, !has_items});
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    if (frames_.empty() || frames_.back().is_dict) {
+        throw std::logic_error("Its not end Array");
+    }
+    frames_.pop_back();
+    if (!compact_) {
+        out_.put('\n');
+        PrintIndent();
+    }
+    out_.put(']');
+    AfterValue();
+    return *this;
+}
+
+Writer::DictContext Writer::StartDict() {
+    BeforeValue();
+    out_.put('{');
+    if (!compact_) {
+        out_.put('\n');
+    }
+    frames_.push_back({true});
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    if (frames_.empty() || !frames_.back().is_dict || frames_.back().has_key) {
+        throw std::logic_error("Its not end Dict");
+    }
+    frames_.pop_back();
+    if (!compact_) {
+        out_.put('\n');
+        PrintIndent();
+    }
+    out_.put('}');
+    AfterValue();
+    return *this;
+}
+
+Writer::KeyContext Writer::Key(std::string_view key) {
+    if (frames_.empty() || !frames_.back().is_dict || frames_.back().has_key) {
+        throw std::logic_error("Invalid Key");
+    }
+    Frame& frame = frames_.back();
+    if (!frame.empty) {
+        out_ << (compact_ ? ","sv : ",\n"sv);
+    }
+    PrintIndent();
+    PrintString(key);
+    out_ << (compact_ ? ":"sv : ": "sv);
+    frame.empty = false;
+    frame.has_key = true;
+    return *this;
+}
+
+Writer& Writer::Value(std::nullptr_t) {
+    BeforeValue();
+    out_ << "null"sv;
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    BeforeValue();
+    out_ << (value ? "true"sv : "false"sv);
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(int value) {
+    BeforeValue();
+    char buffer[16];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out_.write(buffer, result.ptr - buffer);
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(double value) {
+    BeforeValue();
+    // Шесть значащих цифр, как при выводе double в std::ostream с настройками по умолчанию
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+    out_.write(buffer, result.ptr - buffer);
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(std::string_view value) {
+    BeforeValue();
+    PrintString(value);
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(const Node& value) {
+    if (value.IsArray()) {
+        StartArray();
+        for (const Node& item : value.AsArray()) {
+            Value(item);
+        }
+        EndArray();
+    } else if (value.IsDict()) {
+        StartDict();
+        for (const auto& [key, item] : value.AsDict()) {
+            Key(key);
+            Value(item);
+        }
+        EndDict();
+    } else if (value.IsString()) {
+        Value(value.AsString());
+    } else if (value.IsInt()) {
+        Value(value.AsInt());
+    } else if (value.IsPureDouble()) {
+        Value(value.AsDouble());
+    } else if (value.IsBool()) {
+        Value(value.AsBool());
+    } else {
+        Value(nullptr);
+    }
+    return *this;
+}
+
+Writer& Writer::RawValue(std::string_view json) {
+    BeforeValue();
+    out_ << json;
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::RawValue(std::string_view prefix, int number, std::string_view suffix) {
+    BeforeValue();
+    out_ << prefix;
+    char buffer[16];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    out_.write(buffer, result.ptr - buffer);
+    out_ << suffix;
+    AfterValue();
+    return *this;
+}
+
+void Writer::BeforeValue() {
+    if (frames_.empty()) {
+        if (complete_) {
+            throw std::logic_error("object complite");
+        }
+        return;
+    }
+    Frame& frame = frames_.back();
+    if (frame.is_dict) {
+        if (!frame.has_key) {
+            throw std::logic_error("Not key for value");
+        }
+        frame.has_key = false;
+        return;
+    }
+    if (!frame.empty) {
+        out_ << (compact_ ? ","sv : ",\n"sv);
+    }
+    PrintIndent();
+    frame.empty = false;
+}
+
+void Writer::AfterValue() {
+    if (frames_.empty()) {
+        complete_ = true;
+    }
+}
+
+void Writer::PrintIndent() {
+    if (compact_) {
+        return;
+    }
+    for (size_t i = 0; i < frames_.size() * indent_step_; ++i) {
+        out_.put(' ');
+    }
+}
+
+void Writer::PrintString(std::string_view value) {
+    out_.put('"');
+    // Участки без специальных символов выводятся целиком
+    size_t run_start = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        std::string_view escaped;
+        switch (value[i]) {
+            case '\r':
+                escaped = "\\r"sv;
+                break;
+            case '\n':
+                escaped = "\\n"sv;
+                break;
+            case '"':
+                escaped = "\\\""sv;
+                break;
+            case '\\':
+                escaped = "\\\\"sv;
+                break;
+            default:
+                continue;
+        }
+        out_.write(value.data() + run_start, i - run_start);
+        out_ << escaped;
+        run_start = i + 1;
+    }
+    out_.write(value.data() + run_start, value.size() - run_start);
+    out_.put('"');
+}
+
+}  // namespace json
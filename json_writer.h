@@ -0,0 +1,160 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "json.h"
+
+namespace json {
+
+// Потоковая запись JSON. Повторяет интерфейс json::Builder с цепочкой вызовов,
+// но не строит дерево Node, а сразу выводит каждое значение в поток.
+// В обычном режиме вывод совпадает с json::Print (отступ 4 пробела),
+// в компактном режиме пробелы и переводы строк не выводятся
+class Writer {
+   public:
+    class DictContext;
+    class KeyContext;
+    class ArrayContext;
+
+    explicit Writer(std::ostream& output, bool compact = false)
+        : out_(output), compact_(compact) {
+    }
+
+    ArrayContext StartArray();
+    Writer& EndArray();
+    // Продолжает массив верхнего уровня, начатый другим объектом Writer: следующие значения
+    // выводятся как его элементы, перед первым ставится запятая, если в массиве уже есть элементы.
+    // Так части массива можно записать в разные буферы и вывести по порядку
+    ArrayContext ContinueArray(bool has_items);
+    DictContext StartDict();
+    Writer& EndDict();
+    KeyContext Key(std::string_view key);
+
+    Writer& Value(std::nullptr_t);
+    Writer& Value(bool value);
+    Writer& Value(int value);
+    Writer& Value(double value);
+    Writer& Value(std::string_view value);
+    Writer& Value(const std::string& value) {
+        return Value(std::string_view(value));
+    }
+    Writer& Value(const char* value) {
+        return Value(std::string_view(value));
+    }
+    Writer& Value(const Node& value);
+    // Выводит готовый JSON как очередное значение. Значение должно быть записано в том же режиме
+    // и на той же глубине вложенности, иначе отступы внутри него не совпадут с остальным выводом
+    Writer& RawValue(std::string_view json);
+    // То же для готового JSON, в который между prefix и suffix вставляется число number
+    Writer& RawValue(std::string_view prefix, int number, std::string_view suffix);
+
+    // Возвращает true, если значение верхнего уровня полностью записано
+    bool IsComplete() const {
+        return complete_;
+    }
+
+   private:
+    struct Frame {
+        bool is_dict;
+        bool empty = true;
+        bool has_key = false;
+    };
+
+    void BeforeValue();
+    void AfterValue();
+    void PrintIndent();
+    void PrintString(std::string_view value);
+
+    std::ostream& out_;
+    bool compact_;
+    std::vector<Frame> frames_;
+    bool complete_ = false;
+    static constexpr int indent_step_ = 4;
+};
+
+class Writer::DictContext {
+   public:
+    DictContext(Writer& writer)
+        : writer_(writer) {
+    }
+    KeyContext Key(std::string_view key);
+    Writer& EndDict();
+
+   private:
+    Writer& writer_;
+};
+
+class Writer::KeyContext {
+   public:
+    KeyContext(Writer& writer)
+        : writer_(writer) {
+    }
+    template <typename T>
+    DictContext Value(T&& value);
+    DictContext StartDict();
+    ArrayContext StartArray();
+
+   private:
+    Writer& writer_;
+};
+
+class Writer::ArrayContext {
+   public:
+    ArrayContext(Writer& writer)
+        : writer_(writer) {
+    }
+    template <typename T>
+    ArrayContext Value(T&& value);
+    DictContext StartDict();
+    ArrayContext StartArray();
+    Writer& EndArray();
+
+   private:
+    Writer& writer_;
+};
+
+inline Writer::KeyContext Writer::DictContext::Key(std::string_view key) {
+    return writer_.Key(key);
+}
+
+inline Writer& Writer::DictContext::EndDict() {
+    return writer_.EndDict();
+}
+
+template <typename T>
+Writer::DictContext Writer::KeyContext::Value(T&& value) {
+    writer_.Value(std::forward<T>(value));
+    return writer_;
+}
+
+inline Writer::DictContext Writer::KeyContext::StartDict() {
+    return writer_.StartDict();
+}
+
+inline Writer::ArrayContext Writer::KeyContext::StartArray() {
+    return writer_.StartArray();
+}
+
+template <typename T>
+Writer::ArrayContext Writer::ArrayContext::Value(T&& value) {
+    writer_.Value(std::forward<T>(value));
+    return writer_;
+}
+
+inline Writer::DictContext Writer::ArrayContext::StartDict() {
+    return writer_.StartDict();
+}
+
+inline Writer::ArrayContext Writer::ArrayContext::StartArray() {
+    return writer_.StartArray();
+}
+
+inline Writer& Writer::ArrayContext::EndArray() {
+    return writer_.EndArray();
+}
+
+}  // namespace json
@@ -1,28 +1,176 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <utility>
 
 #include "json_reader.h"
 #include "map_renderer.h"
+#include "mapped_file.h"
 #include "request_handler.h"
+#include "serialization.h"
 #include "transport_catalogue.h"
 
 using namespace std;
-int main() {
+
+static void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue [make_base|process_requests] [input.json] [--threads N] [--stats]\n"sv
+           << "       transport_catalogue serve <base.json|base.db> [--batch N] [--stats] [--materialize]\n"sv;
+}
+
+//Режим сервера: база загружается один раз, затем запросы читаются из stdin по одному в строке
+static int Serve(int argc, char* argv[]) {
+    if (argc < 1) {
+        PrintUsage();
+        return 1;
+    }
+    size_t batch_size = 1;
+    bool print_stats = false;
+    bool materialize = false;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] == "--batch"sv && i + 1 < argc) {
+            batch_size = std::max(1, std::stoi(argv[++i]));
+        } else if (argv[i] == "--stats"sv) {
+            print_stats = true;
+        } else if (argv[i] == "--materialize"sv) {
+            materialize = true;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    transport_catalogue::TransportCatalogue transport_catalogue;
+    renderer::RenderSettings render_setting;
+    std::optional<router::RoutingSettings> routing_settings;
+    std::shared_ptr<const router::TransportRouter> transport_router;
+    json_reader::LoadBaseFile(argv[0], transport_catalogue, render_setting, routing_settings, transport_router);
+    renderer::MapRenderer map_renderer;
+    map_renderer.SetRenderSettings(render_setting);
+    RequestHandler request_handler(transport_catalogue, map_renderer, routing_settings, std::move(transport_router));
+
+    //Ответы на все Bus и Stop записываются заранее: дольше запуск и больше памяти, но быстрее ответы
+    std::optional<json_reader::MaterializedAnswers> answers;
+    if (materialize) {
+        const auto start = chrono::steady_clock::now();
+        answers.emplace(transport_catalogue, request_handler, true);
+        if (print_stats) {
+            cerr << "materialized answers: "sv << answers->GetAnswerCount()
+                 << ", memory: "sv << answers->GetMemoryUsage() / 1024 << " KB"sv
+                 << ", built in "sv << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms\n"sv;
+        }
+    }
+
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+    json_reader::JsonLinesStats stats = json_reader::ServeJsonLines(cin, cout, transport_catalogue, request_handler, batch_size,
+                                                                    answers ? &*answers : nullptr);
+    if (print_stats && stats.requests > 0) {
+        cerr << "requests: "sv << stats.requests
+             << ", mean latency: "sv << stats.total_latency.count() / stats.requests / 1000.0 << " us"sv
+             << ", max latency: "sv << stats.max_latency.count() / 1000.0 << " us\n"sv;
+    }
+    return 0;
+}
+
+static void PrintDedupStats(const json_reader::DedupStats& stats) {
+    const std::pair<std::string_view, json_reader::DedupCount> counts[] = {{"Bus"sv, stats.bus}, {"Stop"sv, stats.stop}, {"Map"sv, stats.map}};
+    for (const auto& [type, count] : counts) {
+        if (count.requests > 0) {
+            cerr << type << ": "sv << count.requests << " requests, "sv << count.answers << " answers computed, ratio "sv
+                 << static_cast<double>(count.requests) / count.answers << '\n';
+        }
+    }
+}
+
+//Читает входной документ из файла, если он указан, иначе из стандартного потока
+static json_reader::JsonReader ReadInput(const char* path, transport_catalogue::TransportCatalogue& transport_catalogue) {
+    if (path != nullptr) {
+        return json_reader::JsonReader(io::MappedFile(path).GetData(), transport_catalogue);
+    }
+    return json_reader::JsonReader(cin, transport_catalogue);
+}
+
+// Запуск: transport_catalogue [make_base|process_requests] [input.json] [--threads N] [--stats]
+//         transport_catalogue serve <base.json|base.db> [--batch N] [--stats] [--materialize]
+// Без режима база строится из base_requests и сразу отвечает на stat_requests.
+// make_base строит базу и сохраняет её вместе с render_settings и routing_settings в файл serialization_settings.file,
+// process_requests загружает базу из этого файла и отвечает на stat_requests.
+// --threads задаёт число потоков для ответов на stat_requests (по умолчанию - число аппаратных потоков),
+// --stats выводит в stderr, сколько одинаковых запросов получили общий ответ.
+// serve загружает базу из файла один раз и отвечает на запросы из stdin по одному в строке (JSON Lines).
+// С --materialize ответы на все Bus и Stop записываются заранее и до первого Update отдаются из буфера.
+// Если указан входной файл, он отображается в память и разбирается без копирования через поток
+int main(int argc, char* argv[]) {
     // freopen("../input.json","r", stdin);
     // freopen("../output.json","w", stdout);
     // freopen("../s10_final_opentest/s10_final_opentest_1.json","r", stdin);
     // freopen("../s10_final_opentest/s10_final_opentest_1_answer_my.json","2", stdout);
+    if (argc > 1 && argv[1] == "serve"sv) {
+        return Serve(argc - 2, argv + 2);
+    }
+
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    bool print_stats = false;
+    while (argc > 1) {
+        if (argc > 2 && argv[argc - 2] == "--threads"sv) {
+            thread_count = std::max(1, std::stoi(argv[argc - 1]));
+            argc -= 2;
+        } else if (argv[argc - 1] == "--stats"sv) {
+            print_stats = true;
+            --argc;
+        } else {
+            break;
+        }
+    }
+
+    std::optional<std::string_view> mode;
+    const char* input_path = nullptr;
+    if (argc > 1 && (argv[1] == "make_base"sv || argv[1] == "process_requests"sv)) {
+        mode = argv[1];
+        input_path = argc > 2 ? argv[2] : nullptr;
+    } else if (argc > 2) {
+        PrintUsage();
+        return 1;
+    } else if (argc > 1) {
+        input_path = argv[1];
+    }
+
     transport_catalogue::TransportCatalogue transport_catalogue;  //Создаем каталог
     renderer::MapRenderer map_renderer;                           //Создаем рендерер
 
-    json_reader::JsonReader json_reader(cin);
-    json_reader.FillDataBase(transport_catalogue);  //Заполняем транспортный каталог
+    //Заполняем транспортный каталог по мере чтения
+    json_reader::JsonReader json_reader = ReadInput(input_path, transport_catalogue);
+
+    if (mode == "make_base"sv) {
+        serialization::SaveSnapshot(json_reader.GetSerializationSettings().file, transport_catalogue, json_reader.GetRenderSettings(),
+                                    json_reader.GetRoutingSettings());
+        return 0;
+    }
 
-    renderer::RenderSettings render_setting = json_reader.GetRenderSettings();  //Получаем настройки для рендера из json файла
+    renderer::RenderSettings render_setting;
+    std::optional<router::RoutingSettings> routing_settings;
+    std::shared_ptr<const router::TransportRouter> transport_router;
+    if (mode == "process_requests"sv) {
+        //Справочник, настройки рендера и маршрутизации и иерархии сжатия загружаются из файла, подготовленного make_base
+        serialization::LoadSnapshot(json_reader.GetSerializationSettings().file, transport_catalogue, render_setting, routing_settings,
+                                    transport_router);
+    } else {
+        render_setting = json_reader.GetRenderSettings();  //Получаем настройки для рендера из json файла
+        routing_settings = json_reader.GetRoutingSettings();
+    }
     map_renderer.SetRenderSettings(render_setting);
 
-    RequestHandler request_handler = RequestHandler(transport_catalogue, map_renderer);
+    RequestHandler request_handler(transport_catalogue, map_renderer, routing_settings, std::move(transport_router));
 
-    json_reader.Out(transport_catalogue, request_handler, cout);  //Получаем JSON массив и выводим его в нужный потомк
+    //Получаем JSON массив и выводим его в нужный потомк
+    const json_reader::DedupStats stats = json_reader.Out(transport_catalogue, request_handler, cout, thread_count);
+    if (print_stats) {
+        PrintDedupStats(stats);
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -7,14 +7,21 @@ using namespace std::string_literals;
 
 namespace renderer {
 //Выходной вектор должен быть отсортирован по именам автобусов
-std::vector<BusColor> MapRenderer::GetBusLineColor(std::vector<const domain::Bus*>& buses) const {
+std::vector<BusColor> MapRenderer::GetBusLineColor(const transport_catalogue::TransportCatalogue& db) const {
     std::vector<BusColor> result;
+    std::vector<domain::BusId> buses;
+    buses.reserve(db.GetBusCount());
+    for (domain::BusId bus = 0; bus < db.GetBusCount(); ++bus) {
+        if (!db.IsBusRemoved(bus)) {
+            buses.push_back(bus);
+        }
+    }
     //sort vector by name
-    std::sort(buses.begin(), buses.end(), [](const domain::Bus* lhs, const domain::Bus* rhs) { return lhs->name < rhs->name; });
+    std::sort(buses.begin(), buses.end(), [&db](domain::BusId lhs, domain::BusId rhs) { return db.GetBusName(lhs) < db.GetBusName(rhs); });
     int count_buses = 0;
-    for (const domain::Bus* bus : buses) {
+    for (domain::BusId bus : buses) {
         int index_color = (count_buses) % render_setings_.color_palette.size();
-        if (!bus->route.empty()) {
+        if (!db.GetRoute(bus).empty()) {
             ++count_buses;
         }
         result.push_back({bus, &render_setings_.color_palette[index_color]});
@@ -23,21 +30,20 @@ std::vector<BusColor> MapRenderer::GetBusLineColor(std::vector<const domain::Bus
 }
 
 //Входной вектор должен быть отсортирован по именам автобусов
-std::vector<svg::Polyline> MapRenderer::GetRouteLines(const std::vector<BusColor>& sorted_by_name_buses_color, const SphereProjector& sphere_projector) const {
+std::vector<svg::Polyline> MapRenderer::GetRouteLines(const transport_catalogue::TransportCatalogue& db, const std::vector<BusColor>& sorted_by_name_buses_color, const SphereProjector& sphere_projector) const {
     std::vector<svg::Polyline> result;
     for (const BusColor& bus_color : sorted_by_name_buses_color) {
-        if (!bus_color.bus->route.empty()) {  //Отрисовываем если есть остановки на маршруте
+        const domain::Span<domain::StopId> route = db.GetRoute(bus_color.bus);
+        if (!route.empty()) {  //Отрисовываем если есть остановки на маршруте
             svg::Polyline polyline = svg::Polyline();
             //Добавляем точки с координатами в Polyline
-            for (const domain::Stop* stop : bus_color.bus->route) {
-                polyline.AddPoint(sphere_projector(stop->coord));
+            for (domain::StopId stop : route) {
+                polyline.AddPoint(sphere_projector(db.GetStopCoordinates(stop)));
             }
             //Едем в обратную сторону, если маршрут линейны
-            if (bus_color.bus->type == domain::TypeRoute::linear) {
-                if (bus_color.bus->route.size() > 1) {
-                    for (auto stop_it = bus_color.bus->route.rbegin() + 1; stop_it != bus_color.bus->route.rend(); ++stop_it) {
-                        polyline.AddPoint(sphere_projector((*stop_it)->coord));
-                    }
+            if (db.GetBusType(bus_color.bus) == domain::TypeRoute::linear) {
+                for (size_t i = route.size() - 1; i > 0; --i) {
+                    polyline.AddPoint(sphere_projector(db.GetStopCoordinates(route[i - 1])));
                 }
             }
             result.push_back(polyline.SetFillColor("none"s)
@@ -49,7 +55,8 @@ std::vector<svg::Polyline> MapRenderer::GetRouteLines(const std::vector<BusColor
     }
     return result;
 }
-static svg::Text GetRouteText(const BusColor& bus_color,
+static svg::Text GetRouteText(std::string_view bus_name,
+                              const svg::Color& color,
                               const svg::Point coord,
                               const LabelRenderSetting& label) {
     svg::Text text = svg::Text();
@@ -58,11 +65,11 @@ static svg::Text GetRouteText(const BusColor& bus_color,
         .SetFontSize(label.font_size)
         .SetFontFamily("Verdana"s)
         .SetFontWeight("bold")
-        .SetData(bus_color.bus->name)
-        .SetFillColor(*bus_color.color);
+        .SetData(std::string(bus_name))
+        .SetFillColor(color);
     return text;
 }
-static svg::Text GetRouteUnderlayerText(const BusColor& bus_color,
+static svg::Text GetRouteUnderlayerText(std::string_view bus_name,
                                         const svg::Point coord,
                                         const LabelRenderSetting& label,
                                         const UnderlayerSettings& underlayer) {
@@ -72,7 +79,7 @@ static svg::Text GetRouteUnderlayerText(const BusColor& bus_color,
         .SetFontSize(label.font_size)
         .SetFontFamily("Verdana"s)
         .SetFontWeight("bold")
-        .SetData(bus_color.bus->name)
+        .SetData(std::string(bus_name))
         .SetFillColor(underlayer.color)
         .SetStrokeColor(underlayer.color)
         .SetStrokeWidth(underlayer.width)
@@ -80,39 +87,42 @@ static svg::Text GetRouteUnderlayerText(const BusColor& bus_color,
         .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
     return text_underlayer;
 }
-static std::tuple<svg::Text, svg::Text> GetRouteName(const BusColor& bus_color,
+static std::tuple<svg::Text, svg::Text> GetRouteName(std::string_view bus_name,
+                                                     const svg::Color& color,
                                                      const svg::Point coord,
                                                      const LabelRenderSetting& label,
                                                      const UnderlayerSettings& underlayer) {
-    svg::Text text = GetRouteText(bus_color, coord, label);
-    svg::Text text_underlayer = GetRouteUnderlayerText(bus_color, coord, label, underlayer);
+    svg::Text text = GetRouteText(bus_name, color, coord, label);
+    svg::Text text_underlayer = GetRouteUnderlayerText(bus_name, coord, label, underlayer);
     return {text_underlayer, text};
 }
-std::vector<svg::Text> MapRenderer::GetRouteNames(const std::vector<BusColor>& buses, const SphereProjector& sphere_projector) const {
+std::vector<svg::Text> MapRenderer::GetRouteNames(const transport_catalogue::TransportCatalogue& db, const std::vector<BusColor>& buses, const SphereProjector& sphere_projector) const {
     std::vector<svg::Text> result;
     for (const BusColor& bus_color : buses) {
-        if (!bus_color.bus->route.empty()) {  //Если у маршрута есть остановки, то рисуем его
-            if (bus_color.bus->type == domain::TypeRoute::circular) {
-                auto [text_underlayer, text] = GetRouteName(bus_color,
-                                                            sphere_projector(bus_color.bus->route.at(0)->coord),
+        const domain::Span<domain::StopId> route = db.GetRoute(bus_color.bus);
+        const std::string_view bus_name = db.GetBusName(bus_color.bus);
+        if (!route.empty()) {  //Если у маршрута есть остановки, то рисуем его
+            if (db.GetBusType(bus_color.bus) == domain::TypeRoute::circular) {
+                auto [text_underlayer, text] = GetRouteName(bus_name, *bus_color.color,
+                                                            sphere_projector(db.GetStopCoordinates(route.front())),
                                                             render_setings_.bus.label,
                                                             render_setings_.underlayer);
 
                 result.push_back(text_underlayer);
                 result.push_back(text);
             } else {
-                const domain::Stop* first_end_stop = *(bus_color.bus->route.begin());
-                auto [text_first_end_stop_underlayer, text_first_end_stop] = GetRouteName(bus_color,
-                                                                                          sphere_projector(first_end_stop->coord),
+                const domain::StopId first_end_stop = route.front();
+                auto [text_first_end_stop_underlayer, text_first_end_stop] = GetRouteName(bus_name, *bus_color.color,
+                                                                                          sphere_projector(db.GetStopCoordinates(first_end_stop)),
                                                                                           render_setings_.bus.label,
                                                                                           render_setings_.underlayer);
                 result.push_back(text_first_end_stop_underlayer);
                 result.push_back(text_first_end_stop);
 
-                const domain::Stop* second_end_stop = *(bus_color.bus->route.end() - 1);
+                const domain::StopId second_end_stop = route.back();
                 if (second_end_stop != first_end_stop) {
-                    auto [text_second_end_stop_underlayer, text_second_end_stop] = GetRouteName(bus_color,
-                                                                                                sphere_projector(second_end_stop->coord),
+                    auto [text_second_end_stop_underlayer, text_second_end_stop] = GetRouteName(bus_name, *bus_color.color,
+                                                                                                sphere_projector(db.GetStopCoordinates(second_end_stop)),
                                                                                                 render_setings_.bus.label,
                                                                                                 render_setings_.underlayer);
                     result.push_back(text_second_end_stop_underlayer);
@@ -124,11 +134,11 @@ std::vector<svg::Text> MapRenderer::GetRouteNames(const std::vector<BusColor>& b
     return result;
 }
 
-std::vector<svg::Circle> MapRenderer::GetStopSymbols(const std::map<std::string, const domain::Stop*>& stops, const SphereProjector& sphere_projector) const {
+std::vector<svg::Circle> MapRenderer::GetStopSymbols(const transport_catalogue::TransportCatalogue& db, const std::vector<domain::StopId>& stops, const SphereProjector& sphere_projector) const {
     std::vector<svg::Circle> result;
-    for (const auto& [name, stop] : stops) {
+    for (domain::StopId stop : stops) {
         svg::Circle symbol_stop = svg::Circle();
-        symbol_stop.SetCenter(sphere_projector(stop->coord))
+        symbol_stop.SetCenter(sphere_projector(db.GetStopCoordinates(stop)))
             .SetRadius(render_setings_.stop.radius)
             .SetFillColor("white"s);
         result.push_back(symbol_stop);
@@ -136,17 +146,17 @@ std::vector<svg::Circle> MapRenderer::GetStopSymbols(const std::map<std::string,
     return result;
 }
 
-std::vector<svg::Text> MapRenderer::GetStopNames(const std::map<std::string, const domain::Stop*>& stops, const SphereProjector& sphere_projector) const {
+std::vector<svg::Text> MapRenderer::GetStopNames(const transport_catalogue::TransportCatalogue& db, const std::vector<domain::StopId>& stops, const SphereProjector& sphere_projector) const {
     std::vector<svg::Text> result;
-    for (const auto& [name, stop] : stops) {
-        svg::Point stop_coord = sphere_projector(stop->coord);
+    for (domain::StopId stop : stops) {
+        svg::Point stop_coord = sphere_projector(db.GetStopCoordinates(stop));
 
         svg::Text stop_symbol_under = svg::Text();
         stop_symbol_under.SetPosition(stop_coord)
             .SetOffset(render_setings_.stop.label.offset)
             .SetFontSize(render_setings_.stop.label.font_size)
             .SetFontFamily("Verdana"s)
-            .SetData(stop->name)
+            .SetData(std::string(db.GetStopName(stop)))
             .SetFillColor(render_setings_.underlayer.color)
             .SetStrokeColor(render_setings_.underlayer.color)
             .SetStrokeWidth(render_setings_.underlayer.width)
@@ -158,7 +168,7 @@ std::vector<svg::Text> MapRenderer::GetStopNames(const std::map<std::string, con
             .SetOffset(render_setings_.stop.label.offset)
             .SetFontSize(render_setings_.stop.label.font_size)
             .SetFontFamily("Verdana"s)
-            .SetData(stop->name)
+            .SetData(std::string(db.GetStopName(stop)))
             .SetFillColor("black"s);
 
         result.push_back(stop_symbol_under);
@@ -7,6 +7,7 @@
 #include "domain.h"
 #include "geo.h"
 #include "svg.h"
+#include "transport_catalogue.h"
 
 /*
  * В этом файле вы можете разместить код, отвечающий за визуализацию карты маршрутов в формате SVG.
@@ -52,7 +53,7 @@ struct RenderSettings {
 };
 
 struct BusColor {
-    const domain::Bus* bus;
+    domain::BusId bus;
     const svg::Color* color;
 };
 
@@ -120,14 +121,14 @@ class MapRenderer {
         render_setings_ = render_setings;
     };
 
-    std::vector<BusColor> GetBusLineColor(std::vector<const domain::Bus*>& buses) const;  //Получение цветов автобусов
-    std::vector<svg::Polyline> GetRouteLines(const std::vector<BusColor>& sorted_by_name_buses_color,
+    std::vector<BusColor> GetBusLineColor(const transport_catalogue::TransportCatalogue& db) const;  //Получение цветов автобусов
+    std::vector<svg::Polyline> GetRouteLines(const transport_catalogue::TransportCatalogue& db, const std::vector<BusColor>& sorted_by_name_buses_color,
                                              const SphereProjector& sphere_projector) const;  //Получение линий маршрутов
-    std::vector<svg::Text> GetRouteNames(const std::vector<BusColor>& buses,
+    std::vector<svg::Text> GetRouteNames(const transport_catalogue::TransportCatalogue& db, const std::vector<BusColor>& buses,
                                          const SphereProjector& sphere_projector) const;  //Получение названия маршрута
-    std::vector<svg::Circle> GetStopSymbols(const std::map<std::string, const domain::Stop*>& stops,
+    std::vector<svg::Circle> GetStopSymbols(const transport_catalogue::TransportCatalogue& db, const std::vector<domain::StopId>& stops,
                                             const SphereProjector& sphere_projector) const;  //Получение символов остановок
-    std::vector<svg::Text> GetStopNames(const std::map<std::string, const domain::Stop*>& stops,
+    std::vector<svg::Text> GetStopNames(const transport_catalogue::TransportCatalogue& db, const std::vector<domain::StopId>& stops,
                                         const SphereProjector& sphere_projector) const;  //Получение названия остановок
     const RenderSettings& GetRenderSetings() const {
         return render_setings_;
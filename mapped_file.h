@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace io {
+
+// Файл, отображённый в память только для чтения.
+// Данные доступны через GetData() до разрушения объекта
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    std::string_view GetData() const {
+        return {data_, size_};
+    }
+
+   private:
+    void Unmap();
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    // Без mmap файл целиком читается в память
+    std::string buffer_;
+#endif
+};
+
+}  // namespace io
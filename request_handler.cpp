@@ -1,60 +1,110 @@
 #include "request_handler.h"
 
-#include <unordered_set>
+#include <sstream>
 
-struct Stop_Hasher {
-    size_t operator()(const domain::Stop* stop) const {
-        return (size_t)stop;
-    }
-};
+#include "epoch.h"
 
-std::optional<domain::BusStat> RequestHandler::GetBusStat(const std::string& bus_name) const {
-    domain::BusStat bus_stat;
-    const domain::Bus* bus = db_.GetBus(bus_name);
-    if (bus == nullptr) {
+std::optional<domain::BusStat> RequestHandler::GetBusStat(std::string_view bus_name) const {
+    const std::optional<domain::BusId> bus = db_.FindBus(bus_name);
+    if (!bus) {
         return std::nullopt;
     }
-    bus_stat.stop_count = db_.GetCountStopsOnRouts(bus);
-    std::unordered_set<const domain::Stop*, Stop_Hasher> unique_stops;
-    for (const domain::Stop* stop : bus->route) {
-        unique_stops.insert(stop);
+    if (const domain::BusStat* bus_stat = db_.FindBusStat(*bus)) {
+        return *bus_stat;
     }
-    bus_stat.unique_stop_count = unique_stops.size();
-    int real_distance = db_.GetLengthRoute(bus);
-    bus_stat.route_length = real_distance;
-    bus_stat.curvature = db_.GetCurvature(bus, real_distance);
+    return db_.ComputeBusStat(*bus);
+}
 
-    return bus_stat;
+std::optional<domain::Span<domain::BusId>> RequestHandler::GetBusesByStop(std::string_view stop_name) const {
+    const std::optional<domain::StopId> stop = db_.FindStop(stop_name);
+    if (!stop) {
+        return std::nullopt;
+    }
+    return db_.GetBusesContainingStop(*stop);
 }
 
-std::set<std::string> RequestHandler::GetBusesByStop(const std::string& stop_name) const {
-    const domain::Stop* stop = db_.GetStop(stop_name);
-    return db_.GetBusesContainingStop(stop);
+std::vector<domain::NearbyStop> RequestHandler::GetNearestStops(geo::Coordinates point, size_t count) const {
+    return db_.FindNearestStops(point, count);
 }
 
-static std::vector<geo::Coordinates> GetStopCoordinates(const std::map<std::string, const domain::Stop*>& stops) {
-    std::vector<geo::Coordinates> stop_coordinates;
-    for (const auto& [name, stop] : stops) {
-        stop_coordinates.push_back(stop->coord);
+std::vector<domain::NearbyStop> RequestHandler::GetStopsInRadius(geo::Coordinates point, double radius) const {
+    return db_.FindStopsInRadius(point, radius);
+}
+
+std::vector<domain::StopId> RequestHandler::GetStopsInBox(geo::Box box) const {
+    return db_.FindStopsInBox(box);
+}
+
+std::vector<domain::BusId> RequestHandler::GetBusesByStops(const std::vector<domain::StopId>& stops) const {
+    return db_.GetBusesContainingAnyStop(stops);
+}
+
+RequestHandler::RequestHandler(const transport_catalogue::TransportCatalogue& db, const renderer::MapRenderer& renderer,
+                               std::optional<router::RoutingSettings> routing_settings,
+                               std::shared_ptr<const router::TransportRouter> transport_router)
+    : db_(db), renderer_(renderer), routing_settings_(routing_settings) {
+    if (routing_settings_ && transport_router) {
+        router_cache_.store(new RouterCache{db_.GetNetworkRevision(), db_.GetRoadRevision(), std::move(transport_router)},
+                            std::memory_order_release);
+    }
+}
+
+std::optional<router::RouteInfo> RequestHandler::GetRoute(std::string_view from, std::string_view to, router::Metric metric) const {
+    const std::optional<domain::StopId> from_stop = db_.FindStop(from);
+    const std::optional<domain::StopId> to_stop = db_.FindStop(to);
+    const std::shared_ptr<const router::TransportRouter> router = GetRouter();
+    if (!from_stop || !to_stop || !router) {
+        return std::nullopt;
     }
-    return stop_coordinates;
+    return router->FindRoute(*from_stop, *to_stop, metric);
+}
+
+std::shared_ptr<const router::TransportRouter> RequestHandler::GetRouter() const {
+    if (!routing_settings_) {
+        return nullptr;
+    }
+    concurrency::EpochGuard guard;
+    const uint64_t network_revision = db_.GetNetworkRevision();
+    const uint64_t road_revision = db_.GetRoadRevision();
+    const RouterCache* cache = router_cache_.load(std::memory_order_acquire);
+    if (cache != nullptr && cache->network_revision == network_revision && cache->road_revision == road_revision) {
+        return cache->router;
+    }
+    // Построение графа дорогое (иерархии сжатия), поэтому граф строит один поток,
+    // а остальные ждут его и берут готовый из кэша
+    std::lock_guard lock(router_build_mutex_);
+    cache = router_cache_.load(std::memory_order_acquire);
+    if (cache != nullptr && cache->network_revision == network_revision && cache->road_revision == road_revision) {
+        return cache->router;
+    }
+    auto* fresh = new RouterCache{network_revision, road_revision, std::make_shared<const router::TransportRouter>(db_, *routing_settings_)};
+    std::shared_ptr<const router::TransportRouter> result = fresh->router;
+    router_cache_.store(fresh, std::memory_order_release);
+    if (cache != nullptr) {
+        concurrency::Retire(cache);
+        concurrency::CollectRetired();
+    }
+    return result;
 }
 
 svg::Document RequestHandler::RenderMap() const {
-    std::vector<const domain::Bus*> buses = db_.GetBuses();
-    std::vector<renderer::BusColor> bus_colors = renderer_.GetBusLineColor(buses);
-    std::map<std::string, const domain::Stop*> stops_containing_bus = db_.GetStopsContainingAnyBus();
-    std::vector<geo::Coordinates> stop_coordinates = GetStopCoordinates(stops_containing_bus);
+    std::vector<renderer::BusColor> bus_colors = renderer_.GetBusLineColor(db_);
+    std::vector<domain::StopId> stops_containing_bus = db_.GetStopsContainingAnyBus();
+    std::vector<geo::Coordinates> stop_coordinates;
+    stop_coordinates.reserve(stops_containing_bus.size());
+    for (domain::StopId stop : stops_containing_bus) {
+        stop_coordinates.push_back(db_.GetStopCoordinates(stop));
+    }
     //Создаем проектор координат
     renderer::SphereProjector sphere_projector(stop_coordinates.begin(), stop_coordinates.end(),
                                                renderer_.GetRenderSetings().svg.width,
                                                renderer_.GetRenderSetings().svg.height,
                                                renderer_.GetRenderSetings().svg.padding);
-    std::vector<svg::Polyline> route_lines = renderer_.GetRouteLines(bus_colors, sphere_projector);
-    std::vector<svg::Text> route_names = renderer_.GetRouteNames(bus_colors, sphere_projector);
+    std::vector<svg::Polyline> route_lines = renderer_.GetRouteLines(db_, bus_colors, sphere_projector);
+    std::vector<svg::Text> route_names = renderer_.GetRouteNames(db_, bus_colors, sphere_projector);
 
-    std::vector<svg::Circle> stop_symbols = renderer_.GetStopSymbols(stops_containing_bus, sphere_projector);
-    std::vector<svg::Text> stop_names = renderer_.GetStopNames(stops_containing_bus, sphere_projector);
+    std::vector<svg::Circle> stop_symbols = renderer_.GetStopSymbols(db_, stops_containing_bus, sphere_projector);
+    std::vector<svg::Text> stop_names = renderer_.GetStopNames(db_, stops_containing_bus, sphere_projector);
 
     svg::Document doc;
     for (const svg::Polyline& line : route_lines) {
@@ -70,4 +120,41 @@ svg::Document RequestHandler::RenderMap() const {
         doc.Add(stop_name);
     }
     return doc;
-}
\ No newline at end of file
+}
+std::shared_ptr<const std::string> RequestHandler::RenderMapSvg() const {
+    concurrency::EpochGuard guard;
+    const uint64_t revision = db_.GetNetworkRevision();
+    const MapCache* cache = map_cache_.load(std::memory_order_acquire);
+    if (cache != nullptr && cache->revision == revision) {
+        return cache->svg;
+    }
+    std::ostringstream svg;
+    RenderMap().Render(svg);
+    auto* fresh = new MapCache{revision, std::make_shared<const std::string>(svg.str())};
+    std::shared_ptr<const std::string> result = fresh->svg;
+    if (!map_cache_.compare_exchange_strong(cache, fresh, std::memory_order_acq_rel)) {
+        delete fresh;
+    } else if (cache != nullptr) {
+        concurrency::Retire(cache);
+        concurrency::CollectRetired();
+    }
+    return result;
+}
+
+void RequestHandler::ReuseCaches(const RequestHandler& other) {
+    concurrency::EpochGuard guard;
+    const MapCache* cache = other.map_cache_.load(std::memory_order_acquire);
+    if (cache != nullptr && cache->revision == db_.GetNetworkRevision()) {
+        delete map_cache_.exchange(new MapCache(*cache), std::memory_order_acq_rel);
+    }
+    const RouterCache* router = other.router_cache_.load(std::memory_order_acquire);
+    if (router != nullptr && routing_settings_ && router->network_revision == db_.GetNetworkRevision()
+        && router->road_revision == db_.GetRoadRevision()) {
+        delete router_cache_.exchange(new RouterCache(*router), std::memory_order_acq_rel);
+    }
+}
+
+RequestHandler::~RequestHandler() {
+    delete map_cache_.load(std::memory_order_relaxed);
+    delete router_cache_.load(std::memory_order_relaxed);
+}
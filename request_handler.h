@@ -1,26 +1,88 @@
 #pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <unordered_set>
 
 #include "domain.h"
 #include "map_renderer.h"
 #include "transport_catalogue.h"
+#include "transport_router.h"
 
 class RequestHandler {
    public:
     // MapRenderer понадобится в следующей части итогового проекта
     RequestHandler(const transport_catalogue::TransportCatalogue& db, const renderer::MapRenderer& renderer) : db_(db), renderer_(renderer){};
+    // Без routing_settings запросы путей не поддерживаются. transport_router - готовый граф путей по db
+    // в её текущем состоянии (например, загруженный из файла) или nullptr, тогда он строится при первом обращении
+    RequestHandler(const transport_catalogue::TransportCatalogue& db, const renderer::MapRenderer& renderer,
+                   std::optional<router::RoutingSettings> routing_settings,
+                   std::shared_ptr<const router::TransportRouter> transport_router = nullptr);
+    ~RequestHandler();
+
+    RequestHandler(const RequestHandler&) = delete;
+    RequestHandler& operator=(const RequestHandler&) = delete;
 
     // Возвращает информацию о маршруте (запрос Bus)
-    std::optional<domain::BusStat> GetBusStat(const std::string& bus_name) const;
+    std::optional<domain::BusStat> GetBusStat(std::string_view bus_name) const;
+
+    // Возвращает маршруты, проходящие через остановку, отсортированные по названию,
+    // или nullopt, если остановки нет
+    std::optional<domain::Span<domain::BusId>> GetBusesByStop(std::string_view stop_name) const;
+
+    // count ближайших к point остановок по возрастанию расстояния (запрос NearestStops)
+    std::vector<domain::NearbyStop> GetNearestStops(geo::Coordinates point, size_t count) const;
+    // Остановки не дальше radius метров от point по возрастанию расстояния (запрос StopsInRadius)
+    std::vector<domain::NearbyStop> GetStopsInRadius(geo::Coordinates point, double radius) const;
+    // Остановки в прямоугольнике, отсортированные по названию (запрос Box)
+    std::vector<domain::StopId> GetStopsInBox(geo::Box box) const;
+    // Маршруты, проходящие хотя бы через одну из stops, отсортированные по названию
+    std::vector<domain::BusId> GetBusesByStops(const std::vector<domain::StopId>& stops) const;
 
-    // Возвращает маршруты, проходящие через
-    std::set<std::string> GetBusesByStop(const std::string& stop_name) const;
+    bool HasRouting() const {
+        return routing_settings_.has_value();
+    }
+    // Лучший по metric путь между остановками (запрос Route) или nullopt, если остановки не найдены,
+    // пути нет или не заданы настройки маршрутизации
+    std::optional<router::RouteInfo> GetRoute(std::string_view from, std::string_view to,
+                                              router::Metric metric = router::Metric::Time) const;
+    // Граф для поиска путей или nullptr без настроек маршрутизации. Как и карта, строится при первом
+    // обращении и заново - только если изменились остановки, маршруты или расстояния.
+    // Устаревший граф перестраивает один поток, остальные ждут его
+    std::shared_ptr<const router::TransportRouter> GetRouter() const;
 
     // Этот метод будет нужен в следующей части итогового проекта
     svg::Document RenderMap() const;
+    // Карта в виде текста SVG. Текст запоминается и отрисовывается заново,
+    // только если в справочнике изменились остановки или маршруты. Не блокирует поток:
+    // одновременные запросы к устаревшей карте могут отрисовать её несколько раз
+    std::shared_ptr<const std::string> RenderMapSvg() const;
+    // Берёт отрисованную карту у other, если other работает с тем же справочником
+    // или его копией, в которой остановки и маршруты не менялись, а также граф путей, если не менялись
+    // и расстояния. Вызывается, пока обработчик не доступен другим потокам
+    void ReuseCaches(const RequestHandler& other);
 
    private:
     // RequestHandler использует агрегацию объектов "Транспортный Справочник" и "Визуализатор Карты"
     const transport_catalogue::TransportCatalogue& db_;
     const renderer::MapRenderer& renderer_;
+
+    struct MapCache {
+        uint64_t revision;  // GetNetworkRevision справочника, для которой отрисована карта
+        std::shared_ptr<const std::string> svg;
+    };
+    // Заменённая карта освобождается через concurrency::Retire, когда её не читает ни один поток
+    mutable std::atomic<const MapCache*> map_cache_{nullptr};
+
+    std::optional<router::RoutingSettings> routing_settings_;
+    struct RouterCache {
+        uint64_t network_revision;
+        uint64_t road_revision;
+        std::shared_ptr<const router::TransportRouter> router;
+    };
+    mutable std::atomic<const RouterCache*> router_cache_{nullptr};
+    // Захватывается только при построении графа: чтение готового графа не блокирует поток
+    mutable std::mutex router_build_mutex_;
 };
@@ -0,0 +1,573 @@
+#include "serialization.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "mapped_file.h"
+
+using namespace std::literals;
+
+namespace serialization {
+
+namespace {
+constexpr char MAGIC[8] = {'T', 'C', 'A', 'T', 'S', 'N', 'A', 'P'};
+// Признак порядка байт: файл, записанный на машине с другим порядком, не загружается
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Section {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t file_size;
+    Section strings;
+    Section stops;
+    Section buses;
+    Section route_stops;
+    Section distances;
+    Section render_settings;
+    Section routing_settings;  // одна запись или ни одной
+    Section hierarchies;        // запись на метрику
+    Section hierarchy_ranks;    // ранги вершин иерархий подряд
+    Section hierarchy_degrees;  // у каждой вершины число рёбер вверх, затем по всем вершинам - вниз
+    Section hierarchy_edges;
+};
+
+struct StopRecord {
+    uint64_t name_offset;
+    uint32_t name_length;
+    uint32_t reserved;
+    double lat;
+    double lng;
+};
+
+struct BusRecord {
+    uint64_t name_offset;
+    uint32_t name_length;
+    uint32_t type;
+    uint64_t route_offset;
+    uint64_t route_length;
+};
+
+struct DistanceRecord {
+    uint32_t from;
+    uint32_t to;
+    int32_t distance;
+};
+
+// Флаги настроек маршрутизации
+constexpr uint32_t CONTRACTION_HIERARCHIES_FLAG = 1;
+
+struct RoutingSettingsRecord {
+    int32_t bus_wait_time;
+    uint32_t flags;
+    double bus_velocity;
+};
+
+// Иерархия одной метрики: vertex_count рангов, 2 * vertex_count чисел рёбер и сами рёбра
+struct HierarchyRecord {
+    uint32_t metric;
+    uint32_t vertex_count;
+};
+
+struct HierarchyEdgeRecord {
+    uint32_t vertex;
+    uint32_t middle;
+    double weight;
+};
+
+static_assert(sizeof(Header) == 200 && std::is_trivially_copyable_v<Header>);
+static_assert(sizeof(StopRecord) == 32 && std::is_trivially_copyable_v<StopRecord>);
+static_assert(sizeof(BusRecord) == 32 && std::is_trivially_copyable_v<BusRecord>);
+static_assert(sizeof(DistanceRecord) == 12 && std::is_trivially_copyable_v<DistanceRecord>);
+static_assert(sizeof(RoutingSettingsRecord) == 16 && std::is_trivially_copyable_v<RoutingSettingsRecord>);
+static_assert(sizeof(HierarchyRecord) == 8 && std::is_trivially_copyable_v<HierarchyRecord>);
+static_assert(sizeof(HierarchyEdgeRecord) == 16 && std::is_trivially_copyable_v<HierarchyEdgeRecord>);
+
+constexpr uint64_t ALIGNMENT = 8;
+
+uint64_t Align(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// ---------- Настройки визуализации ------------------
+
+// Последовательная запись значений в буфер
+class ByteWriter {
+   public:
+    template <typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void Write(std::string_view value) {
+        Write(static_cast<uint64_t>(value.size()));
+        data_.append(value);
+    }
+
+    const std::string& GetData() const {
+        return data_;
+    }
+
+   private:
+    std::string data_;
+};
+
+// Последовательное чтение значений из буфера с проверкой границ
+class ByteReader {
+   public:
+    explicit ByteReader(std::string_view data)
+        : data_(data) {
+    }
+
+    template <typename T>
+    T Read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    std::string ReadString() {
+        return std::string(Take(Read<uint64_t>()));
+    }
+
+   private:
+    std::string_view Take(uint64_t size) {
+        if (size > data_.size()) {
+            throw SnapshotError("Unexpected end of render settings"s);
+        }
+        std::string_view result = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return result;
+    }
+
+    std::string_view data_;
+};
+
+enum class ColorTag : uint8_t {
+    NONE,
+    RGB,
+    RGBA,
+    STRING,
+};
+
+void WriteColor(const svg::Color& color, ByteWriter& writer) {
+    if (const auto* rgb = std::get_if<svg::Rgb>(&color)) {
+        writer.Write(ColorTag::RGB);
+        writer.Write(*rgb);
+    } else if (const auto* rgba = std::get_if<svg::Rgba>(&color)) {
+        writer.Write(ColorTag::RGBA);
+        writer.Write(rgba->red);
+        writer.Write(rgba->green);
+        writer.Write(rgba->blue);
+        writer.Write(rgba->opacity);
+    } else if (const auto* name = std::get_if<std::string>(&color)) {
+        writer.Write(ColorTag::STRING);
+        writer.Write(std::string_view(*name));
+    } else {
+        writer.Write(ColorTag::NONE);
+    }
+}
+
+svg::Color ReadColor(ByteReader& reader) {
+    switch (reader.Read<ColorTag>()) {
+        case ColorTag::NONE:
+            return svg::NoneColor;
+        case ColorTag::RGB:
+            return reader.Read<svg::Rgb>();
+        case ColorTag::RGBA: {
+            svg::Rgba rgba;
+            rgba.red = reader.Read<uint8_t>();
+            rgba.green = reader.Read<uint8_t>();
+            rgba.blue = reader.Read<uint8_t>();
+            rgba.opacity = reader.Read<double>();
+            return rgba;
+        }
+        case ColorTag::STRING:
+            return reader.ReadString();
+    }
+    throw SnapshotError("Unknown color tag"s);
+}
+
+void WriteLabel(const renderer::LabelRenderSetting& label, ByteWriter& writer) {
+    writer.Write(static_cast<int32_t>(label.font_size));
+    writer.Write(label.offset.x);
+    writer.Write(label.offset.y);
+}
+
+renderer::LabelRenderSetting ReadLabel(ByteReader& reader) {
+    renderer::LabelRenderSetting label;
+    label.font_size = reader.Read<int32_t>();
+    label.offset.x = reader.Read<double>();
+    label.offset.y = reader.Read<double>();
+    return label;
+}
+
+std::string SerializeRenderSettings(const renderer::RenderSettings& settings) {
+    ByteWriter writer;
+    writer.Write(settings.svg.width);
+    writer.Write(settings.svg.height);
+    writer.Write(settings.svg.padding);
+    writer.Write(settings.bus.line_width);
+    WriteLabel(settings.bus.label, writer);
+    writer.Write(settings.stop.radius);
+    WriteLabel(settings.stop.label, writer);
+    WriteColor(settings.underlayer.color, writer);
+    writer.Write(settings.underlayer.width);
+    writer.Write(static_cast<uint64_t>(settings.color_palette.size()));
+    for (const svg::Color& color : settings.color_palette) {
+        WriteColor(color, writer);
+    }
+    return writer.GetData();
+}
+
+renderer::RenderSettings DeserializeRenderSettings(std::string_view data) {
+    ByteReader reader(data);
+    renderer::RenderSettings settings;
+    settings.svg.width = reader.Read<double>();
+    settings.svg.height = reader.Read<double>();
+    settings.svg.padding = reader.Read<double>();
+    settings.bus.line_width = reader.Read<double>();
+    settings.bus.label = ReadLabel(reader);
+    settings.stop.radius = reader.Read<double>();
+    settings.stop.label = ReadLabel(reader);
+    settings.underlayer.color = ReadColor(reader);
+    settings.underlayer.width = reader.Read<double>();
+    const uint64_t palette_size = reader.Read<uint64_t>();
+    for (uint64_t i = 0; i < palette_size; ++i) {
+        settings.color_palette.push_back(ReadColor(reader));
+    }
+    return settings;
+}
+
+// ---------- Доступ к разделам отображённого файла ------------------
+
+template <typename Record>
+const Record* GetRecords(std::string_view file, const Section& section) {
+    if (section.offset % alignof(Record) != 0 || section.offset > file.size()
+        || section.count > (file.size() - section.offset) / sizeof(Record)) {
+        throw SnapshotError("Section is out of file bounds"s);
+    }
+    return reinterpret_cast<const Record*>(file.data() + section.offset);
+}
+
+std::string_view GetName(std::string_view strings, uint64_t offset, uint32_t length) {
+    if (offset > strings.size() || length > strings.size() - offset) {
+        throw SnapshotError("Name is out of string table bounds"s);
+    }
+    return strings.substr(offset, length);
+}
+
+// ---------- Иерархии сжатия ------------------
+
+struct HierarchySections {
+    std::vector<HierarchyRecord> records;
+    std::vector<uint32_t> ranks;
+    std::vector<uint32_t> degrees;
+    std::vector<HierarchyEdgeRecord> edges;
+};
+
+HierarchySections SerializeHierarchies(const std::vector<router::ContractionHierarchy>& hierarchies) {
+    HierarchySections sections;
+    for (size_t metric = 0; metric < hierarchies.size(); ++metric) {
+        const router::ContractionHierarchy& hierarchy = hierarchies[metric];
+        sections.records.push_back({static_cast<uint32_t>(metric), static_cast<uint32_t>(hierarchy.GetVertexCount())});
+        sections.ranks.insert(sections.ranks.end(), hierarchy.GetRanks().begin(), hierarchy.GetRanks().end());
+        for (const domain::FlatLists<router::ContractionHierarchy::Edge>* lists : {&hierarchy.GetUpward(), &hierarchy.GetDownward()}) {
+            for (size_t vertex = 0; vertex < lists->size(); ++vertex) {
+                const domain::Span<router::ContractionHierarchy::Edge> edges = (*lists)[vertex];
+                sections.degrees.push_back(static_cast<uint32_t>(edges.size()));
+                for (const router::ContractionHierarchy::Edge& edge : edges) {
+                    sections.edges.push_back({edge.vertex, edge.middle, edge.weight});
+                }
+            }
+        }
+    }
+    return sections;
+}
+
+bool HasEdge(domain::Span<router::ContractionHierarchy::Edge> edges, uint32_t vertex) {
+    return std::any_of(edges.begin(), edges.end(), [vertex](const router::ContractionHierarchy::Edge& edge) {
+        return edge.vertex == vertex;
+    });
+}
+
+// Читает иерархии и проверяет, что запрос по ним завершится: рёбра идут к вершинам большего ранга,
+// а у каждого сокращения есть обе половины через вершину меньшего ранга
+std::vector<router::ContractionHierarchy> ReadHierarchies(std::string_view file, const Header& header) {
+    using Edge = router::ContractionHierarchy::Edge;
+    const HierarchyRecord* records = GetRecords<HierarchyRecord>(file, header.hierarchies);
+    const uint32_t* ranks = GetRecords<uint32_t>(file, header.hierarchy_ranks);
+    const uint32_t* degrees = GetRecords<uint32_t>(file, header.hierarchy_degrees);
+    const HierarchyEdgeRecord* edges = GetRecords<HierarchyEdgeRecord>(file, header.hierarchy_edges);
+    uint64_t rank_position = 0;
+    uint64_t degree_position = 0;
+    uint64_t edge_position = 0;
+
+    std::vector<router::ContractionHierarchy> hierarchies;
+    std::vector<Edge> vertex_edges;
+    for (uint64_t i = 0; i < header.hierarchies.count; ++i) {
+        const uint64_t vertex_count = records[i].vertex_count;
+        if (records[i].metric != i || vertex_count > header.hierarchy_ranks.count - rank_position
+            || 2 * vertex_count > header.hierarchy_degrees.count - degree_position) {
+            throw SnapshotError("Hierarchy is out of range"s);
+        }
+        std::vector<uint32_t> vertex_ranks(ranks + rank_position, ranks + rank_position + vertex_count);
+        rank_position += vertex_count;
+        std::vector<char> used(vertex_count, 0);
+        for (uint32_t rank : vertex_ranks) {
+            if (rank >= vertex_count || used[rank]) {
+                throw SnapshotError("Invalid hierarchy rank"s);
+            }
+            used[rank] = 1;
+        }
+
+        domain::FlatLists<Edge> lists[2];
+        for (domain::FlatLists<Edge>& list : lists) {
+            list.Reserve(vertex_count, 0);
+            for (uint64_t vertex = 0; vertex < vertex_count; ++vertex) {
+                const uint32_t degree = degrees[degree_position++];
+                if (degree > header.hierarchy_edges.count - edge_position) {
+                    throw SnapshotError("Hierarchy edge is out of range"s);
+                }
+                vertex_edges.clear();
+                for (uint32_t j = 0; j < degree; ++j) {
+                    const HierarchyEdgeRecord& edge = edges[edge_position++];
+                    const bool valid_middle = edge.middle == router::ContractionHierarchy::NO_VERTEX
+                                              || (edge.middle < vertex_count && vertex_ranks[edge.middle] < vertex_ranks[vertex]);
+                    if (edge.vertex >= vertex_count || vertex_ranks[edge.vertex] <= vertex_ranks[vertex] || !valid_middle || !(edge.weight >= 0)) {
+                        throw SnapshotError("Invalid hierarchy edge"s);
+                    }
+                    vertex_edges.push_back({edge.vertex, edge.middle, edge.weight});
+                }
+                list.Append(vertex_edges.begin(), vertex_edges.end());
+            }
+        }
+
+        //Ребро вверх v -> x через m раскрывается в v -> m из списка вниз m и m -> x из списка вверх m, ребро вниз x -> v - в x -> m и m -> v
+        const auto& [upward, downward] = lists;
+        for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+            for (const Edge& edge : upward[vertex]) {
+                if (edge.middle != router::ContractionHierarchy::NO_VERTEX
+                    && !(HasEdge(downward[edge.middle], vertex) && HasEdge(upward[edge.middle], edge.vertex))) {
+                    throw SnapshotError("Hierarchy shortcut has no halves"s);
+                }
+            }
+            for (const Edge& edge : downward[vertex]) {
+                if (edge.middle != router::ContractionHierarchy::NO_VERTEX
+                    && !(HasEdge(downward[edge.middle], edge.vertex) && HasEdge(upward[edge.middle], vertex))) {
+                    throw SnapshotError("Hierarchy shortcut has no halves"s);
+                }
+            }
+        }
+        hierarchies.emplace_back(std::move(vertex_ranks), std::move(lists[0]), std::move(lists[1]));
+    }
+    if (rank_position != header.hierarchy_ranks.count || degree_position != header.hierarchy_degrees.count
+        || edge_position != header.hierarchy_edges.count) {
+        throw SnapshotError("Hierarchy sections don't match"s);
+    }
+    return hierarchies;
+}
+
+}  // namespace
+
+bool IsSnapshot(std::string_view data) {
+    return data.size() >= sizeof(MAGIC) && std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void SaveSnapshot(const std::string& path, const transport_catalogue::TransportCatalogue& db,
+                  const renderer::RenderSettings& render_settings, const std::optional<router::RoutingSettings>& routing_settings) {
+    //Удалённые остановки и маршруты не сохраняются, остальные остановки нумеруются в файле подряд
+    std::string strings;
+    std::vector<StopRecord> stop_records;
+    std::vector<uint32_t> stop_indices(db.GetStopCount());
+    stop_records.reserve(db.GetStopCount());
+    for (domain::StopId stop = 0; stop < db.GetStopCount(); ++stop) {
+        if (db.IsStopRemoved(stop)) {
+            continue;
+        }
+        stop_indices[stop] = static_cast<uint32_t>(stop_records.size());
+        const std::string_view name = db.GetStopName(stop);
+        const geo::Coordinates coordinates = db.GetStopCoordinates(stop);
+        stop_records.push_back({strings.size(), static_cast<uint32_t>(name.size()), 0, coordinates.lat, coordinates.lng});
+        strings += name;
+    }
+
+    std::vector<BusRecord> bus_records;
+    std::vector<uint32_t> route_stops;
+    bus_records.reserve(db.GetBusCount());
+    for (domain::BusId bus = 0; bus < db.GetBusCount(); ++bus) {
+        if (db.IsBusRemoved(bus)) {
+            continue;
+        }
+        const std::string_view name = db.GetBusName(bus);
+        const domain::Span<domain::StopId> route = db.GetRoute(bus);
+        bus_records.push_back({strings.size(), static_cast<uint32_t>(name.size()), static_cast<uint32_t>(db.GetBusType(bus)),
+                               route_stops.size(), route.size()});
+        strings += name;
+        for (domain::StopId stop : route) {
+            route_stops.push_back(stop_indices[stop]);
+        }
+    }
+
+    std::vector<DistanceRecord> distance_records;
+    for (const domain::StopsDistance& distance : db.GetDistances()) {
+        distance_records.push_back({stop_indices[distance.from], stop_indices[distance.to], distance.distance});
+    }
+
+    const std::string settings = SerializeRenderSettings(render_settings);
+    std::vector<RoutingSettingsRecord> routing_records;
+    HierarchySections hierarchies;
+    if (routing_settings) {
+        routing_records.push_back({routing_settings->bus_wait_time, routing_settings->contraction_hierarchies ? CONTRACTION_HIERARCHIES_FLAG : 0,
+                                   routing_settings->bus_velocity});
+        //Граф путей после загрузки совпадает с графом db, только если номера остановок в файле равны их StopId
+        if (routing_settings->contraction_hierarchies && stop_records.size() == db.GetStopCount()) {
+            hierarchies = SerializeHierarchies(router::TransportRouter(db, *routing_settings).GetHierarchies());
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    uint64_t offset = sizeof(Header);
+    auto place = [&offset](Section& section, uint64_t count, uint64_t record_size) {
+        offset = Align(offset);
+        section = {offset, count};
+        offset += count * record_size;
+    };
+    place(header.strings, strings.size(), 1);
+    place(header.stops, stop_records.size(), sizeof(StopRecord));
+    place(header.buses, bus_records.size(), sizeof(BusRecord));
+    place(header.route_stops, route_stops.size(), sizeof(uint32_t));
+    place(header.distances, distance_records.size(), sizeof(DistanceRecord));
+    place(header.render_settings, settings.size(), 1);
+    place(header.routing_settings, routing_records.size(), sizeof(RoutingSettingsRecord));
+    place(header.hierarchies, hierarchies.records.size(), sizeof(HierarchyRecord));
+    place(header.hierarchy_ranks, hierarchies.ranks.size(), sizeof(uint32_t));
+    place(header.hierarchy_degrees, hierarchies.degrees.size(), sizeof(uint32_t));
+    place(header.hierarchy_edges, hierarchies.edges.size(), sizeof(HierarchyEdgeRecord));
+    header.file_size = offset;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw SnapshotError("Can't create file "s + path);
+    }
+    uint64_t written = 0;
+    auto write = [&out, &written](const Section& section, const void* data, uint64_t size) {
+        static const char padding[ALIGNMENT] = {};
+        out.write(padding, section.offset - written);
+        out.write(static_cast<const char*>(data), size);
+        written = section.offset + size;
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    written = sizeof(header);
+    write(header.strings, strings.data(), strings.size());
+    write(header.stops, stop_records.data(), stop_records.size() * sizeof(StopRecord));
+    write(header.buses, bus_records.data(), bus_records.size() * sizeof(BusRecord));
+    write(header.route_stops, route_stops.data(), route_stops.size() * sizeof(uint32_t));
+    write(header.distances, distance_records.data(), distance_records.size() * sizeof(DistanceRecord));
+    write(header.render_settings, settings.data(), settings.size());
+    write(header.routing_settings, routing_records.data(), routing_records.size() * sizeof(RoutingSettingsRecord));
+    write(header.hierarchies, hierarchies.records.data(), hierarchies.records.size() * sizeof(HierarchyRecord));
+    write(header.hierarchy_ranks, hierarchies.ranks.data(), hierarchies.ranks.size() * sizeof(uint32_t));
+    write(header.hierarchy_degrees, hierarchies.degrees.data(), hierarchies.degrees.size() * sizeof(uint32_t));
+    write(header.hierarchy_edges, hierarchies.edges.data(), hierarchies.edges.size() * sizeof(HierarchyEdgeRecord));
+    if (!out) {
+        throw SnapshotError("Can't write file "s + path);
+    }
+}
+
+void LoadSnapshot(const std::string& path, transport_catalogue::TransportCatalogue& db,
+                  renderer::RenderSettings& render_settings, std::optional<router::RoutingSettings>& routing_settings,
+                  std::shared_ptr<const router::TransportRouter>& transport_router) {
+    io::MappedFile mapped_file(path);
+    const std::string_view file = mapped_file.GetData();
+
+    Header header{};
+    if (file.size() < sizeof(Header)) {
+        throw SnapshotError("File is too small: "s + path);
+    }
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw SnapshotError("Not a transport catalogue snapshot: "s + path);
+    }
+    if (header.byte_order != BYTE_ORDER_MARK) {
+        throw SnapshotError("Snapshot was written with different byte order"s);
+    }
+    if (header.version != FORMAT_VERSION) {
+        throw SnapshotError("Unsupported snapshot version "s + std::to_string(header.version));
+    }
+    if (header.file_size != file.size()) {
+        throw SnapshotError("Snapshot is truncated"s);
+    }
+
+    const std::string_view strings(GetRecords<char>(file, header.strings), header.strings.count);
+    const StopRecord* stops = GetRecords<StopRecord>(file, header.stops);
+    const BusRecord* buses = GetRecords<BusRecord>(file, header.buses);
+    const uint32_t* route_stops = GetRecords<uint32_t>(file, header.route_stops);
+    const DistanceRecord* distances = GetRecords<DistanceRecord>(file, header.distances);
+    const std::string_view settings(GetRecords<char>(file, header.render_settings), header.render_settings.count);
+    const RoutingSettingsRecord* routing = GetRecords<RoutingSettingsRecord>(file, header.routing_settings);
+
+    for (uint64_t i = 0; i < header.route_stops.count; ++i) {
+        if (route_stops[i] >= header.stops.count) {
+            throw SnapshotError("Stop index is out of range"s);
+        }
+    }
+    db.Reserve(header.stops.count, header.buses.count, header.route_stops.count);
+
+    //Справочник пуст, поэтому StopId остановки совпадает с её номером в файле
+    for (uint64_t i = 0; i < header.stops.count; ++i) {
+        db.AddStop(GetName(strings, stops[i].name_offset, stops[i].name_length), {stops[i].lat, stops[i].lng});
+    }
+
+    for (uint64_t i = 0; i < header.distances.count; ++i) {
+        if (distances[i].from >= header.stops.count || distances[i].to >= header.stops.count) {
+            throw SnapshotError("Stop index is out of range"s);
+        }
+        db.AddDistanceToStops(distances[i].from, distances[i].to, distances[i].distance);
+    }
+
+    //Остановки маршрутов передаются в справочник прямо из отображённого файла
+    for (uint64_t i = 0; i < header.buses.count; ++i) {
+        const BusRecord& bus = buses[i];
+        if (bus.route_offset > header.route_stops.count || bus.route_length > header.route_stops.count - bus.route_offset) {
+            throw SnapshotError("Route is out of range"s);
+        }
+        const domain::Span<domain::StopId> route(route_stops + bus.route_offset, route_stops + bus.route_offset + bus.route_length);
+        db.AddBus(GetName(strings, bus.name_offset, bus.name_length), route,
+                  bus.type == static_cast<uint32_t>(domain::TypeRoute::circular) ? domain::TypeRoute::circular : domain::TypeRoute::linear);
+    }
+
+    db.Finalize();
+    render_settings = DeserializeRenderSettings(settings);
+    routing_settings.reset();
+    transport_router.reset();
+    if (header.routing_settings.count > 0) {
+        routing_settings = router::RoutingSettings{routing->bus_wait_time, routing->bus_velocity,
+                                                   (routing->flags & CONTRACTION_HIERARCHIES_FLAG) != 0};
+        if (header.hierarchies.count > 0) {
+            try {
+                transport_router = std::make_shared<const router::TransportRouter>(db, *routing_settings, ReadHierarchies(file, header));
+            } catch (const std::invalid_argument& e) {
+                throw SnapshotError(e.what());
+            }
+        }
+    }
+}
+
+}  // namespace serialization
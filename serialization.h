@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+/*
+ * Сохранение заполненного транспортного справочника и настроек визуализации в бинарный файл
+ * и загрузка из него. Формат версионирован и не содержит указателей: все ссылки между
+ * записями - это индексы и смещения от начала файла, поэтому файл отображается в память и записи
+ * читаются на месте, без разбора. Сам справочник по ним пока строится заново: остановки, расстояния
+ * и маршруты добавляются по одному, а Finalize заново считает статистику маршрутов, граф расстояний
+ * и индекс остановок, так что загрузка линейна по размеру справочника и выделяет память под его столбцы.
+ *
+ * Структура файла: заголовок, таблица строк (имена остановок и маршрутов подряд),
+ * массивы записей остановок, маршрутов, остановок маршрутов и расстояний,
+ * сериализованные настройки визуализации и настройки маршрутизации, иерархии сжатия графа путей.
+ * Каждый раздел выровнен по 8 байт. Файлы другой версии формата не читаются
+ */
+namespace serialization {
+
+inline constexpr uint32_t FORMAT_VERSION = 1;
+
+struct SerializationSettings {
+    std::string file;
+};
+
+class SnapshotError : public std::runtime_error {
+   public:
+    using runtime_error::runtime_error;
+};
+
+// Проверяет, начинаются ли данные с сигнатуры файла справочника
+bool IsSnapshot(std::string_view data);
+
+// Если в routing_settings включены иерархии сжатия, строит их по db и сохраняет вместе со справочником
+void SaveSnapshot(const std::string& path, const transport_catalogue::TransportCatalogue& db,
+                  const renderer::RenderSettings& render_settings,
+                  const std::optional<router::RoutingSettings>& routing_settings = std::nullopt);
+
+// Заполняет пустой справочник db и настройки визуализации и маршрутизации из файла. Если в файле есть
+// иерархии сжатия, transport_router - граф путей с ними, иначе nullptr.
+// Бросает SnapshotError, если файл повреждён или записан другой версией формата
+void LoadSnapshot(const std::string& path, transport_catalogue::TransportCatalogue& db,
+                  renderer::RenderSettings& render_settings, std::optional<router::RoutingSettings>& routing_settings,
+                  std::shared_ptr<const router::TransportRouter>& transport_router);
+
+}  // namespace serialization
@@ -0,0 +1,392 @@
+#include "server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+#include "json_reader.h"
+
+using namespace std::string_literals;
+
+namespace server {
+
+namespace {
+
+// Номера служебных дескрипторов в epoll, номера соединений начинаются после них
+constexpr uint64_t LISTEN_ID = 0;
+constexpr uint64_t WAKE_ID = 1;
+constexpr uint64_t SIGNAL_ID = 2;
+constexpr uint64_t FIRST_CONNECTION_ID = 3;
+
+constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+constexpr int MAX_EVENTS = 64;
+
+[[noreturn]] void ThrowSystemError(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void ControlEpoll(int epoll_fd, int operation, int fd, uint64_t id, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    if (epoll_ctl(epoll_fd, operation, fd, &event) < 0) {
+        ThrowSystemError("epoll_ctl");
+    }
+}
+
+}  // namespace
+
+Server::Server(ServerSettings settings, const transport_catalogue::CatalogueRegistry& registry)
+    : settings_(std::move(settings)), registry_(registry), next_connection_id_(FIRST_CONNECTION_ID) {
+    if (settings_.thread_count == 0) {
+        settings_.thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+Server::~Server() {
+    // Задачи пула обращаются к wake_fd_, поэтому пул останавливается до закрытия дескрипторов
+    pool_.reset();
+    for (auto& [id, connection] : connections_) {
+        close(connection.fd);
+    }
+    for (int fd : {listen_fd_, epoll_fd_, wake_fd_, signal_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (listen_fd_ >= 0 && !settings_.tcp_port) {
+        unlink(settings_.unix_path.c_str());
+    }
+}
+
+void Server::Run() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    // Потоки пула наследуют маску сигналов, поэтому сигналы блокируются до их запуска
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    signal_fd_ = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd_ < 0) {
+        ThrowSystemError("signalfd");
+    }
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        ThrowSystemError("eventfd");
+    }
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        ThrowSystemError("epoll_create1");
+    }
+    OpenListener();
+    pool_ = std::make_unique<concurrency::ThreadPool>(settings_.thread_count);
+
+    ControlEpoll(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, LISTEN_ID, EPOLLIN);
+    ControlEpoll(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, WAKE_ID, EPOLLIN);
+    ControlEpoll(epoll_fd_, EPOLL_CTL_ADD, signal_fd_, SIGNAL_ID, EPOLLIN);
+
+    std::array<epoll_event, MAX_EVENTS> events;
+    bool stopping = false;
+    while (!stopping) {
+        const int count = epoll_wait(epoll_fd_, events.data(), MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait");
+        }
+        for (int i = 0; i < count; ++i) {
+            const uint64_t id = events[i].data.u64;
+            const uint32_t flags = events[i].events;
+            if (id == LISTEN_ID) {
+                AcceptConnections();
+                continue;
+            }
+            if (id == WAKE_ID) {
+                CollectCompleted();
+                continue;
+            }
+            if (id == SIGNAL_ID) {
+                stopping = true;
+                continue;
+            }
+
+            const auto it = connections_.find(id);
+            if (it == connections_.end()) {
+                continue;
+            }
+            Connection& connection = it->second;
+            if (flags & EPOLLERR) {
+                CloseConnection(id);
+                continue;
+            }
+            if ((flags & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) && !ReadConnection(id, connection)) {
+                continue;
+            }
+            if ((flags & EPOLLOUT) && !FlushConnection(id, connection)) {
+                continue;
+            }
+            //Отправка ответов могла освободить место для следующей пачки запросов
+            Dispatch(id, connection);
+            CloseIfDone(id, connection);
+        }
+    }
+}
+
+void Server::OpenListener() {
+    if (settings_.tcp_port) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            ThrowSystemError("socket");
+        }
+        const int enable = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(*settings_.tcp_port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            ThrowSystemError("bind");
+        }
+    } else {
+        sockaddr_un address{};
+        if (settings_.unix_path.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Socket path is too long: "s + settings_.unix_path);
+        }
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            ThrowSystemError("socket");
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, settings_.unix_path.data(), settings_.unix_path.size());
+        //Сокет, оставшийся от предыдущего запуска, мешает bind
+        unlink(settings_.unix_path.c_str());
+        if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            ThrowSystemError("bind");
+        }
+    }
+    if (listen(listen_fd_, SOMAXCONN) < 0) {
+        ThrowSystemError("listen");
+    }
+}
+
+void Server::AcceptConnections() {
+    while (true) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // EAGAIN - очередь пуста; при нехватке дескрипторов соединение ждёт в очереди listen
+            return;
+        }
+        if (settings_.tcp_port) {
+            const int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+        const uint64_t id = next_connection_id_++;
+        Connection& connection = connections_[id];
+        connection.fd = fd;
+        ControlEpoll(epoll_fd_, EPOLL_CTL_ADD, fd, id, EPOLLIN | EPOLLRDHUP);
+    }
+}
+
+bool Server::ReadConnection(uint64_t id, Connection& connection) {
+    if (connection.read_closed) {
+        return true;
+    }
+    char buffer[READ_CHUNK_SIZE];
+    //Непрочитанное остаётся в сокете, пока соединение переполнено: EPOLLIN снимается в UpdateEvents,
+    //и клиент упирается в окно TCP, а не в память сервера
+    while (!IsBacklogged(connection)) {
+        const ssize_t size = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (size > 0) {
+            //Выделяем законченные строки, неполная остаётся в буфере до следующей порции
+            const size_t scanned = connection.input.size();
+            connection.input.append(buffer, size);
+            size_t line_start = 0;
+            for (size_t pos = connection.input.find('\n', scanned); pos != std::string::npos;
+                 pos = connection.input.find('\n', line_start)) {
+                connection.pending_size += pos - line_start;
+                connection.pending_lines.emplace_back(connection.input, line_start, pos - line_start);
+                line_start = pos + 1;
+            }
+            connection.input.erase(0, line_start);
+            if (connection.input.size() > settings_.max_line_length) {
+                CloseConnection(id);
+                return false;
+            }
+            continue;
+        }
+        if (size == 0) {
+            connection.read_closed = true;
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        CloseConnection(id);
+        return false;
+    }
+
+    if (connection.read_closed && !connection.input.empty()) {
+        connection.pending_size += connection.input.size();
+        connection.pending_lines.push_back(std::move(connection.input));
+        connection.input.clear();
+    }
+    UpdateEvents(id, connection);
+    return true;
+}
+
+void Server::Dispatch(uint64_t id, Connection& connection) {
+    //Пока клиент не забрал ответы, новые запросы не выполняются и копятся до max_buffered_size
+    if (connection.busy || connection.pending_lines.empty()
+        || connection.output.size() - connection.output_offset >= settings_.max_buffered_size) {
+        return;
+    }
+    connection.busy = true;
+    pool_->Submit([this, id, lines = std::move(connection.pending_lines)]() mutable {
+        std::ostringstream output;
+        auto line = lines.begin();
+        //Ответы на одну пачку (например, на тысячи запросов Map) тоже ограничены max_buffered_size
+        for (; line != lines.end() && static_cast<size_t>(output.tellp()) < settings_.max_buffered_size; ++line) {
+            if (json_reader::AnswerJsonLine(*line, output, registry_)) {
+                output.put('\n');
+            }
+        }
+        lines.erase(lines.begin(), line);
+        {
+            std::lock_guard lock(completed_mutex_);
+            completed_.push_back({id, output.str(), std::move(lines)});
+        }
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = write(wake_fd_, &one, sizeof(one));
+    });
+    connection.pending_lines.clear();
+    connection.pending_size = 0;
+    UpdateEvents(id, connection);
+}
+
+bool Server::FlushConnection(uint64_t id, Connection& connection) {
+    while (connection.output_offset < connection.output.size()) {
+        const ssize_t size = send(connection.fd, connection.output.data() + connection.output_offset,
+                                  connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (size >= 0) {
+            connection.output_offset += size;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        CloseConnection(id);
+        return false;
+    }
+    if (connection.output_offset == connection.output.size()) {
+        connection.output.clear();
+        connection.output_offset = 0;
+    }
+    UpdateEvents(id, connection);
+    return true;
+}
+
+void Server::CollectCompleted() {
+    uint64_t counter;
+    [[maybe_unused]] const ssize_t size = read(wake_fd_, &counter, sizeof(counter));
+
+    std::vector<Completed> completed;
+    {
+        std::lock_guard lock(completed_mutex_);
+        completed.swap(completed_);
+    }
+    for (auto& [id, response, unanswered] : completed) {
+        const auto it = connections_.find(id);
+        if (it == connections_.end()) {
+            continue;  // клиент отключился, пока запросы выполнялись
+        }
+        Connection& connection = it->second;
+        connection.busy = false;
+        connection.output += response;
+        if (!unanswered.empty()) {
+            for (const std::string& line : unanswered) {
+                connection.pending_size += line.size();
+            }
+            std::move(connection.pending_lines.begin(), connection.pending_lines.end(), std::back_inserter(unanswered));
+            connection.pending_lines = std::move(unanswered);
+        }
+        Dispatch(id, connection);
+        if (FlushConnection(id, connection)) {
+            CloseIfDone(id, connection);
+        }
+    }
+}
+
+void Server::CloseConnection(uint64_t id) {
+    const auto it = connections_.find(id);
+    if (it == connections_.end()) {
+        return;
+    }
+    // Закрытие дескриптора удаляет его из epoll
+    close(it->second.fd);
+    connections_.erase(it);
+}
+
+void Server::CloseIfDone(uint64_t id, Connection& connection) {
+    if (connection.read_closed && !connection.busy && connection.pending_lines.empty() && connection.output.empty()) {
+        CloseConnection(id);
+    }
+}
+
+bool Server::IsBacklogged(const Connection& connection) const {
+    return connection.pending_size >= settings_.max_buffered_size
+           || connection.output.size() - connection.output_offset >= settings_.max_buffered_size;
+}
+
+void Server::UpdateEvents(uint64_t id, Connection& connection) {
+    const bool want_write = !connection.output.empty();
+    const bool want_read = !connection.read_closed && !IsBacklogged(connection);
+    if (want_write == connection.want_write && want_read == connection.want_read) {
+        return;
+    }
+    connection.want_write = want_write;
+    connection.want_read = want_read;
+    uint32_t events = want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u;
+    if (want_read) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+    //EPOLLHUP нельзя исключить из маски, и после разрыва соединения epoll_wait возвращал бы его
+    //в каждом цикле, пока пул отвечает на запросы. Поэтому сокет без событий убирается из epoll
+    //и добавляется обратно, когда появляется что отправить или можно снова читать
+    if (events == 0) {
+        if (connection.in_epoll) {
+            ControlEpoll(epoll_fd_, EPOLL_CTL_DEL, connection.fd, id, 0);
+            connection.in_epoll = false;
+        }
+        return;
+    }
+    ControlEpoll(epoll_fd_, connection.in_epoll ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, connection.fd, id, events);
+    connection.in_epoll = true;
+}
+
+}  // namespace server
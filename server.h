@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+#include "catalogue_registry.h"
+
+/*
+ * Сервер запросов к справочнику через локальный сокет (Linux).
+ * Сервер обслуживает справочники городов из CatalogueRegistry общим пулом потоков; запрос
+ * направляется в город по ключу "city". Справочник города хранится версиями (VersionedCatalogue):
+ * запросы разных клиентов обрабатываются параллельно без блокировок, каждый над текущей версией,
+ * а запрос Update публикует новую версию, не останавливая остальных.
+ *
+ * Протокол совпадает с режимом serve: клиент присылает запросы по одному в строке (JSON Lines),
+ * сервер отвечает на каждый одной строкой в том же порядке.
+ * Сетевой ввод-вывод выполняет один поток на epoll, вычисление ответов - потоки пула.
+ * Для каждого соединения в пул отправляется не больше одной задачи сразу, поэтому порядок
+ * ответов сохраняется, а строки, пришедшие за время её выполнения, уходят следующей пачкой
+ */
+namespace server {
+
+struct ServerSettings {
+    std::string unix_path = "/tmp/transport_catalogue.sock";
+    // Если задан, сервер слушает TCP-порт на 127.0.0.1 вместо сокета Unix
+    std::optional<uint16_t> tcp_port;
+    size_t thread_count = 0;  // 0 - по числу аппаратных потоков
+    size_t max_line_length = 1 << 20;
+    // Предел байт в очереди запросов и в неотправленных ответах одного соединения: пока он превышен,
+    // сервер не читает из сокета, и клиент, который не забирает ответы, не раздувает память сервера
+    size_t max_buffered_size = 1 << 24;
+};
+
+class Server {
+   public:
+    Server(ServerSettings settings, const transport_catalogue::CatalogueRegistry& registry);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Принимает соединения и отвечает на запросы до получения SIGINT или SIGTERM
+    void Run();
+
+   private:
+    struct Connection {
+        int fd = -1;
+        std::string input;
+        std::vector<std::string> pending_lines;
+        size_t pending_size = 0;  // суммарная длина pending_lines
+        std::string output;
+        size_t output_offset = 0;
+        bool busy = false;         // в пуле есть задача с запросами этого соединения
+        bool read_closed = false;  // клиент закончил передачу
+        bool want_write = false;   // сокет подписан на EPOLLOUT
+        bool want_read = true;     // сокет подписан на EPOLLIN
+        bool in_epoll = true;      // сокет зарегистрирован в epoll
+    };
+
+    void OpenListener();
+    void AcceptConnections();
+    // Возвращают false, если соединение закрыто из-за ошибки
+    bool ReadConnection(uint64_t id, Connection& connection);
+    void Dispatch(uint64_t id, Connection& connection);
+    bool FlushConnection(uint64_t id, Connection& connection);
+    void CollectCompleted();
+    void CloseConnection(uint64_t id);
+    // Закрывает соединение, если клиент закончил передачу и все ответы отправлены
+    void CloseIfDone(uint64_t id, Connection& connection);
+    // Очередь запросов или неотправленных ответов соединения превысила max_buffered_size
+    bool IsBacklogged(const Connection& connection) const;
+    // Подписывает сокет на запись, если есть что отправить, и на чтение, если клиент не закончил
+    // передачу и соединение не переполнено
+    void UpdateEvents(uint64_t id, Connection& connection);
+
+    ServerSettings settings_;
+    const transport_catalogue::CatalogueRegistry& registry_;
+
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;    // eventfd, через который пул сообщает о готовых ответах
+    int signal_fd_ = -1;  // signalfd для SIGINT и SIGTERM
+
+    // Соединения различаются по возрастающему номеру, а не по дескриптору:
+    // дескриптор закрытого соединения может достаться новому, пока ответ для старого ещё в пуле
+    uint64_t next_connection_id_;
+    std::unordered_map<uint64_t, Connection> connections_;
+
+    // Ответы пачки запросов соединения и запросы, до которых пачка не дошла, потому что ответы
+    // превысили max_buffered_size: они возвращаются в начало очереди соединения
+    struct Completed {
+        uint64_t id;
+        std::string output;
+        std::vector<std::string> unanswered;
+    };
+    std::mutex completed_mutex_;
+    std::vector<Completed> completed_;
+
+    std::unique_ptr<concurrency::ThreadPool> pool_;
+};
+
+}  // namespace server
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "catalogue_registry.h"
+#include "server.h"
+
+using namespace std;
+
+static void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue_server [base.json|base.db] [--city KEY=PATH]... [--unix PATH | --tcp PORT] [--threads N]\n"sv;
+}
+
+// Запуск: transport_catalogue_server [base.json|base.db] [--city KEY=PATH]... [--unix PATH | --tcp PORT] [--threads N]
+// Базы городов загружаются один раз и параллельно: base - город с пустым ключом, на который направляются
+// запросы без "city", --city - город с ключом KEY. Затем сервер отвечает на запросы клиентов, подключённых
+// к сокету, до получения SIGINT или SIGTERM. По умолчанию используется сокет /tmp/transport_catalogue.sock
+int main(int argc, char* argv[]) {
+    server::ServerSettings settings;
+    std::vector<transport_catalogue::CatalogueRegistry::CitySource> cities;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        if (argument == "--unix"sv && i + 1 < argc) {
+            settings.unix_path = argv[++i];
+        } else if (argument == "--tcp"sv && i + 1 < argc) {
+            settings.tcp_port = static_cast<uint16_t>(std::stoi(argv[++i]));
+        } else if (argument == "--threads"sv && i + 1 < argc) {
+            settings.thread_count = std::max(1, std::stoi(argv[++i]));
+        } else if (argument == "--city"sv && i + 1 < argc) {
+            const std::string_view city = argv[++i];
+            const size_t separator = city.find('=');
+            if (separator == std::string_view::npos) {
+                PrintUsage();
+                return 1;
+            }
+            cities.push_back({std::string(city.substr(0, separator)), std::string(city.substr(separator + 1))});
+        } else if (i == 1 && argument.substr(0, 2) != "--"sv) {
+            cities.push_back({std::string(), std::string(argument)});
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (cities.empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    transport_catalogue::CatalogueRegistry registry;
+    try {
+        registry.Load(cities, settings.thread_count);
+        for (const transport_catalogue::CatalogueRegistry::CityInfo& city : registry.GetCities()) {
+            cerr << "city \""sv << city.key << "\": "sv << city.stop_count << " stops, "sv << city.bus_count << " buses, "sv
+                 << city.memory_usage / 1024 << " KB\n"sv;
+        }
+        server::Server server(settings, registry);
+        server.Run();
+    } catch (const std::exception& e) {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
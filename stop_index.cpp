@@ -0,0 +1,80 @@
+#define _USE_MATH_DEFINES
+#include "stop_index.h"
+
+#include <cmath>
+#include <limits>
+
+namespace transport_catalogue {
+
+void StopIndex::Build(const domain::PagedVector<double>& latitudes, const domain::PagedVector<double>& longitudes,
+                      const std::vector<char>& removed) {
+    geo::Coordinates min{std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+    geo::Coordinates max{std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+    size_t stop_count = 0;
+    for (size_t stop = 0; stop < latitudes.size(); ++stop) {
+        if (removed[stop]) {
+            continue;
+        }
+        min = {std::min(min.lat, latitudes[stop]), std::min(min.lng, longitudes[stop])};
+        max = {std::max(max.lat, latitudes[stop]), std::max(max.lng, longitudes[stop])};
+        ++stop_count;
+    }
+    if (stop_count == 0) {
+        min = max = {0, 0};
+    }
+
+    //Стороны ячеек примерно равны в метрах: градус долготы короче градуса широты в cos(широты) раз
+    const double height = max.lat - min.lat;
+    const double width = (max.lng - min.lng) * std::cos((min.lat + max.lat) / 2 * M_PI / 180);
+    const size_t cell_count = std::max<size_t>(1, stop_count / STOPS_PER_CELL);
+    if (height <= 0 || width <= 0) {
+        rows_ = height > 0 ? cell_count : 1;
+        columns_ = width > 0 ? cell_count : 1;
+    } else {
+        rows_ = std::clamp<size_t>(static_cast<size_t>(std::lround(std::sqrt(cell_count * height / width))), 1, cell_count);
+        columns_ = std::max<size_t>(1, cell_count / rows_);
+    }
+    origin_ = min;
+    rows_per_degree_ = height > 0 ? rows_ / height : 0;
+    columns_per_degree_ = max.lng > min.lng ? columns_ / (max.lng - min.lng) : 0;
+
+    std::vector<std::vector<domain::StopId>> cells(rows_ * columns_);
+    for (size_t stop = 0; stop < latitudes.size(); ++stop) {
+        if (!removed[stop]) {
+            cells[GetRow(latitudes[stop]) * columns_ + GetColumn(longitudes[stop])].push_back(static_cast<domain::StopId>(stop));
+        }
+    }
+    cells_ = {};
+    cells_.Reserve(cells.size(), latitudes.size());
+    for (const std::vector<domain::StopId>& cell : cells) {
+        cells_.Append(cell.begin(), cell.end());
+    }
+}
+
+void StopIndex::Insert(domain::StopId stop, geo::Coordinates coordinates) {
+    const size_t cell = GetRow(coordinates.lat) * columns_ + GetColumn(coordinates.lng);
+    const domain::Span<domain::StopId> current = cells_[cell];
+    std::vector<domain::StopId> stops(current.begin(), current.end());
+    stops.push_back(stop);
+    cells_.Replace(cell, stops.begin(), stops.end());
+}
+
+void StopIndex::Erase(domain::StopId stop, geo::Coordinates coordinates) {
+    const size_t cell = GetRow(coordinates.lat) * columns_ + GetColumn(coordinates.lng);
+    const domain::Span<domain::StopId> current = cells_[cell];
+    std::vector<domain::StopId> stops(current.begin(), current.end());
+    stops.erase(std::remove(stops.begin(), stops.end(), stop), stops.end());
+    cells_.Replace(cell, stops.begin(), stops.end());
+}
+
+size_t StopIndex::GetRow(double lat) const {
+    const double row = std::floor((lat - origin_.lat) * rows_per_degree_);
+    return row <= 0 ? 0 : std::min(rows_ - 1, static_cast<size_t>(std::min(row, static_cast<double>(rows_))));
+}
+
+size_t StopIndex::GetColumn(double lng) const {
+    const double column = std::floor((lng - origin_.lng) * columns_per_degree_);
+    return column <= 0 ? 0 : std::min(columns_ - 1, static_cast<size_t>(std::min(column, static_cast<double>(columns_))));
+}
+
+}  // namespace transport_catalogue
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "domain.h"
+#include "geo.h"
+
+namespace transport_catalogue {
+
+/*
+ * Пространственный индекс остановок: равномерная сетка по широте и долготе.
+ * Сетка строится один раз по охватывающему прямоугольнику остановок, а дальше остановки
+ * добавляются, переносятся и удаляются без перестройки. Остановка за границами сетки
+ * попадает в ближайшую крайнюю ячейку, поэтому перебор ячеек прямоугольника находит
+ * все остановки в нём, но может вернуть и лишние: точное сравнение координат - за вызывающим
+ */
+class StopIndex {
+   public:
+    // Строит сетку над неудалёнными остановками, в среднем по STOPS_PER_CELL остановок в ячейке
+    void Build(const domain::PagedVector<double>& latitudes, const domain::PagedVector<double>& longitudes, const std::vector<char>& removed);
+
+    void Insert(domain::StopId stop, geo::Coordinates coordinates);
+    void Erase(domain::StopId stop, geo::Coordinates coordinates);
+
+    size_t GetMemoryUsage() const {
+        return cells_.GetMemoryUsage();
+    }
+
+    // Вызывает function(StopId) для остановок из ячеек, пересекающих box.
+    // Долгота box не переходит через 180-й меридиан
+    template <typename Function>
+    void ForEachInBox(geo::Box box, Function function) const {
+        if (cells_.size() == 0 || box.min.lat > box.max.lat || box.min.lng > box.max.lng) {
+            return;
+        }
+        const size_t row_end = GetRow(box.max.lat) + 1;
+        const size_t column_end = GetColumn(box.max.lng) + 1;
+        for (size_t row = GetRow(box.min.lat); row < row_end; ++row) {
+            for (size_t column = GetColumn(box.min.lng); column < column_end; ++column) {
+                for (domain::StopId stop : cells_[row * columns_ + column]) {
+                    function(stop);
+                }
+            }
+        }
+    }
+
+    // Вызывает function(StopId) для остановок из ячеек на расстоянии ring ячеек от ячейки точки
+    // (ring = 0 - сама ячейка). Возвращает false, если кольцо целиком за пределами сетки
+    template <typename Function>
+    bool ForEachInRing(geo::Coordinates center, size_t ring, Function function) const {
+        if (cells_.size() == 0 || ring >= std::max(rows_, columns_)) {
+            return false;
+        }
+        const auto row = static_cast<std::ptrdiff_t>(GetRow(center.lat));
+        const auto column = static_cast<std::ptrdiff_t>(GetColumn(center.lng));
+        const auto radius = static_cast<std::ptrdiff_t>(ring);
+        for (std::ptrdiff_t r = row - radius; r <= row + radius; ++r) {
+            if (r < 0 || r >= static_cast<std::ptrdiff_t>(rows_)) {
+                continue;
+            }
+            //Внутренние строки кольца - только крайние столбцы
+            const bool edge_row = r == row - radius || r == row + radius;
+            const std::ptrdiff_t step = edge_row || radius == 0 ? 1 : 2 * radius;
+            for (std::ptrdiff_t c = column - radius; c <= column + radius; c += step) {
+                if (c >= 0 && c < static_cast<std::ptrdiff_t>(columns_)) {
+                    for (domain::StopId stop : cells_[r * columns_ + c]) {
+                        function(stop);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+   private:
+    static constexpr size_t STOPS_PER_CELL = 4;
+
+    size_t GetRow(double lat) const;
+    size_t GetColumn(double lng) const;
+
+    geo::Coordinates origin_{};  // южный и западный края сетки
+    double rows_per_degree_ = 0;
+    double columns_per_degree_ = 0;
+    size_t rows_ = 0;
+    size_t columns_ = 0;
+    domain::PagedLists<domain::StopId> cells_;  // по строкам, с юга на север и с запада на восток
+};
+
+}  // namespace transport_catalogue
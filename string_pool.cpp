@@ -0,0 +1,65 @@
+#include "string_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace transport_catalogue {
+
+StringPool::StringPool(const StringPool& other)
+    : blocks_(other.blocks_), allocated_bytes_(other.allocated_bytes_) {
+}
+
+StringPool& StringPool::operator=(const StringPool& other) {
+    if (this != &other) {
+        blocks_ = other.blocks_;
+        free_ = nullptr;
+        free_size_ = 0;
+        allocated_bytes_ = other.allocated_bytes_;
+    }
+    return *this;
+}
+
+StringPool::StringPool(StringPool&& other) noexcept
+    : blocks_(std::move(other.blocks_)),
+      free_(std::exchange(other.free_, nullptr)),
+      free_size_(std::exchange(other.free_size_, 0)),
+      allocated_bytes_(std::exchange(other.allocated_bytes_, 0)) {
+}
+
+StringPool& StringPool::operator=(StringPool&& other) noexcept {
+    if (this != &other) {
+        blocks_ = std::move(other.blocks_);
+        free_ = std::exchange(other.free_, nullptr);
+        free_size_ = std::exchange(other.free_size_, 0);
+        allocated_bytes_ = std::exchange(other.allocated_bytes_, 0);
+    }
+    return *this;
+}
+
+std::string_view StringPool::Store(std::string_view value) {
+    if (value.empty()) {
+        return {};
+    }
+    if (value.size() > free_size_) {
+        //Длинная строка получает отдельный блок, остаток текущего блока не теряется
+        const size_t size = std::max(BLOCK_SIZE, value.size());
+        std::shared_ptr<char[]> block(new char[size]);
+        char* data = block.get();
+        blocks_.push_back(std::move(block));
+        allocated_bytes_ += size;
+        if (size > BLOCK_SIZE) {
+            std::memcpy(data, value.data(), value.size());
+            return {data, value.size()};
+        }
+        free_ = data;
+        free_size_ = size;
+    }
+    std::memcpy(free_, value.data(), value.size());
+    const std::string_view stored(free_, value.size());
+    free_ += value.size();
+    free_size_ -= value.size();
+    return stored;
+}
+
+}  // namespace transport_catalogue
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace transport_catalogue {
+
+// Пул строк: возвращаемые string_view остаются действительными всё время жизни пула и его копий.
+// Строки складываются подряд в большие блоки, которые не перемещаются и не изменяются после
+// заполнения, поэтому копия пула разделяет блоки с оригиналом. Повторы пул не отслеживает:
+// владелец пула проверяет строку по своему индексу до сохранения
+class StringPool {
+   public:
+    StringPool() = default;
+    StringPool(const StringPool& other);
+    StringPool& operator=(const StringPool& other);
+    StringPool(StringPool&& other) noexcept;
+    StringPool& operator=(StringPool&& other) noexcept;
+
+    // Возвращает сохранённую в пуле копию value
+    std::string_view Store(std::string_view value);
+
+    size_t GetAllocatedBytes() const {
+        return allocated_bytes_;
+    }
+
+   private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::shared_ptr<char[]>> blocks_;
+    // Место в последнем блоке; копия пула начинает новый блок, чтобы не писать в общий
+    char* free_ = nullptr;
+    size_t free_size_ = 0;
+    size_t allocated_bytes_ = 0;
+};
+
+}  // namespace transport_catalogue
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+
+// Пул из фиксированного числа потоков с общей очередью задач.
+// Деструктор дожидается выполнения всех поставленных задач
+class ThreadPool {
+   public:
+    explicit ThreadPool(size_t thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+
+    size_t GetThreadCount() const {
+        return threads_.size();
+    }
+
+   private:
+    void Work();
+
+    std::mutex mutex_;
+    std::condition_variable has_task_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+// Вызывает function(i) для всех i из [0, count) в нескольких потоках и дожидается завершения.
+// Индексы раздаются потокам порциями, поэтому при малом count работа выполняется в вызывающем потоке.
+// Исключения должны обрабатываться внутри function
+template <typename Function>
+void ParallelFor(size_t count, Function function, size_t thread_count = std::thread::hardware_concurrency()) {
+    constexpr size_t CHUNK_SIZE = 64;
+    thread_count = std::min(std::max<size_t>(thread_count, 1), (count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t begin = next.fetch_add(CHUNK_SIZE); begin < count; begin = next.fetch_add(CHUNK_SIZE)) {
+            const size_t end = std::min(begin + CHUNK_SIZE, count);
+            for (size_t i = begin; i < end; ++i) {
+                function(i);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+}  // namespace concurrency
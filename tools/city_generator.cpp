@@ -0,0 +1,306 @@
+#include "city_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <unordered_set>
+
+namespace city_generator {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr double MIN_LAT = 55.5;
+constexpr double MAX_LAT = 56.0;
+constexpr double MIN_LNG = 37.3;
+constexpr double MAX_LNG = 37.9;
+
+// Координаты округляются до 4 знаков после точки, чтобы json::Writer выводил их без потери точности
+double RoundCoordinate(double value) {
+    return std::round(value * 1e4) / 1e4;
+}
+
+// Остановки расставлены по сетке rows x cols, индекс остановки - номер клетки по строкам
+class Grid {
+   public:
+    explicit Grid(int stop_count)
+        : stop_count_(stop_count),
+          cols_(std::max(1, static_cast<int>(std::ceil(std::sqrt(stop_count))))),
+          rows_((stop_count + cols_ - 1) / cols_) {
+    }
+
+    int GetRows() const {
+        return rows_;
+    }
+    int GetCols() const {
+        return cols_;
+    }
+
+    // Соседняя клетка на расстоянии step в направлении direction (0..3) или -1, если её нет
+    int Move(int stop, int direction, int step) const {
+        static constexpr int dr[] = {-1, 0, 1, 0};
+        static constexpr int dc[] = {0, 1, 0, -1};
+        const int row = stop / cols_ + dr[direction] * step;
+        const int col = stop % cols_ + dc[direction] * step;
+        if (row < 0 || row >= rows_ || col < 0 || col >= cols_) {
+            return -1;
+        }
+        const int next = row * cols_ + col;
+        return next < stop_count_ ? next : -1;
+    }
+
+   private:
+    int stop_count_;
+    int cols_;
+    int rows_;
+};
+
+uint64_t PairKey(int from, int to) {
+    return static_cast<uint64_t>(from) << 32 | static_cast<uint32_t>(to);
+}
+
+class DistanceBuilder {
+   public:
+    DistanceBuilder(City& city, std::mt19937& generator)
+        : city_(city), generator_(generator) {
+    }
+
+    bool Has(int from, int to) const {
+        return known_.count(PairKey(from, to)) > 0;
+    }
+
+    void Add(int from, int to) {
+        if (!known_.insert(PairKey(from, to)).second) {
+            return;
+        }
+        // Дорога длиннее расстояния по прямой на 10-40%
+        const double straight = geo::ComputeDistance(city_.stops[from].coordinates, city_.stops[to].coordinates);
+        const int meters = std::max(1, static_cast<int>(straight * std::uniform_real_distribution<double>(1.1, 1.4)(generator_)));
+        city_.stops[from].road_distances.emplace_back(to, meters);
+    }
+
+   private:
+    City& city_;
+    std::mt19937& generator_;
+    std::unordered_set<uint64_t> known_;
+};
+
+std::vector<int> MakeRoute(const Grid& grid, int length, std::mt19937& generator, int stop_count) {
+    std::uniform_int_distribution<int> any_stop(0, stop_count - 1);
+    std::uniform_int_distribution<int> any_direction(0, 3);
+    std::bernoulli_distribution turn(0.3);
+    std::uniform_int_distribution<int> step(1, 2);
+
+    std::vector<int> route{any_stop(generator)};
+    int direction = any_direction(generator);
+    while (static_cast<int>(route.size()) < length) {
+        if (turn(generator)) {
+            direction = any_direction(generator);
+        }
+        int next = -1;
+        //У края сетки маршрут разворачивается
+        for (int attempt = 0; attempt < 4 && next < 0; ++attempt) {
+            next = grid.Move(route.back(), direction, step(generator));
+            if (next < 0) {
+                direction = (direction + 1) % 4;
+            }
+        }
+        while (next < 0 || next == route.back()) {
+            next = any_stop(generator);
+        }
+        route.push_back(next);
+    }
+    return route;
+}
+
+class RequestGenerator {
+   public:
+    RequestGenerator(const City& city, const RequestSettings& settings)
+        : city_(city),
+          generator_(settings.seed),
+          type_({settings.bus_weight, settings.stop_weight, settings.map_weight}),
+          missing_(settings.missing_ratio) {
+    }
+
+    void Write(json::Writer& writer, int id) {
+        const int type = city_.stops.empty() ? 2 : type_(generator_);
+        writer.StartDict().Key("id"sv).Value(id);
+        if (type == 2) {
+            writer.Key("type"sv).Value("Map"sv);
+        } else if (type == 0) {
+            writer.Key("type"sv).Value("Bus"sv).Key("name"sv).Value(PickName(city_.buses, "Missing bus "sv));
+        } else {
+            writer.Key("type"sv).Value("Stop"sv).Key("name"sv).Value(PickName(city_.stops, "Missing stop "sv));
+        }
+        writer.EndDict();
+    }
+
+   private:
+    template <typename Items>
+    std::string PickName(const Items& items, std::string_view missing_prefix) {
+        const bool missing = missing_(generator_) || items.empty();
+        const size_t index = std::uniform_int_distribution<size_t>(0, std::max<size_t>(items.size(), 1) - 1)(generator_);
+        if (missing) {
+            return std::string(missing_prefix) + std::to_string(index);
+        }
+        return items[index].name;
+    }
+
+    const City& city_;
+    std::mt19937 generator_;
+    std::discrete_distribution<int> type_;
+    std::bernoulli_distribution missing_;
+};
+
+}  // namespace
+
+City GenerateCity(const CitySettings& settings) {
+    std::mt19937 generator(settings.seed);
+    City city;
+    const int stop_count = std::max(2, settings.stop_count);
+    const Grid grid(stop_count);
+    const double cell_lat = (MAX_LAT - MIN_LAT) / grid.GetRows();
+    const double cell_lng = (MAX_LNG - MIN_LNG) / grid.GetCols();
+    std::uniform_real_distribution<double> jitter(0.1, 0.9);
+
+    city.stops.reserve(stop_count);
+    for (int i = 0; i < stop_count; ++i) {
+        Stop stop;
+        stop.name = "Stop "s + std::to_string(i);
+        stop.coordinates.lat = RoundCoordinate(MIN_LAT + (i / grid.GetCols() + jitter(generator)) * cell_lat);
+        stop.coordinates.lng = RoundCoordinate(MIN_LNG + (i % grid.GetCols() + jitter(generator)) * cell_lng);
+        city.stops.push_back(std::move(stop));
+    }
+
+    DistanceBuilder distances(city, generator);
+    std::uniform_int_distribution<int> route_length(std::max(2, settings.min_route_length),
+                                                    std::max({2, settings.min_route_length, settings.max_route_length}));
+    std::bernoulli_distribution roundtrip(settings.roundtrip_ratio);
+    std::bernoulli_distribution both_directions(settings.distance_density);
+    std::bernoulli_distribution coin(0.5);
+
+    city.buses.reserve(settings.bus_count);
+    for (int i = 0; i < settings.bus_count; ++i) {
+        Bus bus;
+        bus.name = std::to_string(i);
+        bus.is_roundtrip = roundtrip(generator);
+        bus.stops = MakeRoute(grid, route_length(generator), generator, stop_count);
+        if (bus.is_roundtrip && bus.stops.back() != bus.stops.front()) {
+            bus.stops.push_back(bus.stops.front());
+        }
+        for (size_t j = 1; j < bus.stops.size(); ++j) {
+            const int from = bus.stops[j - 1];
+            const int to = bus.stops[j];
+            if (distances.Has(from, to) || distances.Has(to, from)) {
+                continue;
+            }
+            // Если задано только обратное расстояние, длина участка находится обратным поиском
+            if (both_directions(generator)) {
+                distances.Add(from, to);
+                distances.Add(to, from);
+            } else if (coin(generator)) {
+                distances.Add(from, to);
+            } else {
+                distances.Add(to, from);
+            }
+        }
+        city.buses.push_back(std::move(bus));
+    }
+
+    std::uniform_int_distribution<int> any_direction(0, 3);
+    for (int i = 0; i < stop_count; ++i) {
+        for (int j = 0; j < settings.extra_distances; ++j) {
+            const int neighbour = grid.Move(i, any_direction(generator), 1);
+            if (neighbour >= 0 && neighbour != i) {
+                distances.Add(i, neighbour);
+            }
+        }
+    }
+
+    city.base_order.reserve(stop_count + city.buses.size());
+    for (int i = 0; i < stop_count; ++i) {
+        city.base_order.push_back(i);
+    }
+    for (int i = 0; i < static_cast<int>(city.buses.size()); ++i) {
+        city.base_order.push_back(-(i + 1));
+    }
+    if (settings.shuffle) {
+        std::shuffle(city.base_order.begin(), city.base_order.end(), generator);
+    }
+    return city;
+}
+
+void WriteBaseRequests(const City& city, json::Writer& writer) {
+    writer.StartArray();
+    for (int index : city.base_order) {
+        if (index >= 0) {
+            const Stop& stop = city.stops[index];
+            writer.StartDict()
+                .Key("type"sv).Value("Stop"sv)
+                .Key("name"sv).Value(stop.name)
+                .Key("latitude"sv).Value(stop.coordinates.lat)
+                .Key("longitude"sv).Value(stop.coordinates.lng);
+            writer.Key("road_distances"sv).StartDict();
+            for (const auto& [to, meters] : stop.road_distances) {
+                writer.Key(city.stops[to].name).Value(meters);
+            }
+            writer.EndDict();
+            writer.EndDict();
+        } else {
+            const Bus& bus = city.buses[-index - 1];
+            writer.StartDict()
+                .Key("type"sv).Value("Bus"sv)
+                .Key("name"sv).Value(bus.name);
+            writer.Key("stops"sv).StartArray();
+            for (int stop : bus.stops) {
+                writer.Value(city.stops[stop].name);
+            }
+            writer.EndArray();
+            writer.Key("is_roundtrip"sv).Value(bus.is_roundtrip);
+            writer.EndDict();
+        }
+    }
+    writer.EndArray();
+}
+
+void WriteRenderSettings(json::Writer& writer, double size) {
+    writer.StartDict()
+        .Key("width"sv).Value(size)
+        .Key("height"sv).Value(size)
+        .Key("padding"sv).Value(50)
+        .Key("stop_radius"sv).Value(5)
+        .Key("line_width"sv).Value(14)
+        .Key("bus_label_font_size"sv).Value(20)
+        .Key("bus_label_offset"sv).StartArray().Value(7).Value(15).EndArray();
+    writer.Key("stop_label_font_size"sv).Value(20)
+        .Key("stop_label_offset"sv).StartArray().Value(7).Value(-3).EndArray();
+    writer.Key("underlayer_color"sv).StartArray().Value(255).Value(255).Value(255).Value(0.85).EndArray();
+    writer.Key("underlayer_width"sv).Value(3)
+        .Key("color_palette"sv).StartArray()
+        .Value("green"sv)
+        .StartArray().Value(255).Value(160).Value(0).EndArray()
+        .Value("red"sv)
+        .EndArray();
+    writer.EndDict();
+}
+
+void WriteStatRequests(const City& city, const RequestSettings& settings, json::Writer& writer) {
+    RequestGenerator requests(city, settings);
+    writer.StartArray();
+    for (int id = 1; id <= settings.count; ++id) {
+        requests.Write(writer, id);
+    }
+    writer.EndArray();
+}
+
+void WriteJsonLines(const City& city, const RequestSettings& settings, std::ostream& output) {
+    RequestGenerator requests(city, settings);
+    for (int id = 1; id <= settings.count; ++id) {
+        json::Writer writer(output, true);
+        requests.Write(writer, id);
+        output.put('\n');
+    }
+}
+
+}  // namespace city_generator
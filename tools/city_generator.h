@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../geo.h"
+#include "../json_writer.h"
+
+/*
+ * Генератор синтетических городов для экспериментов с масштабом.
+ * Остановки расставлены по сетке со случайным смещением, маршруты идут по соседним клеткам,
+ * поэтому форма маршрутов и расстояния похожи на настоящие. Результат детерминирован по seed.
+ *
+ * Генератор проходит все ветви загрузки справочника: расстояния между остановками заданы
+ * в одну сторону (обратное берётся при расчёте длины маршрута) или в обе, запросы base_requests
+ * перемешаны, так что маршруты и road_distances ссылаются на остановки, описанные позже
+ */
+namespace city_generator {
+
+struct CitySettings {
+    uint32_t seed = 42;
+    int stop_count = 1000;
+    int bus_count = 100;
+    // Число остановок маршрута выбирается равномерно из [min_route_length, max_route_length]
+    int min_route_length = 5;
+    int max_route_length = 30;
+    double roundtrip_ratio = 0.5;
+    // Доля участков маршрутов, для которых расстояние задано в обе стороны, остальные задаются в одну
+    double distance_density = 0.5;
+    // Дополнительные расстояния до соседних остановок, не связанных маршрутом, на каждую остановку
+    int extra_distances = 0;
+    // Перемешать запросы base_requests, иначе сначала идут все остановки, затем маршруты
+    bool shuffle = true;
+};
+
+struct RequestSettings {
+    uint32_t seed = 42;
+    int count = 1000;
+    // Относительные веса типов запросов
+    double bus_weight = 0.48;
+    double stop_weight = 0.48;
+    double map_weight = 0.04;
+    // Доля запросов Bus и Stop к несуществующим названиям
+    double missing_ratio = 0.05;
+};
+
+struct Stop {
+    std::string name;
+    geo::Coordinates coordinates;
+    std::vector<std::pair<int, int>> road_distances;  // индекс остановки и расстояние в метрах
+};
+
+struct Bus {
+    std::string name;
+    std::vector<int> stops;  // для кольцевого маршрута последняя остановка совпадает с первой
+    bool is_roundtrip;
+};
+
+struct City {
+    std::vector<Stop> stops;
+    std::vector<Bus> buses;
+    // Порядок запросов base_requests: неотрицательные значения - индексы остановок,
+    // отрицательные -(индекс маршрута + 1)
+    std::vector<int> base_order;
+};
+
+City GenerateCity(const CitySettings& settings);
+
+// Массив base_requests
+void WriteBaseRequests(const City& city, json::Writer& writer);
+// Словарь render_settings для карты размером size x size
+void WriteRenderSettings(json::Writer& writer, double size = 1200);
+// Массив stat_requests
+void WriteStatRequests(const City& city, const RequestSettings& settings, json::Writer& writer);
+// Запросы по одному в строке для режима serve
+void WriteJsonLines(const City& city, const RequestSettings& settings, std::ostream& output);
+
+}  // namespace city_generator
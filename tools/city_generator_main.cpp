@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "city_generator.h"
+
+using namespace std::literals;
+
+namespace {
+
+void PrintUsage() {
+    std::cerr << "Usage: city_generator [--format document|base|requests|jsonl] [--seed N] [--stops N] [--buses N]\n"
+                 "                      [--route-length MIN[:MAX]] [--roundtrip-ratio P] [--distance-density P]\n"
+                 "                      [--extra-distances N] [--ordered] [--requests N] [--mix BUS:STOP:MAP]\n"
+                 "                      [--missing-ratio P] [--base-file PATH] [--compact]\n";
+}
+
+// Разбирает "A:B" или "A:B:C" в числа через двоеточие
+template <typename Value, typename Convert>
+bool ParseList(std::string_view text, Value* values, size_t count, Convert convert) {
+    for (size_t i = 0; i < count; ++i) {
+        const size_t colon = text.find(':');
+        if ((colon == std::string_view::npos) != (i + 1 == count)) {
+            return false;
+        }
+        values[i] = convert(std::string(text.substr(0, colon)));
+        text.remove_prefix(colon == std::string_view::npos ? text.size() : colon + 1);
+    }
+    return true;
+}
+
+}  // namespace
+
+// Генерирует синтетический город.
+// document - base_requests, render_settings и stat_requests в одном документе,
+// base - документ для make_base и serve, requests - документ для process_requests,
+// jsonl - запросы по одному в строке для serve и transport_catalogue_server.
+// --base-file задаёт serialization_settings.file для форматов base, requests и document
+int main(int argc, char* argv[]) {
+    city_generator::CitySettings city_settings;
+    city_generator::RequestSettings request_settings;
+    std::string_view format = "document"sv;
+    std::optional<std::string> base_file;
+    bool compact = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view option = argv[i];
+        if (option == "--ordered"sv) {
+            city_settings.shuffle = false;
+            continue;
+        }
+        if (option == "--compact"sv) {
+            compact = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        const std::string value = argv[++i];
+        if (option == "--format"sv && (value == "document"sv || value == "base"sv || value == "requests"sv || value == "jsonl"sv)) {
+            format = argv[i];
+        } else if (option == "--seed"sv) {
+            city_settings.seed = static_cast<uint32_t>(std::stoul(value));
+            request_settings.seed = city_settings.seed + 1;
+        } else if (option == "--stops"sv) {
+            city_settings.stop_count = std::stoi(value);
+        } else if (option == "--buses"sv) {
+            city_settings.bus_count = std::max(0, std::stoi(value));
+        } else if (option == "--route-length"sv) {
+            if (value.find(':') == std::string::npos) {
+                city_settings.min_route_length = city_settings.max_route_length = std::stoi(value);
+            } else {
+                int bounds[2];
+                if (!ParseList(value, bounds, 2, [](const std::string& s) { return std::stoi(s); })) {
+                    PrintUsage();
+                    return 1;
+                }
+                city_settings.min_route_length = bounds[0];
+                city_settings.max_route_length = bounds[1];
+            }
+        } else if (option == "--roundtrip-ratio"sv) {
+            city_settings.roundtrip_ratio = std::stod(value);
+        } else if (option == "--distance-density"sv) {
+            city_settings.distance_density = std::stod(value);
+        } else if (option == "--extra-distances"sv) {
+            city_settings.extra_distances = std::max(0, std::stoi(value));
+        } else if (option == "--requests"sv) {
+            request_settings.count = std::max(0, std::stoi(value));
+        } else if (option == "--mix"sv) {
+            double weights[3];
+            if (!ParseList(value, weights, 3, [](const std::string& s) { return std::stod(s); })) {
+                PrintUsage();
+                return 1;
+            }
+            request_settings.bus_weight = weights[0];
+            request_settings.stop_weight = weights[1];
+            request_settings.map_weight = weights[2];
+        } else if (option == "--missing-ratio"sv) {
+            request_settings.missing_ratio = std::stod(value);
+        } else if (option == "--base-file"sv) {
+            base_file = value;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::ios::sync_with_stdio(false);
+    const city_generator::City city = city_generator::GenerateCity(city_settings);
+    if (format == "jsonl"sv) {
+        city_generator::WriteJsonLines(city, request_settings, std::cout);
+        return 0;
+    }
+
+    json::Writer writer(std::cout, compact);
+    writer.StartDict();
+    if (base_file) {
+        writer.Key("serialization_settings"sv).StartDict().Key("file"sv).Value(*base_file).EndDict();
+    }
+    if (format != "requests"sv) {
+        writer.Key("base_requests"sv);
+        city_generator::WriteBaseRequests(city, writer);
+        writer.Key("render_settings"sv);
+        city_generator::WriteRenderSettings(writer);
+    }
+    if (format != "base"sv) {
+        writer.Key("stat_requests"sv);
+        city_generator::WriteStatRequests(city, request_settings, writer);
+    }
+    writer.EndDict();
+    std::cout << '\n';
+    return 0;
+}
@@ -1,105 +1,632 @@
 #include "transport_catalogue.h"
 
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "thread_pool.h"
+
 namespace transport_catalogue {
-void TransportCatalogue::AddStop(const std::string& name, geo::Coordinates coordinates) {
-    domain::Stop stop = {name, coordinates};
-    stops_.push_back(stop);
-    names_stops_[name] = &stops_[stops_.size() - 1];
+namespace {
+std::vector<domain::StopId> SortedUnique(domain::Span<domain::StopId> stops) {
+    std::vector<domain::StopId> result(stops.begin(), stops.end());
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+template <typename T>
+size_t GetAllocatedBytes(const std::vector<T>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+//Столбцы, списки и индексы сами считают свои страницы
+template <typename Container>
+size_t GetAllocatedBytes(const Container& container) {
+    return container.GetMemoryUsage();
+}
+}  // namespace
+
+//Повторно добавляемое название берётся из индекса, новое сохраняется в пул
+std::string_view TransportCatalogue::InternName(const domain::ShardedMap<std::string_view, uint32_t>& index,
+                                                const domain::PagedVector<std::string_view>& names, std::string_view name) {
+    if (const uint32_t* id = index.Find(name)) {
+        return names[*id];
+    }
+    return names_.Store(name);
 }
 
-void TransportCatalogue::AddBus(const std::string& name, const std::vector<std::string>& names_stops, domain::TypeRoute type) {
-    domain::Bus bus;
-    bus.name = name;
-    for (std::string name : names_stops) {
-        bus.route.push_back(names_stops_[name]);
+domain::StopId TransportCatalogue::AddStop(std::string_view name, geo::Coordinates coordinates) {
+    const auto id = static_cast<domain::StopId>(stop_names_.size());
+    name = InternName(stop_ids_, stop_names_, name);
+    stop_names_.push_back(name);
+    stop_latitudes_.push_back(coordinates.lat);
+    stop_longitudes_.push_back(coordinates.lng);
+    stop_points_.push_back(geo::ToUnitVector(coordinates));
+    stop_removed_.push_back(false);
+    const domain::StopId* previous = stop_ids_.Find(name);
+    if (finalized_ && previous != nullptr) {
+        stop_index_.Erase(*previous, GetStopCoordinates(*previous));
     }
-    bus.type = type;
-    buses_.push_back(bus);
-    names_buses_[name] = &buses_[buses_.size() - 1];
-    for (std::string name : names_stops) {
-        stop_to_buses_[names_stops_.at(name)].push_back(&buses_[buses_.size() - 1]);
+    stop_ids_.Set(name, id);
+    ++network_revision_;
+    if (finalized_) {
+        stop_index_.Insert(id, coordinates);
+        const domain::Span<RoadEdge> no_edges;
+        road_graph_.Append(no_edges.begin(), no_edges.end());
+        const domain::Span<domain::BusId> no_buses;
+        stop_buses_.Append(no_buses.begin(), no_buses.end());
+    } else {
+        stop_to_buses_.emplace_back();
     }
+    return id;
 }
 
-int TransportCatalogue::GetCountStopsOnRouts(const domain::Bus* bus) const {
-    if (bus->type == domain::TypeRoute::linear) {
-        return bus->route.size() * 2 - 1;
+domain::BusId TransportCatalogue::AddBus(std::string_view name, const std::vector<std::string_view>& names_stops, domain::TypeRoute type) {
+    std::vector<domain::StopId> stops;
+    stops.reserve(names_stops.size());
+    for (std::string_view stop_name : names_stops) {
+        const domain::StopId* stop = stop_ids_.Find(stop_name);
+        if (stop == nullptr) {
+            throw std::out_of_range("Unknown stop");
+        }
+        stops.push_back(*stop);
     }
-    return bus->route.size();
+    return AddBus(name, stops, type);
 }
 
-void TransportCatalogue::AddDistanceToStops(const domain::Stop* first_stop, const domain::Stop* second_stop, int distance) {
-    distance_to_stops_[std::pair(first_stop, second_stop)] = distance;
+domain::BusId TransportCatalogue::AddBus(std::string_view name, domain::Span<domain::StopId> stops, domain::TypeRoute type) {
+    const auto id = static_cast<domain::BusId>(bus_names_.size());
+    name = InternName(bus_ids_, bus_names_, name);
+    bus_names_.push_back(name);
+    bus_types_.push_back(type);
+    routes_.Append(stops.begin(), stops.end());
+    bus_removed_.push_back(false);
+    bus_ids_.Set(name, id);
+    ++network_revision_;
+    if (!finalized_) {
+        for (domain::StopId stop : stops) {
+            stop_to_buses_[stop].push_back(id);
+        }
+        return id;
+    }
+    bus_stats_.push_back({});
+    bus_stat_ready_.push_back(false);
+    AttachBus(id, SortedUnique(routes_[id]));
+    UpdateBusStat(id);
+    return id;
 }
 
-const domain::Bus* TransportCatalogue::GetBus(const std::string& name) const {
-    if (names_buses_.count(name))
-        return names_buses_.at(name);
-    else
-        return nullptr;
+void TransportCatalogue::Reserve(size_t stop_count, size_t bus_count, size_t route_stop_count) {
+    stop_names_.reserve(stop_count);
+    stop_latitudes_.reserve(stop_count);
+    stop_longitudes_.reserve(stop_count);
+    stop_points_.reserve(stop_count);
+    stop_removed_.reserve(stop_count);
+    if (!finalized_) {
+        stop_to_buses_.reserve(stop_count);
+    }
+    stop_ids_.Reserve(stop_count);
+    bus_names_.reserve(bus_count);
+    bus_types_.reserve(bus_count);
+    bus_removed_.reserve(bus_count);
+    bus_ids_.Reserve(bus_count);
+    routes_.Reserve(bus_count, route_stop_count);
+}
+
+int TransportCatalogue::GetCountStopsOnRouts(domain::BusId bus) const {
+    const size_t size = routes_[bus].size();
+    if (bus_types_[bus] == domain::TypeRoute::linear) {
+        return size * 2 - 1;
+    }
+    return size;
 }
 
-const domain::Stop* TransportCatalogue::GetStop(const std::string& name) const {
-    if (names_stops_.count(name))
-        return names_stops_.at(name);
-    return nullptr;
+void TransportCatalogue::AddDistanceToStops(domain::StopId first_stop, domain::StopId second_stop, int distance) {
+    if (finalized_) {
+        SetDistance(first_stop, second_stop, distance);
+    } else {
+        distances_.push_back({first_stop, second_stop, distance});
+    }
 }
 
-std::set<std::string> TransportCatalogue::GetBusesContainingStop(const domain::Stop* stop) const {
-    std::set<std::string> result;
-    if (stop_to_buses_.count(stop) > 0) {
-        for (const domain::Bus* bus : stop_to_buses_.at(stop)) {
-            result.insert(bus->name);
-        }
+std::optional<domain::StopId> TransportCatalogue::FindStop(std::string_view name) const {
+    const domain::StopId* stop = stop_ids_.Find(name);
+    if (stop == nullptr) {
+        return std::nullopt;
     }
-    return result;
+    return *stop;
+}
+
+std::optional<domain::BusId> TransportCatalogue::FindBus(std::string_view name) const {
+    const domain::BusId* bus = bus_ids_.Find(name);
+    if (bus == nullptr) {
+        return std::nullopt;
+    }
+    return *bus;
 }
 
-int TransportCatalogue::GetRealLengthRoute(const domain::Stop* from, const domain::Stop* to) const {
-    if (distance_to_stops_.count(std::pair(from, to)) == 0) {
-        return distance_to_stops_.at(std::pair(to, from));
+const TransportCatalogue::RoadEdge* TransportCatalogue::FindRoadEdge(domain::StopId from, domain::StopId to) const {
+    if (from >= road_graph_.size()) {
+        return nullptr;
+    }
+    const domain::Span<RoadEdge> edges = road_graph_[from];
+    const RoadEdge* edge = std::lower_bound(edges.begin(), edges.end(), to, [](const RoadEdge& edge, domain::StopId stop) {
+        return edge.to < stop;
+    });
+    return edge != edges.end() && edge->to == to ? edge : nullptr;
+}
+
+int TransportCatalogue::GetRealLengthRoute(domain::StopId from, domain::StopId to) const {
+    const RoadEdge* edge = FindRoadEdge(from, to);
+    if (edge == nullptr) {
+        throw std::out_of_range("Road distance is not set");
     }
-    return distance_to_stops_.at(std::pair(from, to));
+    return edge->distance;
 }
 
-int TransportCatalogue::GetLengthRoute(const domain::Bus* bus) const {
+int TransportCatalogue::GetLengthRoute(domain::BusId bus) const {
+    const domain::Span<domain::StopId> route = routes_[bus];
     int length = 0;
-    for (size_t i = 0; i < bus->route.size() - 1; ++i) {
-        length += GetRealLengthRoute(bus->route[i], bus->route[i + 1]);
+    for (size_t i = 0; i + 1 < route.size(); ++i) {
+        length += GetRealLengthRoute(route[i], route[i + 1]);
     }
-    if (bus->type == domain::TypeRoute::linear) {
-        for (size_t i = bus->route.size(); i > 1; --i) {
-            length += GetRealLengthRoute(bus->route[i - 1], bus->route[i - 2]);
+    if (bus_types_[bus] == domain::TypeRoute::linear) {
+        for (size_t i = route.size(); i > 1; --i) {
+            length += GetRealLengthRoute(route[i - 1], route[i - 2]);
         }
     }
     return length;
 }
 
-double TransportCatalogue::GetCurvature(const domain::Bus* bus, int real_distance) const {
-    double length = 0;
-    for (size_t i = 0; i < bus->route.size() - 1; ++i) {
-        length += geo::ComputeDistance(bus->route[i]->coord, bus->route[i + 1]->coord);
+double TransportCatalogue::GetCurvature(domain::BusId bus, int real_distance) const {
+    const domain::Span<domain::StopId> route = routes_[bus];
+    //Координаты остановок лежат на разных страницах, поэтому точки маршрута сначала собираются подряд
+    thread_local std::vector<geo::UnitVector> points;
+    points.clear();
+    for (domain::StopId stop : route) {
+        points.push_back(stop_points_[stop]);
     }
-    if (bus->type == domain::TypeRoute::linear) {
+    double length = geo::ComputePathLength(points.data(), points.size());
+    if (bus_types_[bus] == domain::TypeRoute::linear) {
         length *= 2;
     }
     return real_distance / length;
 }
 
-std::vector<const domain::Bus*> TransportCatalogue::GetBuses() const {
-    std::vector<const domain::Bus*> result;
-    for (const domain::Bus& bus : buses_) {
-        result.push_back(&bus);
+domain::BusStat TransportCatalogue::ComputeBusStat(domain::BusId bus) const {
+    domain::BusStat bus_stat;
+    bus_stat.stop_count = GetCountStopsOnRouts(bus);
+    const domain::Span<domain::StopId> route = routes_[bus];
+    std::vector<domain::StopId> unique_stops(route.begin(), route.end());
+    std::sort(unique_stops.begin(), unique_stops.end());
+    bus_stat.unique_stop_count = std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin();
+    bus_stat.route_length = GetLengthRoute(bus);
+    bus_stat.curvature = GetCurvature(bus, bus_stat.route_length);
+    return bus_stat;
+}
+
+void TransportCatalogue::BuildRoadGraph() {
+    auto by_stops = [](const domain::StopsDistance& lhs, const domain::StopsDistance& rhs) {
+        return std::pair(lhs.from, lhs.to) < std::pair(rhs.from, rhs.to);
+    };
+    auto same_stops = [](const domain::StopsDistance& lhs, const domain::StopsDistance& rhs) {
+        return lhs.from == rhs.from && lhs.to == rhs.to;
+    };
+    //Из повторов остаётся последнее заданное расстояние
+    std::stable_sort(distances_.begin(), distances_.end(), by_stops);
+    std::vector<domain::StopsDistance> unique;
+    unique.reserve(distances_.size());
+    for (size_t i = 0; i < distances_.size(); ++i) {
+        if (i + 1 == distances_.size() || !same_stops(distances_[i], distances_[i + 1])) {
+            unique.push_back(distances_[i]);
+        }
+    }
+    distances_ = std::move(unique);
+
+    //Обратные рёбра для расстояний, заданных в одну сторону
+    struct GraphEdge {
+        domain::StopId from;
+        RoadEdge edge;
+    };
+    std::vector<GraphEdge> edges;
+    edges.reserve(distances_.size() * 2);
+    for (const domain::StopsDistance& distance : distances_) {
+        edges.push_back({distance.from, {distance.to, distance.distance, true}});
+    }
+    for (const domain::StopsDistance& distance : distances_) {
+        const domain::StopsDistance reverse{distance.to, distance.from, distance.distance};
+        if (!std::binary_search(distances_.begin(), distances_.end(), reverse, by_stops)) {
+            edges.push_back({reverse.from, {reverse.to, reverse.distance, false}});
+        }
+    }
+    std::sort(edges.begin(), edges.end(), [](const GraphEdge& lhs, const GraphEdge& rhs) {
+        return std::pair(lhs.from, lhs.edge.to) < std::pair(rhs.from, rhs.edge.to);
+    });
+
+    road_graph_ = {};
+    road_graph_.Reserve(stop_names_.size(), edges.size());
+    std::vector<RoadEdge> stop_edges;
+    auto edge = edges.begin();
+    for (domain::StopId stop = 0; stop < stop_names_.size(); ++stop) {
+        stop_edges.clear();
+        for (; edge != edges.end() && edge->from == stop; ++edge) {
+            stop_edges.push_back(edge->edge);
+        }
+        road_graph_.Append(stop_edges.begin(), stop_edges.end());
+    }
+    distances_ = {};
+}
+
+void TransportCatalogue::BuildStopBuses() {
+    //Место маршрута в порядке названий; у маршрутов с одинаковым названием оно общее
+    std::vector<domain::BusId> by_name(bus_names_.size());
+    for (size_t i = 0; i < by_name.size(); ++i) {
+        by_name[i] = static_cast<domain::BusId>(i);
+    }
+    std::sort(by_name.begin(), by_name.end(), [this](domain::BusId lhs, domain::BusId rhs) {
+        return bus_names_[lhs] < bus_names_[rhs];
+    });
+    std::vector<uint32_t> rank(bus_names_.size());
+    for (size_t i = 0; i < by_name.size(); ++i) {
+        rank[by_name[i]] = i > 0 && bus_names_[by_name[i]] == bus_names_[by_name[i - 1]] ? rank[by_name[i - 1]] : i;
+    }
+
+    stop_buses_ = {};
+    stop_buses_.Reserve(stop_to_buses_.size(), routes_.GetItemCount());
+    std::vector<domain::BusId> buses;
+    for (const std::vector<domain::BusId>& stop_buses : stop_to_buses_) {
+        buses = stop_buses;
+        std::sort(buses.begin(), buses.end(), [&rank](domain::BusId lhs, domain::BusId rhs) {
+            return rank[lhs] < rank[rhs];
+        });
+        buses.erase(std::unique(buses.begin(), buses.end(), [&rank](domain::BusId lhs, domain::BusId rhs) {
+                        return rank[lhs] == rank[rhs];
+                    }),
+                    buses.end());
+        stop_buses_.Append(buses.begin(), buses.end());
+    }
+    stop_to_buses_ = {};
+}
+
+void TransportCatalogue::Finalize() {
+    if (finalized_) {
+        return;
+    }
+    BuildRoadGraph();
+    BuildStopBuses();
+    BuildStopIndex();
+    //Страницы только что созданы и ни с кем не разделены, поэтому потоки пишут в них без копирования
+    bus_stats_.assign(bus_names_.size(), {});
+    bus_stat_ready_.assign(bus_names_.size(), false);
+    concurrency::ParallelFor(bus_names_.size(), [&](size_t bus) {
+        try {
+            bus_stats_.Write(bus) = ComputeBusStat(static_cast<domain::BusId>(bus));
+            bus_stat_ready_.Write(bus) = true;
+        } catch (const std::out_of_range&) {
+        }
+    });
+    finalized_ = true;
+}
+
+void TransportCatalogue::SetRoadEdge(domain::StopId from, RoadEdge edge) {
+    const domain::Span<RoadEdge> current = road_graph_[from];
+    std::vector<RoadEdge> edges(current.begin(), current.end());
+    const auto it = std::lower_bound(edges.begin(), edges.end(), edge.to, [](const RoadEdge& edge, domain::StopId stop) {
+        return edge.to < stop;
+    });
+    if (it != edges.end() && it->to == edge.to) {
+        *it = edge;
+    } else {
+        edges.insert(it, edge);
+    }
+    road_graph_.Replace(from, edges.begin(), edges.end());
+}
+
+void TransportCatalogue::EraseRoadEdge(domain::StopId from, domain::StopId to) {
+    const domain::Span<RoadEdge> current = road_graph_[from];
+    std::vector<RoadEdge> edges;
+    edges.reserve(current.size());
+    std::copy_if(current.begin(), current.end(), std::back_inserter(edges), [to](const RoadEdge& edge) {
+        return edge.to != to;
+    });
+    if (edges.size() != current.size()) {
+        road_graph_.Replace(from, edges.begin(), edges.end());
+    }
+}
+
+//Заданное расстояние заменяет достроенное обратное ребро, но не заданное в обратную сторону
+void TransportCatalogue::SetDistance(domain::StopId from, domain::StopId to, int distance) {
+    SetRoadEdge(from, {to, distance, true});
+    const RoadEdge* reverse = FindRoadEdge(to, from);
+    if (reverse == nullptr || !reverse->is_explicit) {
+        SetRoadEdge(to, {from, distance, false});
+    }
+    UpdateBusStats(from, to);
+    ++road_revision_;
+}
+
+void TransportCatalogue::RemoveDistance(domain::StopId from, domain::StopId to) {
+    Finalize();
+    const RoadEdge* edge = FindRoadEdge(from, to);
+    if (edge == nullptr || !edge->is_explicit) {
+        return;
+    }
+    const RoadEdge* reverse = from == to ? nullptr : FindRoadEdge(to, from);
+    if (reverse != nullptr && reverse->is_explicit) {
+        SetRoadEdge(from, {to, reverse->distance, false});
+    } else {
+        EraseRoadEdge(from, to);
+        EraseRoadEdge(to, from);
+    }
+    UpdateBusStats(from, to);
+    ++road_revision_;
+}
+
+void TransportCatalogue::AttachBus(domain::BusId bus, const std::vector<domain::StopId>& stops) {
+    const std::string_view name = bus_names_[bus];
+    std::vector<domain::BusId> buses;
+    for (domain::StopId stop : stops) {
+        const domain::Span<domain::BusId> current = stop_buses_[stop];
+        const domain::BusId* it = std::lower_bound(current.begin(), current.end(), name, [this](domain::BusId bus, std::string_view name) {
+            return bus_names_[bus] < name;
+        });
+        //Маршрут с таким же названием в списке уже есть
+        if (it != current.end() && bus_names_[*it] == name) {
+            continue;
+        }
+        buses.assign(current.begin(), it);
+        buses.push_back(bus);
+        buses.insert(buses.end(), it, current.end());
+        stop_buses_.Replace(stop, buses.begin(), buses.end());
+    }
+}
+
+void TransportCatalogue::DetachBus(domain::BusId bus, const std::vector<domain::StopId>& stops) {
+    std::vector<domain::BusId> buses;
+    for (domain::StopId stop : stops) {
+        const domain::Span<domain::BusId> current = stop_buses_[stop];
+        const domain::BusId* it = std::find(current.begin(), current.end(), bus);
+        if (it == current.end()) {
+            continue;
+        }
+        buses.assign(current.begin(), it);
+        buses.insert(buses.end(), it + 1, current.end());
+        stop_buses_.Replace(stop, buses.begin(), buses.end());
+    }
+}
+
+void TransportCatalogue::UpdateBusStat(domain::BusId bus) {
+    try {
+        bus_stats_.Write(bus) = ComputeBusStat(bus);
+        bus_stat_ready_.Write(bus) = true;
+    } catch (const std::out_of_range&) {
+        bus_stat_ready_.Write(bus) = false;
+    }
+}
+
+void TransportCatalogue::UpdateBusStats(domain::StopId stop, std::optional<domain::StopId> next) {
+    for (domain::BusId bus : stop_buses_[stop]) {
+        const domain::Span<domain::StopId> route = routes_[bus];
+        if (!next || std::find(route.begin(), route.end(), *next) != route.end()) {
+            UpdateBusStat(bus);
+        }
+    }
+}
+
+void TransportCatalogue::SetStopCoordinates(domain::StopId stop, geo::Coordinates coordinates) {
+    Finalize();
+    if (IsStopVisible(stop)) {
+        stop_index_.Erase(stop, GetStopCoordinates(stop));
+        stop_index_.Insert(stop, coordinates);
+    }
+    stop_latitudes_.Write(stop) = coordinates.lat;
+    stop_longitudes_.Write(stop) = coordinates.lng;
+    stop_points_.Write(stop) = geo::ToUnitVector(coordinates);
+    ++network_revision_;
+    UpdateBusStats(stop);
+}
+
+void TransportCatalogue::RemoveStop(domain::StopId stop) {
+    Finalize();
+    if (stop_removed_[stop]) {
+        return;
+    }
+    if (!stop_buses_[stop].empty()) {
+        throw std::invalid_argument("Stop is used by a bus");
+    }
+    std::vector<domain::StopId> neighbours;
+    for (const RoadEdge& edge : road_graph_[stop]) {
+        neighbours.push_back(edge.to);
+    }
+    for (domain::StopId neighbour : neighbours) {
+        EraseRoadEdge(neighbour, stop);
+    }
+    const domain::Span<RoadEdge> no_edges;
+    road_graph_.Replace(stop, no_edges.begin(), no_edges.end());
+    if (IsStopVisible(stop)) {
+        stop_index_.Erase(stop, GetStopCoordinates(stop));
+        stop_ids_.Erase(stop_names_[stop]);
+    }
+    stop_removed_.Write(stop) = true;
+    ++network_revision_;
+}
+
+void TransportCatalogue::SetRoute(domain::BusId bus, domain::Span<domain::StopId> stops, domain::TypeRoute type) {
+    Finalize();
+    if (bus_removed_[bus]) {
+        throw std::invalid_argument("Bus is removed");
+    }
+    //Маршрут снимается только с остановок, которых в нём больше нет, и добавляется только на новые
+    const std::vector<domain::StopId> route(stops.begin(), stops.end());
+    const std::vector<domain::StopId> old_stops = SortedUnique(routes_[bus]);
+    const std::vector<domain::StopId> new_stops = SortedUnique(route);
+    std::vector<domain::StopId> removed;
+    std::set_difference(old_stops.begin(), old_stops.end(), new_stops.begin(), new_stops.end(), std::back_inserter(removed));
+    std::vector<domain::StopId> added;
+    std::set_difference(new_stops.begin(), new_stops.end(), old_stops.begin(), old_stops.end(), std::back_inserter(added));
+
+    DetachBus(bus, removed);
+    routes_.Replace(bus, route.begin(), route.end());
+    bus_types_.Write(bus) = type;
+    AttachBus(bus, added);
+    UpdateBusStat(bus);
+    ++network_revision_;
+}
+
+void TransportCatalogue::RemoveBus(domain::BusId bus) {
+    Finalize();
+    if (bus_removed_[bus]) {
+        return;
+    }
+    DetachBus(bus, SortedUnique(routes_[bus]));
+    const domain::Span<domain::StopId> no_stops;
+    routes_.Replace(bus, no_stops.begin(), no_stops.end());
+    if (const domain::BusId* item = bus_ids_.Find(bus_names_[bus]); item != nullptr && *item == bus) {
+        bus_ids_.Erase(bus_names_[bus]);
+    }
+    bus_removed_.Write(bus) = true;
+    bus_stat_ready_.Write(bus) = false;
+    ++network_revision_;
+}
+
+std::vector<domain::StopsDistance> TransportCatalogue::GetDistances() const {
+    if (!finalized_) {
+        return distances_;
+    }
+    std::vector<domain::StopsDistance> result;
+    for (domain::StopId stop = 0; stop < road_graph_.size(); ++stop) {
+        for (const RoadEdge& edge : road_graph_[stop]) {
+            if (edge.is_explicit) {
+                result.push_back({stop, edge.to, edge.distance});
+            }
+        }
+    }
+    return result;
+}
+
+size_t TransportCatalogue::GetMemoryUsage() const {
+    size_t result = names_.GetAllocatedBytes();
+    result += GetAllocatedBytes(stop_names_) + GetAllocatedBytes(stop_latitudes_) + GetAllocatedBytes(stop_longitudes_) +
+              GetAllocatedBytes(stop_points_) + GetAllocatedBytes(stop_ids_) + GetAllocatedBytes(stop_index_) +
+              GetAllocatedBytes(stop_removed_) + GetAllocatedBytes(stop_buses_) + GetAllocatedBytes(road_graph_);
+    result += GetAllocatedBytes(bus_names_) + GetAllocatedBytes(bus_types_) + GetAllocatedBytes(routes_) + GetAllocatedBytes(bus_ids_) +
+              GetAllocatedBytes(bus_removed_) + GetAllocatedBytes(bus_stats_) + GetAllocatedBytes(bus_stat_ready_);
+    result += GetAllocatedBytes(distances_);
+    for (const std::vector<domain::BusId>& buses : stop_to_buses_) {
+        result += sizeof(buses) + GetAllocatedBytes(buses);
+    }
+    return result;
+}
+
+//Остановка с названием, которое потом получила другая остановка, в индекс не попадает
+void TransportCatalogue::BuildStopIndex() {
+    std::vector<char> hidden(stop_names_.size(), true);
+    stop_ids_.ForEach([&hidden](std::string_view, domain::StopId stop) {
+        hidden[stop] = false;
+    });
+    stop_index_.Build(stop_latitudes_, stop_longitudes_, hidden);
+}
+
+bool TransportCatalogue::IsStopVisible(domain::StopId stop) const {
+    const domain::StopId* item = stop_ids_.Find(stop_names_[stop]);
+    return item != nullptr && *item == stop;
+}
+
+template <typename Function>
+void TransportCatalogue::ForEachStopInBox(geo::Box box, Function function) const {
+    auto visit = [&](geo::Box part) {
+        stop_index_.ForEachInBox(part, [&](domain::StopId stop) {
+            const geo::Coordinates coordinates = GetStopCoordinates(stop);
+            if (coordinates.lat >= part.min.lat && coordinates.lat <= part.max.lat && coordinates.lng >= part.min.lng &&
+                coordinates.lng <= part.max.lng) {
+                function(stop);
+            }
+        });
+    };
+    if (box.min.lng <= box.max.lng) {
+        visit(box);
+    } else {
+        visit({box.min, {box.max.lat, 180}});
+        visit({{box.min.lat, -180}, box.max});
+    }
+}
+
+std::vector<domain::StopId> TransportCatalogue::FindStopsInBox(geo::Box box) const {
+    std::vector<domain::StopId> result;
+    ForEachStopInBox(box, [&result](domain::StopId stop) {
+        result.push_back(stop);
+    });
+    std::sort(result.begin(), result.end(), [this](domain::StopId lhs, domain::StopId rhs) {
+        return stop_names_[lhs] < stop_names_[rhs];
+    });
+    return result;
+}
+
+std::vector<domain::NearbyStop> TransportCatalogue::FindStopsInRadius(geo::Coordinates center, double radius) const {
+    std::vector<domain::NearbyStop> result;
+    if (!(radius >= 0)) {
+        return result;
+    }
+    const geo::UnitVector point = geo::ToUnitVector(center);
+    ForEachStopInBox(geo::GetBoundingBox(center, radius), [&](domain::StopId stop) {
+        const double distance = geo::ComputeDistance(point, stop_points_[stop]);
+        if (distance <= radius) {
+            result.push_back({stop, distance});
+        }
+    });
+    std::sort(result.begin(), result.end(), [this](const domain::NearbyStop& lhs, const domain::NearbyStop& rhs) {
+        return std::pair(lhs.distance, stop_names_[lhs.stop]) < std::pair(rhs.distance, stop_names_[rhs.stop]);
+    });
+    return result;
+}
+
+//Кольца ячеек вокруг точки перебираются, пока не наберётся count остановок. Расстояние до самой дальней
+//из count ближайших среди них ограничивает ответ сверху, и остановки в этом радиусе ищутся запросом по кругу
+std::vector<domain::NearbyStop> TransportCatalogue::FindNearestStops(geo::Coordinates center, size_t count) const {
+    if (count == 0) {
+        return {};
+    }
+    const geo::UnitVector point = geo::ToUnitVector(center);
+    std::vector<double> distances;
+    auto add = [&](domain::StopId stop) {
+        distances.push_back(geo::ComputeDistance(point, stop_points_[stop]));
+    };
+    for (size_t ring = 0; distances.size() < count && stop_index_.ForEachInRing(center, ring, add); ++ring) {
+    }
+    if (distances.empty()) {
+        return {};
     }
+    const auto bound = distances.begin() + std::min(count, distances.size()) - 1;
+    std::nth_element(distances.begin(), bound, distances.end());
+    std::vector<domain::NearbyStop> result = FindStopsInRadius(center, *bound);
+    result.resize(std::min(count, result.size()));
     return result;
 }
 
-std::map<std::string, const domain::Stop*> TransportCatalogue::GetStopsContainingAnyBus() const {
-    std::map<std::string, const domain::Stop*> result;
-    for (const auto& [name, stop] : names_stops_) {
-        if (!GetBusesContainingStop(stop).empty())
-            result.insert({name, stop});
+std::vector<domain::BusId> TransportCatalogue::GetBusesContainingAnyStop(const std::vector<domain::StopId>& stops) const {
+    std::vector<domain::BusId> result;
+    for (domain::StopId stop : stops) {
+        const domain::Span<domain::BusId> buses = GetBusesContainingStop(stop);
+        result.insert(result.end(), buses.begin(), buses.end());
     }
+    std::sort(result.begin(), result.end(), [this](domain::BusId lhs, domain::BusId rhs) {
+        return bus_names_[lhs] < bus_names_[rhs];
+    });
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+std::vector<domain::StopId> TransportCatalogue::GetStopsContainingAnyBus() const {
+    std::vector<domain::StopId> result;
+    stop_ids_.ForEach([&](std::string_view, domain::StopId stop) {
+        if (finalized_ ? !stop_buses_[stop].empty() : !stop_to_buses_[stop].empty()) {
+            result.push_back(stop);
+        }
+    });
+    std::sort(result.begin(), result.end(), [this](domain::StopId lhs, domain::StopId rhs) {
+        return stop_names_[lhs] < stop_names_[rhs];
+    });
     return result;
 }
-}  // namespace transport_catalogue
\ No newline at end of file
+}  // namespace transport_catalogue
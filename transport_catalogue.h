@@ -1,36 +1,202 @@
 #pragma once
-#include <deque>
 #include <map>
+#include <optional>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "domain.h"
+#include "stop_index.h"
+#include "string_pool.h"
 /*
- * Здесь можно разместить код транспортного справочника
+ * Транспортный справочник. Остановки и маршруты адресуются плотными номерами StopId и BusId
+ * и хранятся по столбцам: названия, широты и долготы остановок - отдельными массивами,
+ * остановки всех маршрутов - одним общим массивом со смещениями. Названия хранятся один раз
+ * в пуле строк, индексы по названиям ссылаются на них, поиск по std::string_view - один проход по хеш-таблице.
+ * Расстояния по дорогам при загрузке копятся списком, а в Finalize собираются в граф (CSR):
+ * для каждой остановки - отсортированные по номеру соседи и расстояния до них. Если расстояние
+ * задано только в одну сторону, обратное ребро добавляется в граф с тем же расстоянием
+ *
+ * До Finalize данные только копятся. После Finalize справочник можно менять на ходу: каждое
+ * изменение сразу обновляет индексы и пересчитывает только то, что от него зависит, - статистику
+ * маршрутов, проходящих через изменённые остановки и участки, списки маршрутов этих остановок
+ * и рёбра графа. Удалённые остановки и маршруты сохраняют свои номера, но пропадают из индексов
+ * по названиям; их названия остаются в пуле строк.
+ *
+ * Столбцы хранятся страницами (PagedVector и PagedLists), индексы по названиям - частями (ShardedMap):
+ * копия справочника копирует только таблицы страниц и разделяет сами страницы с оригиналом,
+ * а изменение копии копирует только затронутые страницы. Копия стоит O(число страниц), изменение в ней
+ * одной остановки, маршрута или расстояния - O(размер страницы), а не O(размер справочника).
+ * На этом построены версии VersionedCatalogue и атомарное применение Update
  */
 namespace transport_catalogue {
 class TransportCatalogue {
    public:
-    void AddStop(const std::string& name, geo::Coordinates coordinates);
-    void AddBus(const std::string& name, const std::vector<std::string>& names_stops, domain::TypeRoute type);
-    void AddDistanceToStops(const domain::Stop* first_stop, const domain::Stop* second_stop, int distance);
-    int GetCountStopsOnRouts(const domain::Bus* bus) const;
-    const domain::Bus* GetBus(const std::string& name) const;
-    const domain::Stop* GetStop(const std::string& name) const;
-    std::set<std::string> GetBusesContainingStop(const domain::Stop* stop) const;
-    int GetRealLengthRoute(const domain::Stop* from, const domain::Stop* to) const;
-    int GetLengthRoute(const domain::Bus* bus) const;
-    double GetCurvature(const domain::Bus* bus, int real_distance) const;
-    std::vector<const domain::Bus*> GetBuses() const;
-    std::map<std::string, const domain::Stop*> GetStopsContainingAnyBus() const;
+    domain::StopId AddStop(std::string_view name, geo::Coordinates coordinates);
+    domain::BusId AddBus(std::string_view name, const std::vector<std::string_view>& names_stops, domain::TypeRoute type);
+    domain::BusId AddBus(std::string_view name, domain::Span<domain::StopId> stops, domain::TypeRoute type);
+    // Задаёт расстояние по дороге от first_stop до second_stop, повторный вызов его изменяет
+    void AddDistanceToStops(domain::StopId first_stop, domain::StopId second_stop, int distance);
+    // Резервирует память под заданное число остановок, маршрутов и остановок всех маршрутов
+    void Reserve(size_t stop_count, size_t bus_count, size_t route_stop_count);
+    // Строит граф расстояний и списки маршрутов остановок, вычисляет статистику всех маршрутов параллельно.
+    // Вызывается один раз после заполнения справочника, повторные вызовы ничего не делают
+    void Finalize();
+    bool IsFinalized() const {
+        return finalized_;
+    }
+
+    // Изменения на ходу. Если Finalize ещё не вызывался, он вызывается перед изменением.
+    // Span и указатели, полученные из справочника раньше, после изменения недействительны
+    void SetStopCoordinates(domain::StopId stop, geo::Coordinates coordinates);
+    // Бросает std::invalid_argument, если через остановку проходит маршрут
+    void RemoveStop(domain::StopId stop);
+    void SetRoute(domain::BusId bus, domain::Span<domain::StopId> stops, domain::TypeRoute type);
+    void RemoveBus(domain::BusId bus);
+    // Удаляет расстояние, заданное от from до to. Если задано расстояние от to до from,
+    // дальше оно действует в обе стороны
+    void RemoveDistance(domain::StopId from, domain::StopId to);
+    bool IsStopRemoved(domain::StopId stop) const {
+        return stop_removed_[stop];
+    }
+    bool IsBusRemoved(domain::BusId bus) const {
+        return bus_removed_[bus];
+    }
+    // Номер версии остановок и маршрутов. Увеличивается при каждом их изменении,
+    // но не при изменении расстояний, которые не влияют на карту
+    uint64_t GetNetworkRevision() const {
+        return network_revision_;
+    }
+    // Номер версии расстояний по дорогам. Увеличивается при каждом их изменении после Finalize
+    uint64_t GetRoadRevision() const {
+        return road_revision_;
+    }
+
+    std::optional<domain::StopId> FindStop(std::string_view name) const;
+    std::optional<domain::BusId> FindBus(std::string_view name) const;
+    // Число номеров остановок и маршрутов, включая удалённые
+    size_t GetStopCount() const {
+        return stop_names_.size();
+    }
+    size_t GetBusCount() const {
+        return bus_names_.size();
+    }
+    std::string_view GetStopName(domain::StopId stop) const {
+        return stop_names_[stop];
+    }
+    geo::Coordinates GetStopCoordinates(domain::StopId stop) const {
+        return {stop_latitudes_[stop], stop_longitudes_[stop]};
+    }
+    std::string_view GetBusName(domain::BusId bus) const {
+        return bus_names_[bus];
+    }
+    domain::TypeRoute GetBusType(domain::BusId bus) const {
+        return bus_types_[bus];
+    }
+    // Остановки маршрута в порядке следования, для линейного маршрута - только в прямом направлении
+    domain::Span<domain::StopId> GetRoute(domain::BusId bus) const {
+        return routes_[bus];
+    }
+
+    // Память, которую занимают данные справочника, в байтах. Столбцы, общие с копиями справочника,
+    // учитываются полностью; память хеш-таблиц оценивается по числу корзин и элементов
+    size_t GetMemoryUsage() const;
+
+    int GetCountStopsOnRouts(domain::BusId bus) const;
+    // Маршруты, проходящие через остановку, отсортированные по названию и без повторов.
+    // Списки строятся в Finalize и дальше обновляются при изменениях
+    domain::Span<domain::BusId> GetBusesContainingStop(domain::StopId stop) const {
+        return stop < stop_buses_.size() ? stop_buses_[stop] : domain::Span<domain::BusId>{};
+    }
+    // Расстояние по дороге от from до to, а если оно не задано - от to до from.
+    // Бросает std::out_of_range, если не задано ни одно из них
+    int GetRealLengthRoute(domain::StopId from, domain::StopId to) const;
+    int GetLengthRoute(domain::BusId bus) const;
+    double GetCurvature(domain::BusId bus, int real_distance) const;
+    domain::BusStat ComputeBusStat(domain::BusId bus) const;
+    // Статистика маршрута, вычисленная в Finalize или после изменения, или nullptr, если она не вычислена
+    const domain::BusStat* FindBusStat(domain::BusId bus) const {
+        return bus < bus_stat_ready_.size() && bus_stat_ready_[bus] ? &bus_stats_[bus] : nullptr;
+    }
+    // Расстояния в том виде, в котором они заданы, без достроенных обратных (после Finalize - без повторов
+    // и в порядке номеров остановок)
+    std::vector<domain::StopsDistance> GetDistances() const;
+    // Остановки, через которые проходит хотя бы один маршрут, отсортированные по названию
+    std::vector<domain::StopId> GetStopsContainingAnyBus() const;
+
+    // Поиск остановок по координатам через пространственный индекс, который строится в Finalize.
+    // Прямоугольник, у которого box.min.lng > box.max.lng, переходит через 180-й меридиан.
+    // Остановки в box, отсортированные по названию
+    std::vector<domain::StopId> FindStopsInBox(geo::Box box) const;
+    // Остановки не дальше radius метров от center по возрастанию расстояния, при равенстве - по названию
+    std::vector<domain::NearbyStop> FindStopsInRadius(geo::Coordinates center, double radius) const;
+    // count ближайших к center остановок в том же порядке
+    std::vector<domain::NearbyStop> FindNearestStops(geo::Coordinates center, size_t count) const;
+    // Маршруты, проходящие хотя бы через одну из stops, отсортированные по названию
+    std::vector<domain::BusId> GetBusesContainingAnyStop(const std::vector<domain::StopId>& stops) const;
 
    private:
-    std::deque<domain::Stop> stops_;
-    std::unordered_map<std::string, const domain::Stop*> names_stops_;
-    std::deque<domain::Bus> buses_;
-    std::unordered_map<std::string, const domain::Bus*> names_buses_;
-    std::unordered_map<const domain::Stop*, std::vector<const domain::Bus*>> stop_to_buses_;
-    std::unordered_map<std::pair<const domain::Stop*, const domain::Stop*>, int, domain::StopPairHasher> distance_to_stops_;
+    StringPool names_;
+
+    domain::PagedVector<std::string_view> stop_names_;
+    domain::PagedVector<double> stop_latitudes_;
+    domain::PagedVector<double> stop_longitudes_;
+    // Координаты остановок на единичной сфере для расчёта географической длины маршрутов
+    domain::PagedVector<geo::UnitVector> stop_points_;
+    domain::ShardedMap<std::string_view, domain::StopId> stop_ids_;
+    // Остановки из stop_ids_ по координатам, строится в Finalize
+    StopIndex stop_index_;
+
+    domain::PagedVector<std::string_view> bus_names_;
+    domain::PagedVector<domain::TypeRoute> bus_types_;
+    domain::PagedLists<domain::StopId> routes_;
+    domain::ShardedMap<std::string_view, domain::BusId> bus_ids_;
+
+    struct RoadEdge {
+        domain::StopId to;
+        int distance;
+        bool is_explicit;  // расстояние задано, а не достроено по обратному
+    };
+
+    std::string_view InternName(const domain::ShardedMap<std::string_view, uint32_t>& index,
+                                const domain::PagedVector<std::string_view>& names, std::string_view name);
+    void BuildRoadGraph();
+    void BuildStopBuses();
+    void BuildStopIndex();
+    // Остановка не удалена и её название не перешло к другой остановке
+    bool IsStopVisible(domain::StopId stop) const;
+    // Вызывает function(StopId) для остановок в box
+    template <typename Function>
+    void ForEachStopInBox(geo::Box box, Function function) const;
+
+    const RoadEdge* FindRoadEdge(domain::StopId from, domain::StopId to) const;
+    void SetRoadEdge(domain::StopId from, RoadEdge edge);
+    void EraseRoadEdge(domain::StopId from, domain::StopId to);
+    void SetDistance(domain::StopId from, domain::StopId to, int distance);
+    // Добавляют маршрут в списки остановок stops и убирают его оттуда
+    void AttachBus(domain::BusId bus, const std::vector<domain::StopId>& stops);
+    void DetachBus(domain::BusId bus, const std::vector<domain::StopId>& stops);
+    void UpdateBusStat(domain::BusId bus);
+    // Пересчитывает статистику маршрутов, проходящих через stop, а если задан next - то и через next
+    void UpdateBusStats(domain::StopId stop, std::optional<domain::StopId> next = std::nullopt);
+
+    bool finalized_ = false;
+    uint64_t network_revision_ = 0;
+    uint64_t road_revision_ = 0;
+    domain::PagedVector<char> stop_removed_;
+    domain::PagedVector<char> bus_removed_;
+
+    // До Finalize маршруты остановок копятся в порядке добавления, после - хранятся в stop_buses_
+    std::vector<std::vector<domain::BusId>> stop_to_buses_;
+    domain::PagedLists<domain::BusId> stop_buses_;
+    // Расстояния в порядке добавления до Finalize, при повторе действует последнее.
+    // После Finalize расстояния хранятся только в графе
+    std::vector<domain::StopsDistance> distances_;
+    domain::PagedLists<RoadEdge> road_graph_;
+
+    domain::PagedVector<domain::BusStat> bus_stats_;
+    // Статистика маршрута не вычисляется, если для какого-то участка нет расстояния:
+    // ошибка тогда возникает при запросе этого маршрута, а не при загрузке
+    domain::PagedVector<char> bus_stat_ready_;
 };
-}  //namespace transport_catalogue
\ No newline at end of file
+}  //namespace transport_catalogue
@@ -0,0 +1,237 @@
+#include "transport_router.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace router {
+
+namespace {
+
+// Рабочие массивы поиска одного потока. Вершина считается достигнутой, только если её метка
+// равна текущему поколению, поэтому между запросами массивы не очищаются
+struct SearchScratch {
+    std::vector<double> distances;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> generations;
+    uint32_t generation = 0;
+    std::vector<std::pair<double, uint32_t>> heap;
+    std::vector<uint32_t> path;
+
+    void Prepare(size_t vertex_count) {
+        if (generations.size() < vertex_count) {
+            distances.resize(vertex_count);
+            parents.resize(vertex_count);
+            generations.resize(vertex_count, 0);
+        }
+        if (++generation == 0) {
+            std::fill(generations.begin(), generations.end(), 0);
+            generation = 1;
+        }
+        heap.clear();
+        path.clear();
+    }
+
+    bool IsReached(uint32_t vertex) const {
+        return generations[vertex] == generation;
+    }
+
+    void Reach(uint32_t vertex, double distance, uint32_t parent) {
+        generations[vertex] = generation;
+        distances[vertex] = distance;
+        parents[vertex] = parent;
+        heap.emplace_back(distance, vertex);
+        std::push_heap(heap.begin(), heap.end(), std::greater<>{});
+    }
+};
+
+thread_local SearchScratch search_scratch;
+
+}  // namespace
+
+TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& db, RoutingSettings settings, size_t thread_count)
+    : settings_(settings), stop_count_(db.GetStopCount()) {
+    BuildGraph(db);
+    if (!settings_.contraction_hierarchies) {
+        return;
+    }
+    domain::FlatLists<ContractionHierarchy::Arc> arcs;
+    std::vector<ContractionHierarchy::Arc> vertex_arcs;
+    for (Metric metric : {Metric::Time, Metric::Distance}) {
+        arcs = {};
+        arcs.Reserve(graph_.size(), graph_.GetItemCount());
+        for (size_t vertex = 0; vertex < graph_.size(); ++vertex) {
+            vertex_arcs.clear();
+            for (const Edge& edge : graph_[vertex]) {
+                vertex_arcs.push_back({edge.to, GetWeight(static_cast<uint32_t>(vertex), edge, metric)});
+            }
+            arcs.Append(vertex_arcs.begin(), vertex_arcs.end());
+        }
+        hierarchies_.emplace_back(arcs, thread_count);
+    }
+}
+
+TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& db, RoutingSettings settings,
+                                 std::vector<ContractionHierarchy> hierarchies)
+    : settings_(settings), stop_count_(db.GetStopCount()), hierarchies_(std::move(hierarchies)) {
+    BuildGraph(db);
+    for (const ContractionHierarchy& hierarchy : hierarchies_) {
+        if (hierarchy.GetVertexCount() != graph_.size()) {
+            throw std::invalid_argument("Contraction hierarchy doesn't match the route graph");
+        }
+    }
+}
+
+void TransportRouter::BuildGraph(const transport_catalogue::TransportCatalogue& db) {
+    const double meters_per_minute = settings_.bus_velocity * 1000 / 60;
+
+    //Места в автобусах: остановка и расстояние до следующего места того же автобуса (меньше нуля - проезда нет)
+    std::vector<domain::StopId> ride_stops;
+    std::vector<int> ride_distances;
+    std::vector<domain::StopId> sequence;
+    for (domain::BusId bus = 0; bus < db.GetBusCount(); ++bus) {
+        if (db.IsBusRemoved(bus)) {
+            continue;
+        }
+        const domain::Span<domain::StopId> route = db.GetRoute(bus);
+        sequence.assign(route.begin(), route.end());
+        if (db.GetBusType(bus) == domain::TypeRoute::linear && route.size() > 1) {
+            sequence.insert(sequence.end(), std::make_reverse_iterator(route.end() - 1), std::make_reverse_iterator(route.begin()));
+        }
+        for (size_t i = 0; i < sequence.size(); ++i) {
+            int distance = -1;
+            if (i + 1 < sequence.size()) {
+                try {
+                    distance = db.GetRealLengthRoute(sequence[i], sequence[i + 1]);
+                } catch (const std::out_of_range&) {
+                }
+            }
+            ride_stops.push_back(sequence[i]);
+            ride_distances.push_back(distance);
+            ride_buses_.push_back(bus);
+        }
+    }
+
+    //Посадки сгруппированы по остановкам подсчётом
+    std::vector<uint32_t> boarding_offsets(stop_count_ + 1, 0);
+    for (domain::StopId stop : ride_stops) {
+        ++boarding_offsets[stop + 1];
+    }
+    for (size_t stop = 0; stop < stop_count_; ++stop) {
+        boarding_offsets[stop + 1] += boarding_offsets[stop];
+    }
+    std::vector<Edge> boardings(ride_stops.size());
+    std::vector<uint32_t> next_boarding(boarding_offsets.begin(), boarding_offsets.end() - 1);
+    const auto wait_time = static_cast<double>(settings_.bus_wait_time);
+    for (size_t ride = 0; ride < ride_stops.size(); ++ride) {
+        boardings[next_boarding[ride_stops[ride]]++] = {static_cast<uint32_t>(stop_count_ + ride), 0, wait_time};
+    }
+
+    graph_.Reserve(stop_count_ + ride_stops.size(), boardings.size() + 2 * ride_stops.size());
+    for (size_t stop = 0; stop < stop_count_; ++stop) {
+        graph_.Append(boardings.begin() + boarding_offsets[stop], boardings.begin() + boarding_offsets[stop + 1]);
+    }
+    for (size_t ride = 0; ride < ride_stops.size(); ++ride) {
+        const Edge edges[] = {{static_cast<uint32_t>(stop_count_ + ride + 1), ride_distances[ride], ride_distances[ride] / meters_per_minute},
+                              {ride_stops[ride], 0, 0}};
+        graph_.Append(ride_distances[ride] < 0 ? edges + 1 : edges, edges + 2);
+    }
+}
+
+double TransportRouter::GetWeight(uint32_t from, const Edge& edge, Metric metric) const {
+    if (metric == Metric::Time) {
+        return edge.time;
+    }
+    //Пути одной длины отличаются по времени только ожиданиями, поэтому к метрам, умноженным на число
+    //остановок плюс один, прибавляется число посадок. На простом пути посадок не больше, чем остановок,
+    //поэтому сравнение весов - это сравнение пар (метры, посадки). Веса целые, и пока длина пути
+    //в этих единицах меньше 2^53, сумма в double точная
+    const auto scale = static_cast<double>(stop_count_ + 1);
+    return edge.distance * scale + (from < stop_count_ ? 1 : 0);
+}
+
+size_t TransportRouter::GetMemoryUsage() const {
+    size_t memory = graph_.GetMemoryUsage() + ride_buses_.capacity() * sizeof(domain::BusId);
+    for (const ContractionHierarchy& hierarchy : hierarchies_) {
+        memory += hierarchy.GetMemoryUsage();
+    }
+    return memory;
+}
+
+std::optional<RouteInfo> TransportRouter::FindRoute(domain::StopId from, domain::StopId to, Metric metric) const {
+    if (from >= stop_count_ || to >= stop_count_) {
+        return std::nullopt;
+    }
+    std::vector<uint32_t>& path = search_scratch.path;
+    const bool found = hierarchies_.empty() ? FindPathDijkstra(from, to, metric, path)
+                                            : hierarchies_[static_cast<size_t>(metric)].FindPath(from, to, path).has_value();
+    if (!found) {
+        return std::nullopt;
+    }
+    return MakeRoute(path);
+}
+
+bool TransportRouter::FindPathDijkstra(uint32_t from, uint32_t to, Metric metric, std::vector<uint32_t>& path) const {
+    SearchScratch& scratch = search_scratch;
+    scratch.Prepare(graph_.size());
+    scratch.Reach(from, 0, from);
+    while (!scratch.heap.empty()) {
+        std::pop_heap(scratch.heap.begin(), scratch.heap.end(), std::greater<>{});
+        const auto [distance, vertex] = scratch.heap.back();
+        scratch.heap.pop_back();
+        if (distance > scratch.distances[vertex]) {
+            continue;
+        }
+        if (vertex == to) {
+            break;
+        }
+        for (const Edge& edge : graph_[vertex]) {
+            const double next_distance = distance + GetWeight(vertex, edge, metric);
+            if (!scratch.IsReached(edge.to) || next_distance < scratch.distances[edge.to]) {
+                scratch.Reach(edge.to, next_distance, vertex);
+            }
+        }
+    }
+    if (!scratch.IsReached(to)) {
+        return false;
+    }
+
+    path.clear();
+    for (uint32_t vertex = to; vertex != from; vertex = scratch.parents[vertex]) {
+        path.push_back(vertex);
+    }
+    path.push_back(from);
+    std::reverse(path.begin(), path.end());
+    return true;
+}
+
+RouteInfo TransportRouter::MakeRoute(const std::vector<uint32_t>& path) const {
+    //Путь чередует остановки и поездки: остановка, места в одном автобусе подряд, остановка выхода.
+    //Время накапливается вдоль пути в том же порядке, что и в поиске
+    RouteInfo info;
+    const auto wait_time = static_cast<double>(settings_.bus_wait_time);
+    for (size_t i = 0; i + 1 < path.size();) {
+        const size_t boarding = i + 1;
+        info.total_time += wait_time;
+        const double boarding_time = info.total_time;
+        size_t alighting = boarding;
+        while (alighting + 1 < path.size() && path[alighting + 1] >= stop_count_) {
+            const domain::Span<Edge> edges = graph_[path[alighting]];
+            const Edge& edge = *std::find_if(edges.begin(), edges.end(), [next = path[alighting + 1]](const Edge& edge) {
+                return edge.to == next;
+            });
+            info.total_time += edge.time;
+            info.total_distance += edge.distance;
+            ++alighting;
+        }
+        info.items.push_back({RouteItem::Type::Wait, path[i], 0, 0, wait_time});
+        info.items.push_back({RouteItem::Type::Bus, 0, ride_buses_[path[boarding] - stop_count_], static_cast<int>(alighting - boarding),
+                              info.total_time - boarding_time});
+        i = alighting + 1;
+    }
+    return info;
+}
+
+}  // namespace router
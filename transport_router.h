@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "contraction_hierarchy.h"
+#include "domain.h"
+#include "transport_catalogue.h"
+
+/*
+ * Поиск самого быстрого пути между остановками. Граф строится по справочнику один раз:
+ * вершины - остановки и места в автобусах (маршрут и номер остановки в порядке следования),
+ * рёбра - посадка с ожиданием автобуса, проезд до следующей остановки маршрута и выход.
+ * Пересадка - выход и новая посадка с ожиданием, проезд без выхода ожидания не требует.
+ * Линейный маршрут проходится туда и обратно как одна последовательность остановок.
+ * Рёбра хранятся списками смежности подряд (CSR), путь ищется алгоритмом Дейкстры или, если включена
+ * предобработка, по иерархиям сжатия (отдельно для времени и для расстояния)
+ */
+namespace router {
+
+struct RoutingSettings {
+    int bus_wait_time = 0;     // ожидание автобуса на остановке, минуты
+    double bus_velocity = 0;   // скорость автобуса, км/ч
+    bool contraction_hierarchies = false;  // строить иерархии сжатия для быстрых запросов
+};
+
+// Что минимизирует путь: время в пути с ожиданием или расстояние по дорогам.
+// Из путей одной длины выбирается путь с меньшим числом посадок, то есть самый быстрый из них
+enum class Metric {
+    Time,
+    Distance
+};
+
+struct RouteItem {
+    enum class Type {
+        Wait,
+        Bus
+    };
+    Type type;
+    domain::StopId stop;  // остановка ожидания (Wait)
+    domain::BusId bus;    // маршрут поездки (Bus)
+    int span_count;       // число проеханных перегонов (Bus)
+    double time;          // минуты
+};
+
+struct RouteInfo {
+    double total_time = 0;  // минуты
+    int total_distance = 0;  // метры по дорогам
+    std::vector<RouteItem> items;
+};
+
+class TransportRouter {
+   public:
+    // Строит граф по неудалённым маршрутам. Перегон без расстояния по дороге в граф не попадает.
+    // С settings.contraction_hierarchies строит иерархии сжатия для обеих метрик в thread_count потоках
+    TransportRouter(const transport_catalogue::TransportCatalogue& db, RoutingSettings settings,
+                    size_t thread_count = std::thread::hardware_concurrency());
+    // Граф с готовыми иерархиями, построенными для этого же графа (например, загруженными из файла),
+    // по одной на метрику в порядке Metric. Бросает std::invalid_argument, если число вершин не совпадает
+    TransportRouter(const transport_catalogue::TransportCatalogue& db, RoutingSettings settings,
+                    std::vector<ContractionHierarchy> hierarchies);
+
+    // Лучший по metric путь от from до to или nullopt, если пути нет. Можно вызывать из нескольких
+    // потоков одновременно: рабочие массивы поиска свои у каждого потока и переиспользуются между запросами
+    std::optional<RouteInfo> FindRoute(domain::StopId from, domain::StopId to, Metric metric = Metric::Time) const;
+
+    const RoutingSettings& GetSettings() const {
+        return settings_;
+    }
+    size_t GetVertexCount() const {
+        return graph_.size();
+    }
+    size_t GetEdgeCount() const {
+        return graph_.GetItemCount();
+    }
+    // Иерархии по метрикам или пустой вектор без предобработки
+    const std::vector<ContractionHierarchy>& GetHierarchies() const {
+        return hierarchies_;
+    }
+    size_t GetMemoryUsage() const;
+
+   private:
+    struct Edge {
+        uint32_t to;
+        int distance;  // метры, у посадки и выхода - ноль
+        double time;   // минуты
+    };
+
+    void BuildGraph(const transport_catalogue::TransportCatalogue& db);
+    // Вес ребра edge из вершины from по metric, одинаковый для Дейкстры и иерархий
+    double GetWeight(uint32_t from, const Edge& edge, Metric metric) const;
+    // Вершины пути от from до to по Дейкстре
+    bool FindPathDijkstra(uint32_t from, uint32_t to, Metric metric, std::vector<uint32_t>& path) const;
+    // Разбивает путь по графу на ожидания и поездки
+    RouteInfo MakeRoute(const std::vector<uint32_t>& path) const;
+
+    RoutingSettings settings_;
+    size_t stop_count_ = 0;
+    // Вершины 0..stop_count_-1 - остановки, дальше - места в автобусах подряд по маршрутам
+    domain::FlatLists<Edge> graph_;
+    std::vector<domain::BusId> ride_buses_;  // маршрут места в автобусе, по номеру вершины минус stop_count_
+    std::vector<ContractionHierarchy> hierarchies_;
+};
+
+}  // namespace router
@@ -0,0 +1,44 @@
+#include "versioned_catalogue.h"
+
+#include <utility>
+
+namespace transport_catalogue {
+
+VersionedCatalogue::Version::Version(TransportCatalogue db, const renderer::MapRenderer& renderer,
+                                     std::optional<router::RoutingSettings> routing_settings, uint64_t number, const Version* previous,
+                                     std::shared_ptr<const router::TransportRouter> transport_router)
+    : db_(std::move(db)), handler_(db_, renderer, routing_settings, std::move(transport_router)), number_(number) {
+    if (previous != nullptr) {
+        handler_.ReuseCaches(previous->handler_);
+    }
+}
+
+VersionedCatalogue::VersionedCatalogue(TransportCatalogue db, const renderer::MapRenderer& renderer,
+                                       std::optional<router::RoutingSettings> routing_settings,
+                                       std::shared_ptr<const router::TransportRouter> transport_router)
+    : renderer_(renderer), routing_settings_(routing_settings) {
+    db.Finalize();
+    current_.store(new Version(std::move(db), renderer_, routing_settings_, 1, nullptr, std::move(transport_router)),
+                   std::memory_order_release);
+}
+
+VersionedCatalogue::~VersionedCatalogue() {
+    delete current_.load(std::memory_order_acquire);
+    concurrency::CollectRetired();
+}
+
+uint64_t VersionedCatalogue::Modify(const std::function<void(TransportCatalogue&)>& update) {
+    std::lock_guard lock(writer_mutex_);
+    //Указатель меняют только писатели, и только под writer_mutex_
+    const Version* current = current_.load(std::memory_order_relaxed);
+    TransportCatalogue db = current->GetCatalogue();
+    update(db);
+    const Version* next = new Version(std::move(db), renderer_, routing_settings_, current->GetNumber() + 1, current);
+    //Новая версия публикуется до передачи старой в Retire, иначе новый читатель мог бы закрепить старую
+    current_.store(next, std::memory_order_seq_cst);
+    concurrency::Retire(current);
+    concurrency::CollectRetired();
+    return next->GetNumber();
+}
+
+}  // namespace transport_catalogue
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "epoch.h"
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+/*
+ * Справочник с версиями для одновременных запросов и изменений.
+ * Опубликованная версия не меняется: запрос закрепляет текущую версию и читает её без блокировок,
+ * не видя изменений, которые применяются в это время. Писатель копирует текущую версию (копия
+ * разделяет с ней страницы столбцов, см. TransportCatalogue), применяет изменения к копии и публикует её
+ * одной атомарной записью указателя. Заменённая версия освобождается через concurrency::Retire,
+ * когда её не читает ни один поток. Писатели выполняются по очереди
+ */
+namespace transport_catalogue {
+
+class VersionedCatalogue {
+   public:
+    // Справочник вместе с обработчиком запросов к нему
+    class Version {
+       public:
+        // Если задана previous, новая версия берёт у неё отрисованную карту и граф путей, когда они подходят.
+        // transport_router - готовый граф путей по db, см. RequestHandler
+        Version(TransportCatalogue db, const renderer::MapRenderer& renderer, std::optional<router::RoutingSettings> routing_settings,
+                uint64_t number, const Version* previous, std::shared_ptr<const router::TransportRouter> transport_router = nullptr);
+
+        Version(const Version&) = delete;
+        Version& operator=(const Version&) = delete;
+
+        const TransportCatalogue& GetCatalogue() const {
+            return db_;
+        }
+        const RequestHandler& GetHandler() const {
+            return handler_;
+        }
+        // Версии нумеруются подряд с единицы
+        uint64_t GetNumber() const {
+            return number_;
+        }
+
+       private:
+        TransportCatalogue db_;
+        RequestHandler handler_;
+        uint64_t number_;
+    };
+
+    // Закреплённая версия: пока объект жив, версия не освобождается.
+    // Объект действует только в создавшем его потоке
+    class Snapshot {
+       public:
+        explicit Snapshot(const std::atomic<const Version*>& current)
+            : version_(current.load(std::memory_order_seq_cst)) {
+        }
+
+        const Version& operator*() const {
+            return *version_;
+        }
+        const Version* operator->() const {
+            return version_;
+        }
+
+       private:
+        concurrency::EpochGuard guard_;  // создаётся до чтения указателя на версию
+        const Version* version_;
+    };
+
+    // Первая версия - db после Finalize. Без routing_settings запросы путей не поддерживаются.
+    // transport_router - готовый граф путей первой версии (например, из файла make_base) или nullptr
+    VersionedCatalogue(TransportCatalogue db, const renderer::MapRenderer& renderer,
+                       std::optional<router::RoutingSettings> routing_settings = std::nullopt,
+                       std::shared_ptr<const router::TransportRouter> transport_router = nullptr);
+    // Вызывается, когда версии уже никто не читает
+    ~VersionedCatalogue();
+
+    VersionedCatalogue(const VersionedCatalogue&) = delete;
+    VersionedCatalogue& operator=(const VersionedCatalogue&) = delete;
+
+    Snapshot Read() const {
+        return Snapshot(current_);
+    }
+
+    // Применяет update к копии текущей версии и публикует копию как новую версию.
+    // Если update бросает исключение, текущая версия остаётся прежней. Возвращает номер новой версии
+    uint64_t Modify(const std::function<void(TransportCatalogue&)>& update);
+
+   private:
+    const renderer::MapRenderer& renderer_;
+    std::optional<router::RoutingSettings> routing_settings_;
+    std::mutex writer_mutex_;
+    std::atomic<const Version*> current_;
+};
+
+}  // namespace transport_catalogue